@@ -0,0 +1,195 @@
+"""
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+"""
+"""
+icosa.py : Python bindings of the C interface (icosa_c, icosa_api.h).
+
+The solver writes straight into NumPy arrays allocated here, so the vertices
+(n x 3 float64) and faces (m x 3 int32) are not copied after the solve. The
+calls into the library release the GIL (ctypes), solve_batch solves a list
+of configurations on the library's thread pool in one call.
+
+	import icosa
+	s = icosa.solve(7, 0, variant=2, certify=True)
+	s.vertices, s.faces, s.seeds, s.certified
+	for s in icosa.solve_batch([(b, 0, v) for b in range(2, 8) for v in range(icosa.variants(b))]):
+		...
+
+The library is found through ICOSA_LIBRARY, next to this file or on the
+system library path. Running the module solves every configuration.
+"""
+import ctypes
+import ctypes.util
+import os
+import sys
+
+import numpy
+
+ICOSA_OK = 0
+ICOSA_ERROR_ARGUMENT = -1
+ICOSA_ERROR_BUFFER = -2
+ICOSA_ERROR_SOLVE = -3
+
+KERNEL = {"reference": 0, "fast": 1}
+
+class ICOSA_OPTIONS(ctypes.Structure):
+	_fields_ = [("size", ctypes.c_int), ("radius", ctypes.c_double), ("precision", ctypes.c_int),
+		("tolerance", ctypes.c_double), ("kernel", ctypes.c_int), ("certify", ctypes.c_int)]
+
+class ICOSA_SIZES(ctypes.Structure):
+	_fields_ = [("variants", ctypes.c_int), ("vertices", ctypes.c_int), ("faces", ctypes.c_int), ("seeds", ctypes.c_int)]
+
+class ICOSA_ANALYSIS(ctypes.Structure):
+	_fields_ = [("seeds", ctypes.c_int), ("seed", ctypes.c_double * 2), ("residual", ctypes.c_double),
+		("edge_min", ctypes.c_double), ("edge_max", ctypes.c_double), ("certified", ctypes.c_int)]
+
+class ICOSA_JOB(ctypes.Structure):
+	_fields_ = [("b", ctypes.c_int), ("c", ctypes.c_int), ("variant", ctypes.c_int),
+		("vertices", ctypes.POINTER(ctypes.c_double)), ("vertex_capacity", ctypes.c_int),
+		("faces", ctypes.POINTER(ctypes.c_int)), ("face_capacity", ctypes.c_int),
+		("analysis", ctypes.POINTER(ICOSA_ANALYSIS)), ("status", ctypes.c_int)]
+
+class IcosaError(Exception):
+	def __init__(self, status, what):
+		self.status = status
+		Exception.__init__(self, "%s: %s" % (what, _lib.icosa_status_message(status).decode()))
+
+class Solution(object):
+	"""Solved configuration variant, the arrays view the memory the library wrote."""
+	__slots__ = ("b", "c", "variant", "vertices", "faces", "seeds", "residual", "edge_min", "edge_max", "certified")
+
+	def __init__(self, b, c, variant, vertices, faces, analysis):
+		self.b, self.c, self.variant = b, c, variant
+		self.vertices = vertices
+		self.faces = faces
+		self.seeds = tuple(analysis.seed[i] for i in range(analysis.seeds))
+		self.residual = analysis.residual
+		self.edge_min = analysis.edge_min
+		self.edge_max = analysis.edge_max
+		self.certified = None if analysis.certified < 0 else bool(analysis.certified)
+
+	def __repr__(self):
+		return "Solution((%d,%d) variant %d, %d vertices, %d faces)" % (self.b, self.c, self.variant, len(self.vertices), len(self.faces))
+
+#---------------------------------------------------------------------------
+def _load():
+#---------------------------------------------------------------------------
+	# the shared library and its prototypes
+	names = {"win32": "icosa_c.dll", "darwin": "libicosa_c.dylib"}
+	name = names.get(sys.platform, "libicosa_c.so")
+	path = os.environ.get("ICOSA_LIBRARY")
+	if not path:
+		path = os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+		if not os.path.exists(path):
+			path = ctypes.util.find_library("icosa_c") or name
+	lib = ctypes.CDLL(path)
+
+	lib.icosa_version.restype = ctypes.c_int
+	lib.icosa_status_message.argtypes = [ctypes.c_int]
+	lib.icosa_status_message.restype = ctypes.c_char_p
+	lib.icosa_default_options.argtypes = [ctypes.POINTER(ICOSA_OPTIONS)]
+	lib.icosa_default_options.restype = None
+	lib.icosa_query.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ICOSA_SIZES)]
+	lib.icosa_query.restype = ctypes.c_int
+	lib.icosa_solve.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ICOSA_OPTIONS),
+		ctypes.POINTER(ctypes.c_double), ctypes.c_int, ctypes.POINTER(ctypes.c_int), ctypes.c_int, ctypes.POINTER(ICOSA_ANALYSIS)]
+	lib.icosa_solve.restype = ctypes.c_int
+	lib.icosa_solve_batch.argtypes = [ctypes.POINTER(ICOSA_JOB), ctypes.c_int, ctypes.POINTER(ICOSA_OPTIONS), ctypes.c_int]
+	lib.icosa_solve_batch.restype = ctypes.c_int
+	if lib.icosa_version() < 2:
+		raise ImportError("icosa: %s is older than the bindings" % path)
+	return lib
+
+_lib = _load()
+
+#---------------------------------------------------------------------------
+def _options(radius=1.0, precision=0, tolerance=0.0, kernel="reference", certify=False):
+#---------------------------------------------------------------------------
+	options = ICOSA_OPTIONS()
+	_lib.icosa_default_options(ctypes.byref(options))
+	options.radius = radius
+	options.precision = precision
+	options.tolerance = tolerance
+	options.kernel = KERNEL[kernel]
+	options.certify = 1 if certify else 0
+	return options
+
+#---------------------------------------------------------------------------
+def query(b, c=0, variant=0):
+#---------------------------------------------------------------------------
+	"""Number of variants, vertices, faces and seeds of a configuration variant."""
+	sizes = ICOSA_SIZES()
+	status = _lib.icosa_query(b, c, variant, ctypes.byref(sizes))
+	if status != ICOSA_OK:
+		raise IcosaError(status, "(%d,%d) variant %d" % (b, c, variant))
+	return sizes.variants, sizes.vertices, sizes.faces, sizes.seeds
+
+#---------------------------------------------------------------------------
+def variants(b, c=0):
+#---------------------------------------------------------------------------
+	"""Number of variants of a configuration."""
+	return query(b, c)[0]
+
+#---------------------------------------------------------------------------
+def solve(b, c=0, variant=0, **options):
+#---------------------------------------------------------------------------
+	"""Solve a configuration variant (options: radius, precision, tolerance, kernel, certify)."""
+	return solve_batch([(b, c, variant)], threads=1, **options)[0]
+
+#---------------------------------------------------------------------------
+def solve_batch(jobs, threads=0, **options):
+#---------------------------------------------------------------------------
+	"""Solve a list of (b, c, variant) in parallel (threads <= 0 one per hardware thread).
+
+	The vertices and faces of all the solutions share one pooled array each,
+	every Solution holds views into them.
+	"""
+	opt = _options(**options)
+	jobs = [tuple(job) for job in jobs]
+	sizes = [query(*job)[1:3] for job in jobs]
+	vertices = numpy.empty((sum(n for n, m in sizes), 3), dtype=numpy.float64)
+	faces = numpy.empty((sum(m for n, m in sizes), 3), dtype=numpy.int32)
+	analysis = (ICOSA_ANALYSIS * len(jobs))()
+	job = (ICOSA_JOB * len(jobs))()
+
+	views = []
+	nv = nf = 0
+	for i, ((b, c, variant), (n, m)) in enumerate(zip(jobs, sizes)):
+		v = vertices[nv:nv + n]
+		f = faces[nf:nf + m]
+		job[i].b, job[i].c, job[i].variant = b, c, variant
+		job[i].vertices = v.ctypes.data_as(ctypes.POINTER(ctypes.c_double))
+		job[i].vertex_capacity = n
+		job[i].faces = f.ctypes.data_as(ctypes.POINTER(ctypes.c_int))
+		job[i].face_capacity = m
+		job[i].analysis = ctypes.pointer(analysis[i])
+		views.append((v, f))
+		nv += n
+		nf += m
+
+	_lib.icosa_solve_batch(job, len(jobs), ctypes.byref(opt), threads)
+	for i, (b, c, variant) in enumerate(jobs):
+		if job[i].status != ICOSA_OK:
+			raise IcosaError(job[i].status, "(%d,%d) variant %d" % (b, c, variant))
+	return [Solution(b, c, variant, v, f, analysis[i]) for i, ((b, c, variant), (v, f)) in enumerate(zip(jobs, views))]
+
+#---------------------------------------------------------------------------
+def main():
+#---------------------------------------------------------------------------
+	# solve and certify every configuration in one batch
+	jobs = [(b, 0, v) for b in range(2, 8) for v in range(variants(b))]
+	for s in solve_batch(jobs, certify=True):
+		print("(%d,%d) variant %d: %2d vertices %2d faces, edges %.6f .. %.6f, certified %s" % (s.b, s.c, s.variant,
+			len(s.vertices), len(s.faces), s.edge_min, s.edge_max, s.certified))
+		if s.certified is False:
+			return 1
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
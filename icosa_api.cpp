@@ -0,0 +1,220 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+// icosa_api.cpp : C interface of the solutions (see icosa_api.h).
+//
+#define ICOSA_API_BUILD
+#include <thread>
+#include <atomic>
+#include "icosa_truncations.h"
+#include "icosa_api.h"
+
+typedef struct {
+	ICOSA_JOB				*jobs;
+	int						count;
+	const ICOSA_OPTIONS		*options;
+	std::atomic<int>		next;		// next job to solve
+} BATCH;
+
+static void batch_worker(BATCH *batch);
+
+//---------------------------------------------------------------------------
+int icosa_version(void)
+//---------------------------------------------------------------------------
+{
+	return ICOSA_API_VERSION;
+}
+
+//---------------------------------------------------------------------------
+const char *icosa_status_message(int status)
+//---------------------------------------------------------------------------
+{
+	switch (status) {
+	case ICOSA_OK:				return "ok";
+	case ICOSA_ERROR_ARGUMENT:	return "unsupported configuration, variant or option";
+	case ICOSA_ERROR_BUFFER:	return "buffer too small";
+	case ICOSA_ERROR_SOLVE:		return "iteration did not converge";
+	}
+	return "unknown status";
+}
+
+//---------------------------------------------------------------------------
+void icosa_default_options(ICOSA_OPTIONS *options)
+//---------------------------------------------------------------------------
+{
+	memset(options, 0, sizeof(ICOSA_OPTIONS));
+	options->size = sizeof(ICOSA_OPTIONS);
+	options->radius = 1.0;
+	options->kernel = ICOSA_KERNEL_REFERENCE;
+}
+
+//---------------------------------------------------------------------------
+int icosa_query(int b, int c, int variant, ICOSA_SIZES *sizes)
+//---------------------------------------------------------------------------
+{
+	// buffer sizes of a configuration variant
+	CONFIGURATION	*cfg;
+
+	cfg = configuration_find(b, c);
+	if (!cfg || variant < 0 || variant >= cfg->variants)
+		return ICOSA_ERROR_ARGUMENT;
+
+	sizes->variants = cfg->variants;
+	sizes->vertices = cfg->patch->nv;
+	sizes->faces = cfg->patch->nf;
+	sizes->seeds = (cfg->shared ? 1 : 0) + (cfg->stage[variant] ? 1 : 0);
+	return ICOSA_OK;
+}
+
+//---------------------------------------------------------------------------
+int icosa_solve(int b, int c, int variant, const ICOSA_OPTIONS *options,
+	double *vertices, int vertex_capacity, int *faces, int face_capacity, ICOSA_ANALYSIS *analysis)
+//---------------------------------------------------------------------------
+{
+	// Solve a configuration variant and write the geometry into the caller's
+	// buffers. 'vertices', 'faces' and 'analysis' are optional (0).
+	// The options default to icosa_default_options when 'options' is 0.
+	CONFIGURATION	*cfg;
+	ICOSA_OPTIONS	opt;
+	JOB				job;
+	JOB_RESULT		result;
+	PATCH			*patch;
+	GUT_VECTOR		e;
+	double			d;
+	int				i, k;
+
+	cfg = configuration_find(b, c);
+	if (!cfg || variant < 0 || variant >= cfg->variants)
+		return ICOSA_ERROR_ARGUMENT;
+	patch = cfg->patch;
+	if ((vertices && vertex_capacity < patch->nv) || (faces && face_capacity < patch->nf))
+		return ICOSA_ERROR_BUFFER;
+
+	// options of the caller's version of the structure
+	icosa_default_options(&opt);
+	if (options && options->size <= 0)
+		return ICOSA_ERROR_ARGUMENT;
+	if (options)
+		memcpy(&opt, options, options->size < (int)sizeof(ICOSA_OPTIONS) ? options->size : sizeof(ICOSA_OPTIONS));
+
+	job_init(&job);
+	job.b = b;
+	job.c = c;
+	job.variant = variant;
+	job.radius = opt.radius;
+	job.precision = opt.precision;
+	job.tolerance = opt.tolerance;
+	job.kernel = opt.kernel;
+	job.certify = opt.certify;
+	if (job_solve(&job, &result) != JOB_OK)
+		return result.status; // the job status values are the interface status codes
+
+	if (vertices)
+	{
+		for (i = 0; i < patch->nv; ++i)
+		{
+			vertices[i * 3 + 0] = result.gp[i].x * job.radius;
+			vertices[i * 3 + 1] = result.gp[i].y * job.radius;
+			vertices[i * 3 + 2] = result.gp[i].z * job.radius;
+		}
+	}
+	if (faces)
+	{
+		for (i = 0; i < patch->nf; ++i)
+		{
+			faces[i * 3 + 0] = patch->f[i][0];
+			faces[i * 3 + 1] = patch->f[i][1];
+			faces[i * 3 + 2] = patch->f[i][2];
+		}
+	}
+	if (!analysis)
+		return ICOSA_OK;
+
+	memset(analysis, 0, sizeof(ICOSA_ANALYSIS));
+	analysis->seeds = result.seeds;
+	for (i = 0; i < result.seeds; ++i)
+		analysis->seed[i] = result.seed[i];
+	analysis->residual = result.residual;
+	analysis->certified = result.certified;
+
+	// edge lengths of the triangles
+	analysis->edge_min = DBL_MAX;
+	for (i = 0; i < patch->nf; ++i)
+	{
+		for (k = 0; k < 3; ++k)
+		{
+			gut_vector(&result.gp[patch->f[i][k]], &result.gp[patch->f[i][(k + 1) % 3]], &e);
+			d = sqrt(e.i * e.i + e.j * e.j + e.k * e.k) * job.radius;
+			if (d < analysis->edge_min)
+				analysis->edge_min = d;
+			if (d > analysis->edge_max)
+				analysis->edge_max = d;
+		}
+	}
+	return ICOSA_OK;
+}
+
+//---------------------------------------------------------------------------
+static void batch_worker(BATCH *batch)
+//---------------------------------------------------------------------------
+{
+	// solve jobs until the list is exhausted
+	ICOSA_JOB	*job;
+	int			i;
+
+	while ((i = batch->next++) < batch->count)
+	{
+		job = &batch->jobs[i];
+		job->status = icosa_solve(job->b, job->c, job->variant, batch->options, 
+			job->vertices, job->vertex_capacity, job->faces, job->face_capacity, job->analysis);
+	}
+}
+
+//---------------------------------------------------------------------------
+int icosa_solve_batch(ICOSA_JOB *jobs, int count, const ICOSA_OPTIONS *options, int threads)
+//---------------------------------------------------------------------------
+{
+	// Solve the jobs on 'threads' threads (<= 0 one per hardware thread) with
+	// the same options. Every job receives its own status; the return is 
+	// ICOSA_OK or the status of the first job that failed.
+	std::thread	*worker;
+	BATCH		batch;
+	int			i;
+
+	if (count < 0 || (count && !jobs))
+		return ICOSA_ERROR_ARGUMENT;
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads > count)
+		threads = count;
+
+	batch.jobs = jobs;
+	batch.count = count;
+	batch.options = options;
+	batch.next = 0;
+	if (threads <= 1)
+		batch_worker(&batch);
+	else
+	{
+		worker = new std::thread[threads - 1];
+		for (i = 0; i < threads - 1; ++i)
+			worker[i] = std::thread(batch_worker, &batch);
+		batch_worker(&batch); // the calling thread takes part
+		for (i = 0; i < threads - 1; ++i)
+			worker[i].join();
+		delete[] worker;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		if (jobs[i].status != ICOSA_OK)
+			return jobs[i].status;
+	}
+	return ICOSA_OK;
+}
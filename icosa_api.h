@@ -0,0 +1,108 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	C interface of the icosahedron truncation solutions (icosa_c library).
+
+	The interface only uses C types so it can be called from C, Fortran 
+	(ISO_C_BINDING) or any language with a C foreign function interface.
+	The solver does not allocate memory and does not print. The caller 
+	queries the buffer sizes of a configuration once (icosa_query) and 
+	provides the buffers to every solve (icosa_solve). The functions are 
+	reentrant, all the solver state lives on the stack of the call.
+	icosa_solve_batch solves a list of jobs on a pool of threads.
+
+	Geometry
+		vertices	x,y,z triples in global position (z up) at the radius, 
+					covering LCD area 0 of the icosahedron face like the OFF output
+		faces		triangles as vertex index triples
+
+*/
+#ifndef ICOSA_API_H
+#define ICOSA_API_H
+
+#if defined(_WIN32)
+#if defined(ICOSA_API_BUILD)
+#define ICOSA_API	__declspec(dllexport)
+#else
+#define ICOSA_API	__declspec(dllimport)
+#endif
+#else
+#define ICOSA_API	__attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ICOSA_API_VERSION		2
+
+// status codes
+#define ICOSA_OK				0
+#define ICOSA_ERROR_ARGUMENT	-1	// unsupported configuration, variant or option
+#define ICOSA_ERROR_BUFFER		-2	// a buffer is smaller than the size from icosa_query
+#define ICOSA_ERROR_SOLVE		-3	// an iteration did not converge
+
+#define ICOSA_KERNEL_REFERENCE	0
+#define ICOSA_KERNEL_FAST		1
+
+#define ICOSA_MAX_SEEDS			2	// solved seeds of a variant
+
+// solve options (icosa_default_options)
+typedef struct {
+	int		size;		// sizeof(ICOSA_OPTIONS), for future extension
+	double	radius;		// output sphere radius
+	int		precision;	// > 0: stop once the coordinates are settled at the number of decimals
+	double	tolerance;	// > 0: stop once the coordinates are settled within the length at the radius
+	int		kernel;		// ICOSA_KERNEL_REFERENCE or ICOSA_KERNEL_FAST
+	int		certify;	// certify the solved seeds with interval arithmetic
+} ICOSA_OPTIONS;
+
+// buffer sizes of a configuration variant (icosa_query)
+typedef struct {
+	int		variants;	// number of variants of the configuration
+	int		vertices;	// number of vertices (3 doubles each)
+	int		faces;		// number of triangles (3 ints each)
+	int		seeds;		// number of solved seeds
+} ICOSA_SIZES;
+
+// analysis of a solve
+typedef struct {
+	int		seeds;					// number of solved seeds
+	double	seed[ICOSA_MAX_SEEDS];	// solved seeds (radians)
+	double	residual;				// largest final residual of the iterations (radians)
+	double	edge_min, edge_max;		// shortest and longest edge of the triangles at the radius
+	int		certified;				// 1 all seeds certified unique roots, 0 not certified, -1 not requested
+} ICOSA_ANALYSIS;
+
+// job of a batch solve (icosa_solve_batch), buffers as icosa_solve
+typedef struct {
+	int				b, c, variant;		// configuration variant
+	double			*vertices;
+	int				vertex_capacity;
+	int				*faces;
+	int				face_capacity;
+	ICOSA_ANALYSIS	*analysis;
+	int				status;				// set by the solve
+} ICOSA_JOB;
+
+ICOSA_API int icosa_version(void);
+ICOSA_API const char *icosa_status_message(int status);
+ICOSA_API void icosa_default_options(ICOSA_OPTIONS *options);
+ICOSA_API int icosa_query(int b, int c, int variant, ICOSA_SIZES *sizes);
+ICOSA_API int icosa_solve(int b, int c, int variant, const ICOSA_OPTIONS *options,
+	double *vertices, int vertex_capacity, int *faces, int face_capacity, ICOSA_ANALYSIS *analysis);
+ICOSA_API int icosa_solve_batch(ICOSA_JOB *jobs, int count, const ICOSA_OPTIONS *options, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
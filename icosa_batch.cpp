@@ -0,0 +1,678 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Sharded batch execution of a manifest of jobs.
+
+	The manifest lists one job per line. Every job is assigned to a shard by
+	the hash of its normalized text, so any process reading the same manifest
+	computes the same split without coordination. A process claims a shard by
+	creating its claim file exclusively in the shared result directory, solves
+	the jobs of the shard and writes every result atomically (synced temporary
+	file and rename): <hash>.off with the geometry and <hash>.res with the solve 
+	status. The merge step collects the results in manifest order into 
+	results.txt and reports the jobs without a result.
+
+	Every shard keeps an append-only journal of the jobs it started and 
+	completed. The journal is synced to disk in batches (JOURNAL_SYNC_*), a 
+	crash loses at most the last batch of records and those jobs are solved
+	again. A resumed shard skips the completed jobs and re-queues the jobs 
+	that were in flight. Resuming takes the shard over without a claim, so 
+	the process that ran it must be gone: nothing stops two processes that 
+	resume or run the same shard from solving its jobs twice.
+
+	Only plain files are used, so the shards can run on any nodes that share 
+	the result directory.
+
+*/
+// icosa_batch.cpp : Defines the batch manifest, shard and merge functions (library).
+//
+#include <algorithm>
+#include <sys/stat.h>
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include "icosa_truncations.h"
+
+#if defined(_WIN32)
+#define batch_mkdir(d)			_mkdir(d)
+#define batch_getpid()			_getpid()
+#define batch_open_excl(f)		_open(f, _O_CREAT | _O_EXCL | _O_WRONLY, _S_IREAD | _S_IWRITE)
+#define batch_close(fd)			_close(fd)
+#define batch_fsync(fp)			_commit(_fileno(fp))
+#else
+#define batch_mkdir(d)			mkdir(d, 0777)
+#define batch_getpid()			getpid()
+#define batch_open_excl(f)		open(f, O_CREAT | O_EXCL | O_WRONLY, 0666)
+#define batch_close(fd)			close(fd)
+#define batch_fsync(fp)			fsync(fileno(fp))
+#endif
+
+#define BATCH_MISSING	1		// merge status of a job without a result file
+
+//---------------------------------------------------------------------------
+int job_parse(char *line, JOB *job)
+//---------------------------------------------------------------------------
+{
+	// Parse a manifest line into a job (see MANIFEST). Returns 1 for a job,
+	// 0 for a blank or comment line and -1 for a malformed line.
+	char	*p, *end, *word;
+	long	n[3];
+	int		i;
+
+	job_init(job);
+	if ((p = strchr(line, '#')) != 0)
+		*p = 0;
+	for (p = line; *p == ' ' || *p == '\t'; ++p)
+		;
+	if (!*p || *p == '\r' || *p == '\n')
+		return 0;
+
+	// configuration variant
+	for (i = 0; i < 3; ++i)
+	{
+		n[i] = strtol(p, &end, 10);
+		if (end == p)
+			return -1;
+		p = end;
+	}
+	job->b = (int)n[0];
+	job->c = (int)n[1];
+	job->variant = (int)n[2];
+
+	// options
+	for (;;)
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+			++p;
+		if (!*p)
+			break;
+		word = p;
+		while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			++p;
+		if (*p)
+			*p++ = 0;
+
+		if (!strncmp(word, "radius=", 7))
+			job->radius = atof(word + 7);
+		else if (!strncmp(word, "precision=", 10))
+			job->precision = atoi(word + 10);
+		else if (!strncmp(word, "tolerance=", 10))
+			job->tolerance = atof(word + 10);
+		else if (!strncmp(word, "kernel=", 7))
+		{
+			job->kernel = kernel_find(word + 7);
+			if (job->kernel < 0)
+				return -1;
+		}
+		else if (!strcmp(word, "certify"))
+			job->certify = 1;
+		else
+			return -1;
+	}
+	return job->radius > 0 ? 1 : -1;
+}
+
+//---------------------------------------------------------------------------
+void job_key(JOB *job, char *key, int size)
+//---------------------------------------------------------------------------
+{
+	// normalized text of a job, equal jobs have equal keys whatever their manifest spelling
+	sprintf_s(key, size, "%d %d %d radius=%.17g precision=%d tolerance=%.17g kernel=%s%s",
+		job->b, job->c, job->variant, job->radius, job->precision, job->tolerance, 
+		kernel_table[job->kernel].name, job->certify ? " certify" : "");
+}
+
+//---------------------------------------------------------------------------
+unsigned long long job_hash(char *key)
+//---------------------------------------------------------------------------
+{
+	// 64 bit FNV-1a hash of the job key (stable across processes and platforms)
+	unsigned long long	h;
+
+	for (h = FNV_OFFSET; *key; ++key)
+		h = (h ^ (unsigned char)*key) * FNV_PRIME;
+	return h;
+}
+
+//---------------------------------------------------------------------------
+int manifest_read(char *filename, MANIFEST *manifest)
+//---------------------------------------------------------------------------
+{
+	// Read and normalize the jobs of a manifest file. Returns 0 or -1 when the
+	// file cannot be read, a line is malformed or the jobs do not fit in 
+	// memory (reported).
+	MANIFEST_JOB	*mj;
+	FILE			*fp;
+	char			line[512];
+	int				n, size, r;
+
+	memset(manifest, 0, sizeof(MANIFEST));
+	manifest->filename = filename;
+	fopen_s(&fp, filename, "r");
+	if (!fp)
+	{
+		LOG(LOG_ERROR, "manifest", "cannot read manifest: %s", filename);
+		return -1;
+	}
+
+	size = 0;
+	for (n = 1; fgets(line, sizeof(line), fp); ++n)
+	{
+		if (manifest->count == size)
+		{
+			size = size ? size * 2 : 64;
+			mj = (MANIFEST_JOB*)realloc(manifest->job, size * sizeof(MANIFEST_JOB));
+			if (!mj)
+			{
+				LOG(LOG_ERROR, "no_memory", "%s(%d): no memory for %d jobs", filename, n, size);
+				fclose(fp);
+				manifest_free(manifest);
+				return -1;
+			}
+			manifest->job = mj;
+		}
+		mj = &manifest->job[manifest->count];
+		r = job_parse(line, &mj->job);
+		if (r < 0)
+		{
+			LOG(LOG_ERROR, "manifest", "%s(%d): malformed job", filename, n);
+			fclose(fp);
+			manifest_free(manifest);
+			return -1;
+		}
+		if (!r)
+			continue;
+		job_key(&mj->job, mj->key, MANIFEST_KEY);
+		mj->hash = job_hash(mj->key);
+		mj->line = n;
+		++manifest->count;
+	}
+	fclose(fp);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void manifest_free(MANIFEST *manifest)
+//---------------------------------------------------------------------------
+{
+	free(manifest->job);
+	manifest->job = 0;
+	manifest->count = 0;
+}
+
+//---------------------------------------------------------------------------
+int file_replace(char *tmpname, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Atomically replace 'filename' by the completed temporary file (same 
+	// directory). Readers see either the old or the new file, never a part.
+	if (!rename(tmpname, filename))
+		return 0;
+#if defined(_WIN32)
+	// rename does not replace an existing file on Windows
+	remove(filename);
+	if (!rename(tmpname, filename))
+		return 0;
+#endif
+	remove(tmpname);
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+int file_commit(FILE *fp, char *tmpname, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Sync and close a temporary file written through fp and replace 
+	// 'filename' by it. Returns 0 or -1 (the temporary file is removed).
+	if (fflush(fp) || batch_fsync(fp))
+	{
+		fclose(fp);
+		remove(tmpname);
+		return -1;
+	}
+	if (fclose(fp))
+	{
+		remove(tmpname);
+		return -1;
+	}
+	return file_replace(tmpname, filename);
+}
+
+//---------------------------------------------------------------------------
+int dir_sync(char *dir)
+//---------------------------------------------------------------------------
+{
+	// Sync a directory so the files renamed into it survive a crash. Returns 
+	// 0 or -1. Windows has no directory sync, its renames go with the files.
+#if defined(_WIN32)
+	return 0;
+#else
+	int		fd, status;
+
+	fd = open(dir, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	status = fsync(fd);
+	close(fd);
+	return status ? -1 : 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+int batch_claim(char *dir, int shard, int shards)
+//---------------------------------------------------------------------------
+{
+	// Claim a shard by creating its claim file exclusively. Returns 1 when this
+	// process owns the shard, 0 when another process claimed it before.
+	char	filename[BATCH_PATH];
+	char	text[64];
+	int		fd, n;
+
+	batch_mkdir(dir);
+	sprintf_s(filename, sizeof(filename), "%s/shard_%d_of_%d.claim", dir, shard, shards);
+	fd = batch_open_excl(filename);
+	if (fd < 0)
+		return 0;
+	n = sprintf_s(text, sizeof(text), "pid %d\n", (int)batch_getpid());
+#if defined(_WIN32)
+	_write(fd, text, n);
+#else
+	if (write(fd, text, n) != n)
+		n = 0;
+#endif
+	batch_close(fd);
+	return 1;
+}
+
+//---------------------------------------------------------------------------
+int batch_closed(char *dir, int shard, int shards)
+//---------------------------------------------------------------------------
+{
+	// 1 when the journal of the shard shows it ran to the end, or when it 
+	// could not be replayed (not taken over)
+	JOURNAL_STATE	state;
+	int				closed;
+
+	closed = journal_read(dir, shard, shards, &state);
+	if (closed)
+		return closed == -2;
+	closed = state.closed;
+	journal_free(&state);
+	return closed;
+}
+
+//---------------------------------------------------------------------------
+char *batch_result_file(char *dir, char *name, char *filename, int size)
+//---------------------------------------------------------------------------
+{
+	// The file of a solution named on the command line: the file of that 
+	// name, else the result of the job it names in the manifest syntax (for
+	// example "7 0 0 certify") in the result directory, else the name.
+	JOB		job;
+	FILE	*fp;
+	char	line[512], key[MANIFEST_KEY];
+
+	fopen_s(&fp, name, "r");
+	if (fp)
+	{
+		fclose(fp);
+		return name;
+	}
+	sprintf_s(line, sizeof(line), "%s", name);
+	if (job_parse(line, &job) <= 0)
+		return name;
+	job_key(&job, key, sizeof(key));
+	sprintf_s(filename, size, "%s/%016llx.res", dir, job_hash(key));
+	return filename;
+}
+
+//---------------------------------------------------------------------------
+int batch_write_result(char *dir, MANIFEST_JOB *mj, JOB_RESULT *result, int shard)
+//---------------------------------------------------------------------------
+{
+	// Write the geometry and the status of a solved job. The status file is
+	// written last, its presence marks a complete result. Both files and 
+	// their directory entries are on the disk before this returns, so the 
+	// journal never records a job done whose result a crash could lose. 
+	// Returns 0 or -1.
+	char	filename[BATCH_PATH], tmpname[BATCH_PATH + 32];
+	FILE	*fp;
+	int		i, pid;
+
+	pid = (int)batch_getpid();
+	if (result->status == JOB_OK)
+	{
+		sprintf_s(filename, sizeof(filename), "%s/%016llx.off", dir, mj->hash);
+		sprintf_s(tmpname, sizeof(tmpname), "%s.%d.%d.tmp", filename, shard, pid);
+		fopen_s(&fp, tmpname, "w");
+		if (!fp)
+			return -1;
+		patch_write_off(fp, result->patch, result->gp, mj->job.radius);
+		if (file_commit(fp, tmpname, filename))
+			return -1;
+	}
+
+	sprintf_s(filename, sizeof(filename), "%s/%016llx.res", dir, mj->hash);
+	sprintf_s(tmpname, sizeof(tmpname), "%s.%d.%d.tmp", filename, shard, pid);
+	fopen_s(&fp, tmpname, "w");
+	if (!fp)
+		return -1;
+	fprintf(fp, "%s\n", mj->key);
+	fprintf(fp, "%d %d %.17g %d", result->status, result->certified, result->residual, result->seeds);
+	for (i = 0; i < result->seeds; ++i)
+		fprintf(fp, " %.17g", result->seed[i]);
+	fprintf(fp, "\n");
+	if (file_commit(fp, tmpname, filename))
+		return -1;
+	return dir_sync(dir);
+}
+
+//---------------------------------------------------------------------------
+int batch_run(MANIFEST *manifest, char *dir, int shard, int shards, int resume)
+//---------------------------------------------------------------------------
+{
+	// Solve the jobs of one shard into the result directory. A resumed shard
+	// skips the jobs its journal completed and solves its jobs in flight 
+	// again, the caller must own the shard exclusively (see above). Returns 
+	// the number of jobs that failed or could not be written.
+	JOB_RESULT		result;
+	JOURNAL			journal;
+	JOURNAL_STATE	state;
+	MANIFEST_JOB	*mj;
+	int				i, n, skipped, failed;
+
+	memset(&state, 0, sizeof(JOURNAL_STATE));
+	n = resume ? journal_read(dir, shard, shards, &state) : -1;
+	if (n == -2)
+		return 1;
+	if (!n)
+		LOG(LOG_NOTE, "resume", "Shard %d of %d: resuming, %d jobs completed, %d in flight re-queued", shard, shards, state.count, state.inflight);
+	if (journal_open(&journal, dir, shard, shards))
+	{
+		LOG(LOG_NOTE, "journal", "NOTE: shard %d of %d: cannot write the journal in %s", shard, shards, dir);
+		journal_free(&state);
+		return 1;
+	}
+
+	for (i = n = skipped = failed = 0; i < manifest->count; ++i)
+	{
+		mj = &manifest->job[i];
+		if ((int)(mj->hash % (unsigned long long)shards) != shard)
+			continue;
+		++n;
+		if (journal_done(&state, mj->hash))
+		{
+			++skipped;
+			continue;
+		}
+
+		journal_record(&journal, "start", mj->hash, 0);
+		if (job_solve(&mj->job, &result) != JOB_OK)
+		{
+			LOG(LOG_NOTE, "job_failed", "NOTE: %s(%d): %s not solved", manifest->filename, mj->line, mj->key);
+			++failed;
+		}
+		if (batch_write_result(dir, mj, &result, shard))
+		{
+			LOG(LOG_NOTE, "result", "NOTE: %s(%d): %s result not written", manifest->filename, mj->line, mj->key);
+			++failed;
+		}
+		else
+			journal_record(&journal, "done", mj->hash, result.status);
+	}
+	journal_close(&journal, n, failed);
+	journal_free(&state);
+	log_flush(); // the records of the shard before its summary
+	printf("Shard %d of %d: %d jobs, %d skipped, %d failed\n", shard, shards, n, skipped, failed);
+	return failed;
+}
+
+//---------------------------------------------------------------------------
+int journal_open(JOURNAL *journal, char *dir, int shard, int shards)
+//---------------------------------------------------------------------------
+{
+	// open the journal of a shard for appending, returns 0 or -1
+	char	filename[BATCH_PATH];
+
+	batch_mkdir(dir);
+	sprintf_s(filename, sizeof(filename), "%s/shard_%d_of_%d.journal", dir, shard, shards);
+	fopen_s(&journal->fp, filename, "a");
+	journal->pending = 0;
+	journal->synced = clock_seconds();
+	return journal->fp ? 0 : -1;
+}
+
+//---------------------------------------------------------------------------
+void journal_record(JOURNAL *journal, char *type, unsigned long long hash, int value)
+//---------------------------------------------------------------------------
+{
+	// append a job record, the records reach the disk in batches
+	if (!strcmp(type, "done"))
+		fprintf(journal->fp, "%s %016llx %d\n", type, hash, value);
+	else
+		fprintf(journal->fp, "%s %016llx\n", type, hash);
+	++journal->pending;
+	journal_sync(journal, 0);
+}
+
+//---------------------------------------------------------------------------
+void journal_sync(JOURNAL *journal, int force)
+//---------------------------------------------------------------------------
+{
+	// Sync the pending records once enough of them accumulated or enough time
+	// passed since the last sync (or when forced). One sync covers the whole batch.
+	double	now;
+
+	if (!journal->pending)
+		return;
+	now = clock_seconds();
+	if (!force && journal->pending < JOURNAL_SYNC_RECORDS && now - journal->synced < JOURNAL_SYNC_SECONDS)
+		return;
+	fflush(journal->fp);
+	batch_fsync(journal->fp);
+	journal->pending = 0;
+	journal->synced = now;
+}
+
+//---------------------------------------------------------------------------
+void journal_close(JOURNAL *journal, int jobs, int failed)
+//---------------------------------------------------------------------------
+{
+	// mark the shard as run to the end and sync
+	fprintf(journal->fp, "end %d %d\n", jobs, failed);
+	++journal->pending;
+	journal_sync(journal, 1);
+	fclose(journal->fp);
+	journal->fp = 0;
+}
+
+//---------------------------------------------------------------------------
+int journal_read(char *dir, int shard, int shards, JOURNAL_STATE *state)
+//---------------------------------------------------------------------------
+{
+	// Replay the journal of a shard (all the runs of the shard appended). 
+	// A torn last record of a crash is ignored. Returns 0, -1 without journal
+	// or -2 when its records do not fit in memory (reported).
+	unsigned long long	*started, *grown, hash;
+	FILE				*fp;
+	char				filename[BATCH_PATH], line[128], type[8];
+	int					i, nstarted, size, ssize, status, nomemory;
+
+	memset(state, 0, sizeof(JOURNAL_STATE));
+	sprintf_s(filename, sizeof(filename), "%s/shard_%d_of_%d.journal", dir, shard, shards);
+	fopen_s(&fp, filename, "r");
+	if (!fp)
+		return -1;
+
+	started = 0;
+	nstarted = size = ssize = nomemory = 0;
+	while (!nomemory && fgets(line, sizeof(line), fp))
+	{
+		if (!strchr(line, '\n'))
+			break; // torn record
+		if (!strncmp(line, "end ", 4))
+		{
+			state->closed = 1;
+			continue;
+		}
+		state->closed = 0;
+		if (sscanf(line, "%7s %llx %d", type, &hash, &status) < 2)
+			continue;
+		if (!strcmp(type, "done"))
+		{
+			if (state->count == size)
+			{
+				size = size ? size * 2 : 256;
+				grown = (unsigned long long*)realloc(state->done, size * sizeof(unsigned long long));
+				if (!grown)
+				{
+					nomemory = 1;
+					continue;
+				}
+				state->done = grown;
+			}
+			state->done[state->count++] = hash;
+		}
+		else if (!strcmp(type, "start"))
+		{
+			if (nstarted == ssize)
+			{
+				ssize = ssize ? ssize * 2 : 256;
+				grown = (unsigned long long*)realloc(started, ssize * sizeof(unsigned long long));
+				if (!grown)
+				{
+					nomemory = 1;
+					continue;
+				}
+				started = grown;
+			}
+			started[nstarted++] = hash;
+		}
+	}
+	fclose(fp);
+	if (nomemory)
+	{
+		LOG(LOG_ERROR, "no_memory", "%s: no memory for the journal records", filename);
+		free(started);
+		journal_free(state);
+		return -2;
+	}
+
+	// completed jobs for the lookup, in flight jobs are the started ones not completed
+	std::sort(state->done, state->done + state->count);
+	state->count = (int)(std::unique(state->done, state->done + state->count) - state->done);
+	std::sort(started, started + nstarted);
+	nstarted = (int)(std::unique(started, started + nstarted) - started);
+	for (i = 0; i < nstarted; ++i)
+	{
+		if (!journal_done(state, started[i]))
+			++state->inflight;
+	}
+	free(started);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int journal_done(JOURNAL_STATE *state, unsigned long long hash)
+//---------------------------------------------------------------------------
+{
+	// 1 when the replayed journal completed the job
+	return state->count && std::binary_search(state->done, state->done + state->count, hash);
+}
+
+//---------------------------------------------------------------------------
+void journal_free(JOURNAL_STATE *state)
+//---------------------------------------------------------------------------
+{
+	free(state->done);
+	memset(state, 0, sizeof(JOURNAL_STATE));
+}
+
+//---------------------------------------------------------------------------
+int batch_merge(MANIFEST *manifest, char *dir)
+//---------------------------------------------------------------------------
+{
+	// Collect the job results in manifest order into <dir>/results.txt:
+	//	line b c variant status certified residual seeds (degrees) geometry file
+	// Returns the number of jobs without a successful result.
+	MANIFEST_JOB	*mj;
+	FILE			*fp, *fr;
+	char			filename[BATCH_PATH], tmpname[BATCH_PATH + 32], text[512];
+	double			residual, seed[CONFIGURATION_SEEDS];
+	int				i, k, status, certified, seeds, missing, failed;
+
+	sprintf_s(filename, sizeof(filename), "%s/results.txt", dir);
+	sprintf_s(tmpname, sizeof(tmpname), "%s.%d.tmp", filename, (int)batch_getpid());
+	fopen_s(&fp, tmpname, "w");
+	if (!fp)
+	{
+		LOG(LOG_ERROR, "merge", "cannot write %s", filename);
+		return manifest->count ? manifest->count : 1;
+	}
+
+	fprintf(fp, "# %s: %d jobs\n", manifest->filename, manifest->count);
+	for (i = missing = failed = 0; i < manifest->count; ++i)
+	{
+		mj = &manifest->job[i];
+		sprintf_s(text, sizeof(text), "%s/%016llx.res", dir, mj->hash);
+		fopen_s(&fr, text, "r");
+		seeds = 0;
+		status = BATCH_MISSING;
+		if (fr)
+		{
+			// the key guards against a stale result of another manifest with a colliding hash
+			if (fgets(text, sizeof(text), fr))
+			{
+				text[strcspn(text, "\r\n")] = 0;
+				if (!strcmp(text, mj->key) && fscanf(fr, "%d %d %lf %d", &status, &certified, &residual, &seeds) != 4)
+					status = BATCH_MISSING;
+				for (k = 0; status != BATCH_MISSING && k < seeds && k < CONFIGURATION_SEEDS; ++k)
+				{
+					if (fscanf(fr, "%lf", &seed[k]) != 1)
+						status = BATCH_MISSING;
+				}
+			}
+			fclose(fr);
+		}
+
+		fprintf(fp, "%d\t%s\t", mj->line, mj->key);
+		if (status == BATCH_MISSING)
+		{
+			fprintf(fp, "missing\n");
+			++missing;
+			continue;
+		}
+		if (status != JOB_OK)
+		{
+			fprintf(fp, "failed %d\n", status);
+			++failed;
+			continue;
+		}
+		fprintf(fp, "ok %d %.3e", certified, residual);
+		for (k = 0; k < seeds && k < CONFIGURATION_SEEDS; ++k)
+			fprintf(fp, " %.12f", RTD(seed[k]));
+		fprintf(fp, "\t%016llx.off\n", mj->hash);
+	}
+
+	if (fclose(fp) || file_replace(tmpname, filename))
+	{
+		LOG(LOG_ERROR, "merge", "cannot write %s", filename);
+		return manifest->count ? manifest->count : 1;
+	}
+	log_flush();
+	printf("Merged %d jobs into %s: %d missing, %d failed\n", manifest->count, filename, missing, failed);
+	return missing + failed;
+}
@@ -0,0 +1,223 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+// icosa_bench.cpp : Benchmark of the truncation solutions.
+//
+// Every configuration is solved end to end (without console or geometry output)
+// a number of times and the average time per solve is reported, either with the
+// solution functions or through the C interface (-api) into pooled buffers.
+// -kernels times the batch kernels of every instruction set variant instead.
+// The same runs train the profile guided build (see CMakeLists.txt).
+//
+#include <chrono>
+#include "icosa_truncations.h"
+#include "icosa_api.h"
+
+typedef int SOLUTION(PROGRAM*, char*);
+
+typedef struct {
+	char		*name;
+	int			b;			// configuration (b,0)
+	SOLUTION	*solution;
+} BENCH_CASE;
+
+BENCH_CASE bench_case[] = {
+	{ "(2,0)", 2, classI_2v_solution },
+	{ "(3,0)", 3, classI_3v_solution },
+	{ "(4,0)", 4, classI_4v_solution },
+	{ "(5,0)", 5, classI_5v_solution },
+	{ "(6,0) A,B", 6, classI_6v_solution },
+	{ "(7,0) A,B,C", 7, classI_7v_solution },
+};
+
+#define BENCH_REPETITIONS	200		// default number of solves per configuration
+#define BENCH_ELEMENTS		4096	// elements per batch kernel call (-kernels)
+
+double bench_time(PROGRAM *pgm, SOLUTION *solution, int repetitions);
+double bench_api_time(PROGRAM *pgm, int b, int repetitions);
+void bench_kernels(int repetitions, int forced);
+int main(int ac, char **av);
+
+//---------------------------------------------------------------------------
+double bench_time(PROGRAM *pgm, SOLUTION *solution, int repetitions)
+//---------------------------------------------------------------------------
+{
+	// average time of a solve in seconds
+	std::chrono::steady_clock::time_point	start;
+	std::chrono::duration<double>			elapsed;
+	int										i;
+
+	start = std::chrono::steady_clock::now();
+	for (i = 0; i < repetitions; ++i)
+		solution(pgm, "bench");
+	elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / repetitions;
+}
+
+//---------------------------------------------------------------------------
+double bench_api_time(PROGRAM *pgm, int b, int repetitions)
+//---------------------------------------------------------------------------
+{
+	// average time in seconds to solve all the variants of a configuration 
+	// through the C interface, with the options taken from the program
+	std::chrono::steady_clock::time_point	start;
+	std::chrono::duration<double>			elapsed;
+	ICOSA_OPTIONS							options;
+	ICOSA_SIZES								sizes;
+	ICOSA_ANALYSIS							analysis;
+	double									vertices[20 * 3];
+	int										faces[20 * 3];
+	int										i, v;
+
+	icosa_default_options(&options);
+	options.kernel = pgm->kernel;
+	if (pgm->stop.mode == BUILD_STOP_PRECISION)
+		options.tolerance = pgm->stop.resolution;
+	if (icosa_query(b, 0, 0, &sizes) != ICOSA_OK)
+		return 0;
+
+	start = std::chrono::steady_clock::now();
+	for (i = 0; i < repetitions; ++i)
+	{
+		for (v = 0; v < sizes.variants; ++v)
+		{
+			if (icosa_solve(b, 0, v, &options, vertices, 20, faces, 20, &analysis) != ICOSA_OK)
+				printf("NOTE: (%d,0) variant %d not solved\n", b, v);
+		}
+	}
+	elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / repetitions;
+}
+
+//---------------------------------------------------------------------------
+void bench_kernels(int repetitions, int forced)
+//---------------------------------------------------------------------------
+{
+	// Time per element of the batch kernels for every instruction set variant 
+	// the processor supports or the forced one (-1 none), calls of 
+	// BENCH_ELEMENTS triangles, coordinates and points (the samples of the 
+	// differential test).
+	std::chrono::steady_clock::time_point	start;
+	std::chrono::duration<double>			elapsed[3];
+	unsigned long long						state;
+	double									*v, *in[3], *out[3];
+	int										i, k, isa;
+
+	v = (double*)malloc(6 * BENCH_ELEMENTS * sizeof(double));
+	if (!v)
+		return;
+	for (k = 0; k < 3; ++k)
+	{
+		in[k] = v + k * BENCH_ELEMENTS;
+		out[k] = v + (3 + k) * BENCH_ELEMENTS;
+	}
+	printf("%-10s %14s %14s %14s (ns per element)\n", "variant", "sph_tri_bcC", "sph_to_cart", "cart_to_sph");
+	for (isa = 0; isa <= kernel_isa_best(); ++isa)
+	{
+		if (!kernel_isa_table[isa].supported() || (forced >= 0 && isa != forced))
+			continue;
+		state = DIFFTEST_SEED;
+		for (i = 0; i < BENCH_ELEMENTS; ++i)
+		{
+			in[0][i] = difftest_uniform(&state, DTR(1.0), DTR(179.0));
+			in[1][i] = difftest_uniform(&state, DTR(1.0), DTR(179.0));
+			in[2][i] = difftest_uniform(&state, DTR(1.0), DTR(179.0));
+		}
+		start = std::chrono::steady_clock::now();
+		for (i = 0; i < repetitions; ++i)
+			kernel_isa_table[isa].sph_tri_bcC_batch(BENCH_ELEMENTS, in[0], in[1], in[2], out[0], out[1], out[2]);
+		elapsed[0] = std::chrono::steady_clock::now() - start;
+		start = std::chrono::steady_clock::now();
+		for (i = 0; i < repetitions; ++i)
+			kernel_isa_table[isa].spherical_to_cartesian_batch(BENCH_ELEMENTS, in[0], in[1], in[2], out[0], out[1], out[2]);
+		elapsed[1] = std::chrono::steady_clock::now() - start;
+		start = std::chrono::steady_clock::now();
+		for (i = 0; i < repetitions; ++i)
+			kernel_isa_table[isa].cartesian_to_spherical_batch(BENCH_ELEMENTS, out[0], out[1], out[2], in[0], in[1], in[2]);
+		elapsed[2] = std::chrono::steady_clock::now() - start;
+		printf("%-10s %14.2f %14.2f %14.2f\n", kernel_isa_table[isa].name, elapsed[0].count() * 1e9 / repetitions / BENCH_ELEMENTS, 
+			elapsed[1].count() * 1e9 / repetitions / BENCH_ELEMENTS, elapsed[2].count() * 1e9 / repetitions / BENCH_ELEMENTS);
+	}
+	free(v);
+}
+
+//---------------------------------------------------------------------------
+int main(int ac, char **av)
+//---------------------------------------------------------------------------
+{
+	PROGRAM	pgm;
+	int		i, repetitions, api, kernels;
+	char	*isa;
+	double	t, total;
+
+	program_init(&pgm);
+	pgm.quiet = 1;
+	repetitions = BENCH_REPETITIONS;
+	api = 0;
+	kernels = 0;
+	isa = 0;
+
+	// command line options
+	for (i = 1; i < ac; ++i)
+	{
+		if (av[i][0] >= '0' && av[i][0] <= '9')
+			repetitions = atoi(av[i]); // solves per configuration
+		else if (!strcmp(av[i], "-serial"))
+			pgm.parallel = 0;
+		else if (!strcmp(av[i], "-api"))
+			api = 1; // solve through the C interface
+		else if (!strcmp(av[i], "-kernels"))
+			kernels = 1; // time the batch kernels instead of the solutions
+		else if (!strcmp(av[i], "-isa") && i + 1 < ac)
+			isa = av[++i]; // force the instruction set variant of the batch kernels
+		else if (!strcmp(av[i], "-precision") && i + 1 < ac)
+		{
+			pgm.stop.mode = BUILD_STOP_PRECISION;
+			pgm.stop.resolution = 0.5 * pow(10.0, -atof(av[++i]));
+		}
+		else if (!strcmp(av[i], "-kernel") && i + 1 < ac)
+		{
+			pgm.kernel = kernel_find(av[++i]);
+			if (pgm.kernel < 0)
+			{
+				printf("unknown kernel: %s\n", av[i]);
+				return 1;
+			}
+		}
+	}
+	if (repetitions < 1)
+		repetitions = 1;
+	if (isa && kernel_isa_select(isa) < 0)
+	{
+		printf("instruction set not available: %s\n", isa);
+		return KERNEL_ISA_UNAVAILABLE;
+	}
+	if (kernels)
+	{
+		printf("Benchmark: batch kernels, %d calls of %d elements\n", repetitions, BENCH_ELEMENTS);
+		bench_kernels(repetitions, isa ? kernel_isa : -1);
+		return 0;
+	}
+
+	printf("Benchmark: %d solves per configuration, kernel %s%s%s\n", repetitions,
+		kernel_table[pgm.kernel].name, pgm.parallel ? "" : ", serial", api ? ", C interface" : "");
+	printf("%-16s %14s\n", "configuration", "us per solve");
+	total = 0;
+	for (i = 0; i < (int)(sizeof(bench_case) / sizeof(BENCH_CASE)); ++i)
+	{
+		if (api)
+			t = bench_api_time(&pgm, bench_case[i].b, repetitions);
+		else
+			t = bench_time(&pgm, bench_case[i].solution, repetitions);
+		total += t;
+		printf("%-16s %14.2f\n", bench_case[i].name, t * 1e6);
+	}
+	printf("%-16s %14.2f\n", "total", total * 1e6);
+	return 0;
+}
@@ -0,0 +1,831 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Constraint sets.
+
+	The stages of the configurations are hand written functions with one
+	seed and one residual each (classI_6v_a places vertex 4,0 and returns
+	the inclination difference of 4,1 and 1,1). A constraint set describes
+	the same as data: vertex placements whose parameters are fixed, free or
+	tied to the inclination of another vertex, and constraints on the placed
+	vertices - equal levels, fixed levels, equal edges and coplanar groups.
+	One solver handles every set, all the free parameters at once.
+
+	The residuals are evaluated for a batch of parameter vectors: the
+	vertices are placed for every vector, the referenced points gathered
+	into arrays and every constraint evaluated over the batch in one loop.
+	The solver (Levenberg-Marquardt) takes the jacobian by forward
+	differences from one batch of n + 1 vectors, design space scans batch
+	their vectors the same way.
+
+	A set can be read from a text file, one item per line (# comments):
+
+		config b c
+		place v a sc azimuth inclination
+		place v a from vs as b C
+		level v a inclination
+		level_equal v a v a
+		edge_equal v a v a v a v a
+		coplanar v a v a v a v a [v a ...]
+
+	A parameter is a value, free:value (initial value of a variable) or
+	level:v,a (the inclination of that vertex). Values are sums of degrees
+	and multiples of the reference triangle sides: 36, 2b+c, 2a+2c-0.5.
+
+*/
+// icosa_constraint.cpp : Defines the constraint sets and their solver (library).
+//
+#include "icosa_truncations.h"
+
+#define CONSTRAINT_STEP		1e-7	// finite difference step of the jacobian (radians)
+#define CONSTRAINT_DAMPING	1e-3	// initial damping of the solver (relative to the diagonal)
+#define CONSTRAINT_RETRIES	16		// damping increases before the solver gives up
+
+static int constraint_refs(CONSTRAINT *con);
+static int constraint_slots(CONSTRAINT_SET *set, int *slot);
+static void constraint_fetch(PROGRAM *pgm, int *slot, double *state, int count, VERTEX_REF *ref, int k, double *out);
+static void constraint_place_batch(PROGRAM *pgm, CONSTRAINT_SET *set, int count, double *var, int *slot, double *state, double *work);
+static int constraint_value(char *word, PROGRAM *pgm, double *value);
+static int constraint_param(char *word, PROGRAM *pgm, PARAM *param);
+static int constraint_linear(int n, double *a, double *b);
+
+//---------------------------------------------------------------------------
+static int constraint_refs(CONSTRAINT *con)
+//---------------------------------------------------------------------------
+{
+	// number of references of a constraint kind (at least, coplanar), 0 unknown kind
+	switch (con->kind)
+	{
+	case CONSTRAINT_LEVEL:			return 1;
+	case CONSTRAINT_LEVEL_EQUAL:	return 2;
+	case CONSTRAINT_EDGE_EQUAL:		return 4;
+	case CONSTRAINT_COPLANAR:		return 4;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int constraint_size(CONSTRAINT_SET *set, int *residuals)
+//---------------------------------------------------------------------------
+{
+	// Number of variables (free parameters) of a set and its residuals.
+	// Returns -1 for a malformed set.
+	CONSTRAINT	*con;
+	PLACEMENT	*pl;
+	VERTEX_REF	*r;
+	int			i, k, n;
+
+	*residuals = 0;
+	if (!configuration_find(set->b, set->c) || set->nplace < 0 || set->nplace > CONSTRAINT_PLACEMENTS || set->ncon < 0 || set->ncon > CONSTRAINT_MAX)
+		return -1;
+	for (i = n = 0; i < set->nplace; ++i)
+	{
+		pl = &set->place[i];
+		if (pl->kind != PLACE_SC && pl->kind != PLACE_FROM)
+			return -1;
+		for (k = 0; k < 4; ++k)
+		{
+			r = k == 0 ? &pl->vertex : k == 1 ? &pl->source : &pl->param[k - 2].level;
+			if ((k == 1 && pl->kind != PLACE_FROM) || (k > 1 && pl->param[k - 2].mode != PARAM_LEVEL))
+				continue;
+			if (r->v < 0 || r->v >= 20 || r->a < 0 || r->a >= 6)
+				return -1;
+		}
+		for (k = 0; k < 2; ++k)
+		{
+			if (pl->param[k].mode < PARAM_FIXED || pl->param[k].mode > PARAM_LEVEL)
+				return -1;
+			n += pl->param[k].mode == PARAM_FREE;
+		}
+	}
+	for (i = 0; i < set->ncon; ++i)
+	{
+		con = &set->con[i];
+		k = constraint_refs(con);
+		if (!k || con->n < k || con->n > CONSTRAINT_REFS || (con->kind != CONSTRAINT_COPLANAR && con->n != k))
+			return -1;
+		for (k = 0; k < con->n; ++k)
+			if (con->ref[k].v < 0 || con->ref[k].v >= 20 || con->ref[k].a < 0 || con->ref[k].a >= 6)
+				return -1;
+		*residuals += con->kind == CONSTRAINT_COPLANAR ? con->n - 3 : 1;
+	}
+	return n;
+}
+
+//---------------------------------------------------------------------------
+void constraint_place(PROGRAM *pgm, CONSTRAINT_SET *set, double *var)
+//---------------------------------------------------------------------------
+{
+	// place the vertices of the set with the variables var (the free parameters in order)
+	PLACEMENT	*pl;
+	double		p[2];
+	int			i, k, n;
+
+	for (i = n = 0; i < set->nplace; ++i)
+	{
+		pl = &set->place[i];
+		for (k = 0; k < 2; ++k)
+		{
+			if (pl->param[k].mode == PARAM_FREE)
+				p[k] = var[n++];
+			else if (pl->param[k].mode == PARAM_LEVEL)
+				p[k] = pgm->v[pl->param[k].level.v].sc[pl->param[k].level.a].inclination + pl->param[k].value;
+			else
+				p[k] = pl->param[k].value;
+		}
+		if (pl->kind == PLACE_SC)
+			create_vertex_by_sc(pgm, pl->vertex.v, pl->vertex.a, p[0], p[1]);
+		else
+			create_vertex_from_vertex(pgm, pl->vertex.v, pl->vertex.a, pl->source.v, pl->source.a, p[0], p[1]);
+	}
+}
+
+//---------------------------------------------------------------------------
+static int constraint_slots(CONSTRAINT_SET *set, int *slot)
+//---------------------------------------------------------------------------
+{
+	// state slot of every vertex (v * 6 + a) placed by the set, -1 for the
+	// vertices it does not place, returns the number of slots
+	int		i, k, n;
+
+	for (i = 0; i < 120; ++i)
+		slot[i] = -1;
+	for (i = n = 0; i < set->nplace; ++i)
+	{
+		if (slot[set->place[i].vertex.v * 6] >= 0)
+			continue;
+		for (k = 0; k < 6; ++k)
+			slot[set->place[i].vertex.v * 6 + k] = n++;
+	}
+	return n;
+}
+
+//---------------------------------------------------------------------------
+static void constraint_fetch(PROGRAM *pgm, int *slot, double *state, int count, VERTEX_REF *ref, int k, double *out)
+//---------------------------------------------------------------------------
+{
+	// component k (x, y, z, inclination) of a vertex for the batch, from the
+	// state when the set places it, from the program otherwise
+	GUT_POINT	*p;
+	double		t;
+	int			e;
+
+	if (slot[ref->v * 6 + ref->a] >= 0)
+	{
+		memcpy(out, state + (slot[ref->v * 6 + ref->a] * 4 + k) * count, count * sizeof(double));
+		return;
+	}
+	p = &pgm->v[ref->v].p[ref->a];
+	t = k == 0 ? p->x : k == 1 ? p->y : k == 2 ? p->z : pgm->v[ref->v].sc[ref->a].inclination;
+	for (e = 0; e < count; ++e)
+		out[e] = t;
+}
+
+//---------------------------------------------------------------------------
+static void constraint_place_batch(PROGRAM *pgm, CONSTRAINT_SET *set, int count, double *var, int *slot, double *state, double *work)
+//---------------------------------------------------------------------------
+{
+	// Place the vertices of the set for count variable vectors at once with
+	// the batch kernels (fast kernel). The state holds x, y, z and the
+	// inclination of the placed vertices for every vector, component k of
+	// slot i at state + (i * 4 + k) * count (constraint_slots). Same steps as
+	// create_vertex_by_sc, create_vertex_from_vertex and
+	// generate_all_vertices_fast, one placement at a time over the batch.
+	// work is 7 x count scratch.
+	PLACEMENT	*pl;
+	double		*radius, *p[2], *c, *ta, *A, *B, *s, *d, *m;
+	int			i, j, k, e, n, a;
+
+	radius = work, p[0] = radius + count, p[1] = p[0] + count, c = p[1] + count;
+	ta = c + count, A = ta + count, B = A + count;
+	for (e = 0; e < count; ++e)
+		radius[e] = 1;
+
+	n = constraint_size(set, &k);
+	for (i = j = 0; i < set->nplace; ++i)
+	{
+		pl = &set->place[i];
+		for (k = 0; k < 2; ++k)
+		{
+			if (pl->param[k].mode == PARAM_FREE)
+			{
+				for (e = 0; e < count; ++e)
+					p[k][e] = var[e * n + j];
+				++j;
+			}
+			else if (pl->param[k].mode == PARAM_LEVEL)
+			{
+				constraint_fetch(pgm, slot, state, count, &pl->param[k].level, 3, p[k]);
+				for (e = 0; e < count; ++e)
+					p[k][e] += pl->param[k].value;
+			}
+			else
+			{
+				for (e = 0; e < count; ++e)
+					p[k][e] = pl->param[k].value;
+			}
+		}
+
+		// the placed point in its own area
+		a = pl->vertex.a;
+		d = state + slot[pl->vertex.v * 6 + a] * 4 * count;
+		if (pl->kind == PLACE_SC)
+		{
+			gut_spherical_to_cartesian_batch(count, radius, p[0], p[1], d, d + count, d + 2 * count);
+			memcpy(d + 3 * count, p[1], count * sizeof(double));
+		}
+		else
+		{
+			constraint_fetch(pgm, slot, state, count, &pl->source, 3, c);
+			sph_tri_bcC_batch(count, p[0], c, p[1], ta, A, B);
+			gut_spherical_to_cartesian_batch(count, radius, A, c, d, d + count, d + 2 * count);
+			memcpy(d + 3 * count, c, count * sizeof(double));
+		}
+
+		// the same vertex in the other areas (rotations, no translation)
+		for (k = 0; k < 6; ++k)
+		{
+			if (k == a)
+				continue;
+			m = pgm->local[a].sub[k].m;
+			s = state + slot[pl->vertex.v * 6 + k] * 4 * count;
+			for (e = 0; e < count; ++e)
+			{
+				s[e]             = d[e] * m[0] + d[count + e] * m[4] + d[2 * count + e] * m[8];
+				s[count + e]     = d[e] * m[1] + d[count + e] * m[5] + d[2 * count + e] * m[9];
+				s[2 * count + e] = d[e] * m[2] + d[count + e] * m[6] + d[2 * count + e] * m[10];
+			}
+			gut_cartesian_to_spherical_batch(count, s, s + count, s + 2 * count, ta, A, s + 3 * count);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+int constraint_residual_batch(PROGRAM *pgm, CONSTRAINT_SET *set, int count, double *var, double *residual)
+//---------------------------------------------------------------------------
+{
+	// Residuals of count variable vectors (count x variables) into residual
+	// (count x residuals). The vertices are placed for the whole batch
+	// (constraint_place_batch with the fast kernel, one vector at a time
+	// otherwise), the points referenced by the constraints gathered and
+	// every constraint evaluated over the batch in one loop. The program is
+	// left placed for the last vector. Returns 0 or -1.
+	CONSTRAINT	*con;
+	VERTEX		*v;
+	double		*x, *y, *z, *inc, *r, *state, nx, ny, nz, ax, ay, az, bx, by, bz, d;
+	int			i, j, k, e, s0, s1, s2, s3, n, m, batch, slot[120];
+
+	n = constraint_size(set, &m);
+	if (n < 0)
+		return -1;
+	batch = pgm->kernel == KERNEL_FAST && count > 1;
+	k = set->ncon * CONSTRAINT_REFS * count * 4 + (batch ? (constraint_slots(set, slot) * 4 + 7) * count : 0);
+	x = (double*)malloc((k ? k : 1) * sizeof(double));
+	if (!x)
+		return -1;
+	y = x + set->ncon * CONSTRAINT_REFS * count;
+	z = y + set->ncon * CONSTRAINT_REFS * count;
+	inc = z + set->ncon * CONSTRAINT_REFS * count;
+	state = inc + set->ncon * CONSTRAINT_REFS * count;
+
+	// gather the referenced points, slot (constraint * CONSTRAINT_REFS + ref) * count + vector
+	if (batch)
+	{
+		j = constraint_slots(set, slot);
+		constraint_place_batch(pgm, set, count, var, slot, state, state + j * 4 * count);
+		for (i = 0; i < set->ncon; ++i)
+		{
+			con = &set->con[i];
+			for (j = 0; j < con->n; ++j)
+			{
+				k = (i * CONSTRAINT_REFS + j) * count;
+				constraint_fetch(pgm, slot, state, count, &con->ref[j], 0, x + k);
+				constraint_fetch(pgm, slot, state, count, &con->ref[j], 1, y + k);
+				constraint_fetch(pgm, slot, state, count, &con->ref[j], 2, z + k);
+				constraint_fetch(pgm, slot, state, count, &con->ref[j], 3, inc + k);
+			}
+		}
+		constraint_place(pgm, set, var + (count - 1) * n);
+	}
+	for (e = 0; e < count && !batch; ++e)
+	{
+		constraint_place(pgm, set, var + e * n);
+		for (i = 0; i < set->ncon; ++i)
+		{
+			con = &set->con[i];
+			for (j = 0; j < con->n; ++j)
+			{
+				v = &pgm->v[con->ref[j].v];
+				k = (i * CONSTRAINT_REFS + j) * count + e;
+				x[k] = v->p[con->ref[j].a].x;
+				y[k] = v->p[con->ref[j].a].y;
+				z[k] = v->p[con->ref[j].a].z;
+				inc[k] = v->sc[con->ref[j].a].inclination;
+			}
+		}
+	}
+
+	// every constraint over the batch
+	for (i = k = 0; i < set->ncon; ++i)
+	{
+		con = &set->con[i];
+		r = residual + k;
+		s0 = (i * CONSTRAINT_REFS) * count;
+		s1 = s0 + count, s2 = s1 + count, s3 = s2 + count;
+		switch (con->kind)
+		{
+		case CONSTRAINT_LEVEL:
+			for (e = 0; e < count; ++e)
+				r[e * m] = inc[s0 + e] - con->value;
+			break;
+
+		case CONSTRAINT_LEVEL_EQUAL:
+			for (e = 0; e < count; ++e)
+				r[e * m] = inc[s0 + e] - inc[s1 + e];
+			break;
+
+		case CONSTRAINT_EDGE_EQUAL:
+			for (e = 0; e < count; ++e)
+				r[e * m] = sqrt((x[s1 + e] - x[s0 + e]) * (x[s1 + e] - x[s0 + e]) + (y[s1 + e] - y[s0 + e]) * (y[s1 + e] - y[s0 + e]) + (z[s1 + e] - z[s0 + e]) * (z[s1 + e] - z[s0 + e]))
+					- sqrt((x[s3 + e] - x[s2 + e]) * (x[s3 + e] - x[s2 + e]) + (y[s3 + e] - y[s2 + e]) * (y[s3 + e] - y[s2 + e]) + (z[s3 + e] - z[s2 + e]) * (z[s3 + e] - z[s2 + e]));
+			break;
+
+		case CONSTRAINT_COPLANAR:
+			// distances of the other points from the plane of the first three
+			for (e = 0; e < count; ++e)
+			{
+				ax = x[s1 + e] - x[s0 + e], ay = y[s1 + e] - y[s0 + e], az = z[s1 + e] - z[s0 + e];
+				bx = x[s2 + e] - x[s0 + e], by = y[s2 + e] - y[s0 + e], bz = z[s2 + e] - z[s0 + e];
+				nx = ay * bz - az * by, ny = az * bx - ax * bz, nz = ax * by - ay * bx;
+				d = sqrt(nx * nx + ny * ny + nz * nz);
+				d = d > 0 ? 1 / d : 0;
+				for (j = 3; j < con->n; ++j)
+				{
+					s3 = (i * CONSTRAINT_REFS + j) * count + e;
+					r[e * m + j - 3] = ((x[s3] - x[s0 + e]) * nx + (y[s3] - y[s0 + e]) * ny + (z[s3] - z[s0 + e]) * nz) * d;
+				}
+			}
+			break;
+		}
+		k += con->kind == CONSTRAINT_COPLANAR ? con->n - 3 : 1;
+	}
+	free(x);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static int constraint_linear(int n, double *a, double *b)
+//---------------------------------------------------------------------------
+{
+	// solve a x = b (n x n, partial pivoting) in place into b, returns -1 when singular
+	double	t;
+	int		i, j, k, p;
+
+	for (k = 0; k < n; ++k)
+	{
+		for (i = p = k; i < n; ++i)
+			p = fabs(a[i * n + k]) > fabs(a[p * n + k]) ? i : p;
+		if (a[p * n + k] == 0)
+			return -1;
+		for (j = 0; j < n && p != k; ++j)
+			t = a[k * n + j], a[k * n + j] = a[p * n + j], a[p * n + j] = t;
+		t = b[k], b[k] = b[p], b[p] = t;
+		for (i = k + 1; i < n; ++i)
+		{
+			t = a[i * n + k] / a[k * n + k];
+			for (j = k; j < n; ++j)
+				a[i * n + j] -= t * a[k * n + j];
+			b[i] -= t * b[k];
+		}
+	}
+	for (k = n - 1; k >= 0; --k)
+	{
+		for (j = k + 1; j < n; ++j)
+			b[k] -= a[k * n + j] * b[j];
+		b[k] /= a[k * n + k];
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int constraint_solve(PROGRAM *pgm, CONSTRAINT_SET *set, double *var, double *residual)
+//---------------------------------------------------------------------------
+{
+	// Solve a constraint set from the initial values of its free parameters:
+	// the configuration prefix, then Levenberg-Marquardt steps until every
+	// residual is within the stop tolerance. The solved variables are stored
+	// in var (CONSTRAINT_VARIABLES) and the largest final residual in
+	// 'residual', the program is left in the solved state (see patch_geometry).
+	// Returns the number of iterations or -1 when the set is malformed, the
+	// solver stalled or the solve was cancelled.
+	CONFIGURATION	*cfg;
+	PLACEMENT		*pl;
+	double			x[(CONSTRAINT_VARIABLES + 1) * CONSTRAINT_VARIABLES], r[(CONSTRAINT_VARIABLES + 1) * CONSTRAINT_RESIDUALS];
+	double			jtj[CONSTRAINT_VARIABLES * CONSTRAINT_VARIABLES], step[CONSTRAINT_VARIABLES], trial[CONSTRAINT_VARIABLES], rt[CONSTRAINT_RESIDUALS];
+	double			lambda, norm, tnorm;
+	int				i, j, k, n, m, iteration, retry;
+
+	*residual = 0;
+	n = constraint_size(set, &m);
+	if (n < 0 || !(cfg = configuration_find(set->b, set->c)))
+		return -1;
+	if (cfg->prefix)
+		cfg->prefix(pgm);
+	for (i = k = 0; i < set->nplace; ++i)
+	{
+		pl = &set->place[i];
+		for (j = 0; j < 2; ++j)
+			if (pl->param[j].mode == PARAM_FREE)
+				var[k++] = pl->param[j].value;
+	}
+
+	lambda = CONSTRAINT_DAMPING;
+	for (iteration = 0; iteration < CONSTRAINT_ITERATIONS; ++iteration)
+	{
+		// the variables and their forward steps in one batch
+		for (j = 0; j <= n; ++j)
+			for (i = 0; i < n; ++i)
+				x[j * n + i] = var[i] + (j == i + 1 ? CONSTRAINT_STEP : 0);
+		if (constraint_residual_batch(pgm, set, n + 1, x, r))
+			return -1;
+		for (i = 0, norm = 0; i < m; ++i)
+			norm = fabs(r[i]) > norm ? fabs(r[i]) : norm;
+		*residual = norm;
+		if (norm <= pgm->stop.tolerance || !n)
+			break;
+		if (cancel_expired(pgm->cancel))
+			return -1;
+
+		// jacobian columns (r[(j + 1) m + i] - r[i]) / h into the normal equations
+		for (j = 0; j < n; ++j)
+			for (i = 0; i < m; ++i)
+				r[(j + 1) * m + i] = (r[(j + 1) * m + i] - r[i]) / CONSTRAINT_STEP;
+		for (retry = 0; retry < CONSTRAINT_RETRIES; ++retry)
+		{
+			for (j = 0; j < n; ++j)
+			{
+				for (k = 0; k < n; ++k)
+				{
+					for (i = 0, jtj[j * n + k] = 0; i < m; ++i)
+						jtj[j * n + k] += r[(j + 1) * m + i] * r[(k + 1) * m + i];
+				}
+				for (i = 0, step[j] = 0; i < m; ++i)
+					step[j] -= r[(j + 1) * m + i] * r[i];
+				jtj[j * n + j] *= 1 + lambda;
+			}
+			if (!constraint_linear(n, jtj, step))
+			{
+				// accept the step when it lowers the residual, otherwise damp more
+				for (i = 0; i < n; ++i)
+					trial[i] = var[i] + step[i];
+				if (constraint_residual_batch(pgm, set, 1, trial, rt))
+					return -1;
+				for (i = 0, norm = tnorm = 0; i < m; ++i)
+					norm += r[i] * r[i], tnorm += rt[i] * rt[i];
+				if (tnorm < norm)
+				{
+					for (i = 0; i < n; ++i)
+						var[i] = trial[i];
+					lambda = lambda * 0.1 > 1e-12 ? lambda * 0.1 : 1e-12;
+					break;
+				}
+			}
+			lambda *= 10;
+		}
+		if (retry == CONSTRAINT_RETRIES)
+			break;
+	}
+	constraint_place(pgm, set, var);
+	return *residual <= pgm->stop.tolerance ? iteration : -1;
+}
+
+//---------------------------------------------------------------------------
+static int constraint_value(char *word, PROGRAM *pgm, double *value)
+//---------------------------------------------------------------------------
+{
+	// Value of a sum of terms: degrees or multiples of the reference
+	// triangle sides a, b, c (2b+c-0.5). Returns 0 or -1.
+	double	t, sign;
+	char	*end;
+
+	*value = 0;
+	if (!*word)
+		return -1;
+	while (*word)
+	{
+		sign = 1;
+		if (*word == '+' || *word == '-')
+			sign = *word++ == '-' ? -1 : 1;
+		t = strtod(word, &end);
+		if (end == word && (*word < 'a' || *word > 'c'))
+			return -1;
+		if (end == word)
+			t = 1;
+		word = end;
+		if (*word >= 'a' && *word <= 'c')
+		{
+			*value += sign * t * (*word == 'a' ? pgm->ref.a : *word == 'b' ? pgm->ref.b : pgm->ref.c);
+			++word;
+		}
+		else
+			*value += sign * DTR(t);
+		if (*word && *word != '+' && *word != '-')
+			return -1;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static int constraint_param(char *word, PROGRAM *pgm, PARAM *param)
+//---------------------------------------------------------------------------
+{
+	// placement parameter: value, free:value or level:v,a
+	memset(param, 0, sizeof(PARAM));
+	if (!strncmp(word, "level:", 6))
+	{
+		param->mode = PARAM_LEVEL;
+		return sscanf(word + 6, "%d,%d", &param->level.v, &param->level.a) == 2 ? 0 : -1;
+	}
+	if (!strncmp(word, "free:", 5))
+	{
+		param->mode = PARAM_FREE;
+		word += 5;
+	}
+	return constraint_value(word, pgm, &param->value);
+}
+
+//---------------------------------------------------------------------------
+int constraint_parse(char *line, PROGRAM *pgm, CONSTRAINT_SET *set)
+//---------------------------------------------------------------------------
+{
+	// Parse a line of a constraint set file into the set (see above).
+	// Returns 1 for an item, 0 for a blank or comment line and -1 for a
+	// malformed line.
+	char		*word[2 + CONSTRAINT_REFS * 2], *p;
+	PLACEMENT	*pl;
+	CONSTRAINT	*con;
+	int			i, n;
+
+	if ((p = strchr(line, '#')) != 0)
+		*p = 0;
+	for (n = 0, p = line; n < 2 + CONSTRAINT_REFS * 2; )
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+			++p;
+		if (!*p)
+			break;
+		word[n++] = p;
+		while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			++p;
+		if (*p)
+			*p++ = 0;
+	}
+	if (!n)
+		return 0;
+
+	if (!strcmp(word[0], "config"))
+	{
+		if (n != 3)
+			return -1;
+		set->b = atoi(word[1]);
+		set->c = atoi(word[2]);
+		return configuration_find(set->b, set->c) ? 1 : -1;
+	}
+	if (!strcmp(word[0], "place"))
+	{
+		if (set->nplace == CONSTRAINT_PLACEMENTS || n < 6)
+			return -1;
+		pl = &set->place[set->nplace];
+		memset(pl, 0, sizeof(PLACEMENT));
+		pl->vertex.v = atoi(word[1]);
+		pl->vertex.a = atoi(word[2]);
+		i = 4;
+		if (!strcmp(word[3], "from") && n == 8)
+		{
+			pl->kind = PLACE_FROM;
+			pl->source.v = atoi(word[4]);
+			pl->source.a = atoi(word[5]);
+			i = 6;
+		}
+		else if (strcmp(word[3], "sc") || n != 6)
+			return -1;
+		if (constraint_param(word[i], pgm, &pl->param[0]) || constraint_param(word[i + 1], pgm, &pl->param[1]))
+			return -1;
+		++set->nplace;
+		return 1;
+	}
+
+	if (set->ncon == CONSTRAINT_MAX)
+		return -1;
+	con = &set->con[set->ncon];
+	memset(con, 0, sizeof(CONSTRAINT));
+	if (!strcmp(word[0], "level"))
+		con->kind = CONSTRAINT_LEVEL;
+	else if (!strcmp(word[0], "level_equal"))
+		con->kind = CONSTRAINT_LEVEL_EQUAL;
+	else if (!strcmp(word[0], "edge_equal"))
+		con->kind = CONSTRAINT_EDGE_EQUAL;
+	else if (!strcmp(word[0], "coplanar"))
+		con->kind = CONSTRAINT_COPLANAR;
+	else
+		return -1;
+	con->n = con->kind == CONSTRAINT_COPLANAR ? (n - 1) / 2 : constraint_refs(con);
+	if (n != 1 + con->n * 2 + (con->kind == CONSTRAINT_LEVEL) || con->n > CONSTRAINT_REFS)
+		return -1;
+	for (i = 0; i < con->n; ++i)
+	{
+		con->ref[i].v = atoi(word[1 + i * 2]);
+		con->ref[i].a = atoi(word[2 + i * 2]);
+	}
+	if (con->kind == CONSTRAINT_LEVEL && constraint_value(word[n - 1], pgm, &con->value))
+		return -1;
+	++set->ncon;
+	return 1;
+}
+
+//---------------------------------------------------------------------------
+int constraint_read(char *filename, PROGRAM *pgm, CONSTRAINT_SET *set)
+//---------------------------------------------------------------------------
+{
+	// Read a constraint set file. Returns 0 or -1 when the file cannot be
+	// read or a line is malformed (reported).
+	FILE	*fp;
+	char	line[512];
+	int		n, m;
+
+	memset(set, 0, sizeof(CONSTRAINT_SET));
+	fopen_s(&fp, filename, "r");
+	if (!fp)
+	{
+		LOG(LOG_ERROR, "constraints", "cannot read constraint set: %s", filename);
+		return -1;
+	}
+	for (n = 1; fgets(line, sizeof(line), fp); ++n)
+	{
+		if (constraint_parse(line, pgm, set) < 0)
+		{
+			LOG(LOG_ERROR, "constraints", "%s(%d): malformed line", filename, n);
+			fclose(fp);
+			return -1;
+		}
+	}
+	fclose(fp);
+	if (constraint_size(set, &m) < 0)
+	{
+		LOG(LOG_ERROR, "constraints", "%s: malformed constraint set", filename);
+		return -1;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int constraint_output(PROGRAM *pgm, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Solve the constraint set of a file and write the patch of its
+	// configuration as <file name without extension>.off. Returns non zero
+	// when it failed.
+	CONSTRAINT_SET	set;
+	double			var[CONSTRAINT_VARIABLES], residual;
+	char			name[128], *p;
+	int				i, n, m, iterations;
+
+	if (constraint_read(filename, pgm, &set))
+		return 1;
+	n = constraint_size(&set, &m);
+	iterations = constraint_solve(pgm, &set, var, &residual);
+	LOG(iterations < 0 ? LOG_NOTE : LOG_INFO, "constraints", "Constraint set %s (%d,%d): %d variables, %d residuals, %s after %d iterations, residual %g",
+		filename, set.b, set.c, n, m, iterations < 0 ? "not solved" : "solved", iterations < 0 ? CONSTRAINT_ITERATIONS : iterations, residual);
+	if (iterations < 0)
+		return 1;
+	for (i = 0; i < n; ++i)
+		LOG(LOG_INFO, "constraint_variable", "\tvariable %d: %15.12f deg", i, RTD(var[i]));
+
+	// base name after the last separator of either kind
+	for (p = filename + strlen(filename); p > filename && p[-1] != '/' && p[-1] != '\\'; --p)
+		;
+	sprintf_s(name, 128, "%s", p);
+	if ((p = strrchr(name, '.')) != 0)
+		*p = 0;
+	sprintf_s(name + strlen(name), 128 - strlen(name), ".off");
+	patch_output(pgm, configuration_find(set.b, set.c)->patch, name);
+	return 0;
+}
+
+// the stages of the configurations as constraint sets (constraint_test), 
+// lines separated by ';'
+static struct {
+	char	*name;
+	int		variant;	// stage variant of the same solution, -1 none
+	char	*text;
+} constraint_test_table[] = {
+	{ "(5,0)", 0, "config 5 0; place 3 0 sc 0 free:2b+c+9; place 4 0 from 3 0 2b+c 120; place 1 1 from 3 0 2b 144;"
+		"place 0 1 from 3 1 2b 144; place 2 0 sc 36 2c+2a; level_equal 4 2 0 2" },
+	{ "(6,0) a", 0, "config 6 0; place 4 0 sc free:5 level:5,0; level_equal 4 1 1 1" },
+	{ "(6,0) b", 1, "config 6 0; place 4 0 sc free:6 level:5,0; level_equal 4 2 0 1" },
+	{ "(7,0) b1", 0, "config 7 0; place 3 0 sc 36 2a+2c; place 7 2 sc 0 free:2b+c-5.5; place 4 2 from 7 2 2b+c 60;"
+		"place 0 1 from 7 2 2b 144; place 1 1 from 7 1 2b 144; place 6 0 from 4 0 2b+c 120; place 2 1 from 4 0 2b 144;"
+		"place 5 2 sc free:4 level:0,2; level_equal 6 2 1 2; level_equal 5 1 1 1" },
+	{ "(7,0) b2", 1, "config 7 0; place 3 0 sc 36 2a+2c; place 7 2 sc 0 free:2b+c-5.5; place 4 2 from 7 2 2b+c 60;"
+		"place 0 1 from 7 2 2b 144; place 1 1 from 7 1 2b 144; place 6 0 from 4 0 2b+c 120; place 2 1 from 4 0 2b 144;"
+		"place 5 2 sc free:4 level:0,2; level_equal 6 2 1 2; level_equal 5 0 4 0" },
+	{ "(7,0) b3", 2, "config 7 0; place 3 0 sc 36 2a+2c; place 7 2 sc 0 free:2b+c-5.5; place 4 2 from 7 2 2b+c 60;"
+		"place 0 1 from 7 2 2b 144; place 1 1 from 7 1 2b 144; place 6 0 from 4 0 2b+c 120; place 2 1 from 4 0 2b 144;"
+		"place 5 0 sc free:4 level:4,0; level_equal 6 2 1 2; level_equal 5 1 1 1" },
+};
+
+//---------------------------------------------------------------------------
+int constraint_test(PROGRAM *pgm)
+//---------------------------------------------------------------------------
+{
+	// Solve the test sets and compare the patch vertices with the stage 
+	// solutions, check a batch of residuals against single evaluations and
+	// time them. The single evaluations place the vertices with the scalar 
+	// kernels, a batch agrees with them to the bit with the generic batch 
+	// kernels and within the differential test gate with the vector variants.
+	// Returns non zero when it failed.
+	CONSTRAINT_SET	set;
+	CONFIGURATION	*cfg;
+	PROGRAM			solved;
+	GUT_POINT		gp[20], sp[20];
+	double			var[CONSTRAINT_VARIABLES], seed[CONFIGURATION_SEEDS], *x, *r, rs[CONSTRAINT_RESIDUALS];
+	double			residual, deviation, batch, single, t, d, agree;
+	char			line[1024], *p, *q;
+	int				i, j, k, n, m, iterations, failed, fails, mismatch;
+
+	printf("Constraint sets of the stages, %d vectors per residual batch\n", CONSTRAINT_TEST_BATCH);
+	printf("%-10s %9s %9s %10s %12s %12s %12s %12s\n", "set", "variables", "residuals", "iterations", "residual", "deviation", "batch ns", "single ns");
+	x = (double*)malloc(CONSTRAINT_TEST_BATCH * (CONSTRAINT_VARIABLES + CONSTRAINT_RESIDUALS) * sizeof(double));
+	if (!x)
+		return 1;
+	r = x + CONSTRAINT_TEST_BATCH * CONSTRAINT_VARIABLES;
+	agree = kernel_isa_table[kernel_isa].ulp > 1 ? DIFFTEST_TOLERANCE * kernel_isa_table[kernel_isa].ulp : 0;
+	for (i = failed = 0; i < (int)(sizeof(constraint_test_table) / sizeof(constraint_test_table[0])); ++i)
+	{
+		memset(&set, 0, sizeof(CONSTRAINT_SET));
+		sprintf_s(line, sizeof(line), "%s", constraint_test_table[i].text);
+		for (p = line, fails = 0; p; p = q)
+		{
+			if ((q = strchr(p, ';')) != 0)
+				*q++ = 0;
+			fails |= constraint_parse(p, pgm, &set) < 0;
+		}
+		n = constraint_size(&set, &m);
+		iterations = fails || n < 0 ? -1 : constraint_solve(pgm, &set, var, &residual);
+		if (iterations < 0)
+		{
+			printf("%-10s not solved\n", constraint_test_table[i].name);
+			failed = 1;
+			continue;
+		}
+
+		// the patch against the stage solution
+		patch_geometry(pgm, configuration_find(set.b, set.c)->patch, gp);
+		deviation = 0;
+		if (constraint_test_table[i].variant >= 0)
+		{
+			solved = *pgm;
+			cfg = configuration_find(set.b, set.c);
+			if (configuration_solve(&solved, cfg, constraint_test_table[i].variant, seed, &d) < 0)
+				deviation = 1;
+			patch_geometry(&solved, cfg->patch, sp);
+			for (j = 0; j < cfg->patch->nv; ++j)
+			{
+				d = sqrt((gp[j].x - sp[j].x) * (gp[j].x - sp[j].x) + (gp[j].y - sp[j].y) * (gp[j].y - sp[j].y) + (gp[j].z - sp[j].z) * (gp[j].z - sp[j].z));
+				deviation = d > deviation ? d : deviation;
+			}
+		}
+
+		// a batch of vectors around the solution against single evaluations
+		for (j = 0; j < CONSTRAINT_TEST_BATCH; ++j)
+			for (k = 0; k < n; ++k)
+				x[j * n + k] = var[k] + DTR(1e-3) * ((j * 7 + k * 3) % 11 - 5);
+		t = clock_seconds();
+		constraint_residual_batch(pgm, &set, CONSTRAINT_TEST_BATCH, x, r);
+		batch = (clock_seconds() - t) / CONSTRAINT_TEST_BATCH;
+		t = clock_seconds();
+		for (j = mismatch = 0; j < CONSTRAINT_TEST_BATCH; ++j)
+		{
+			constraint_residual_batch(pgm, &set, 1, x + j * n, rs);
+			for (k = 0; k < m; ++k)
+				mismatch |= !(fabs(rs[k] - r[j * m + k]) <= agree);
+		}
+		single = (clock_seconds() - t) / CONSTRAINT_TEST_BATCH;
+		constraint_place(pgm, &set, var);
+
+		printf("%-10s %9d %9d %10d %12.3e %12.3e %12.1f %12.1f%s\n", constraint_test_table[i].name, n, m, iterations, residual, deviation,
+			batch * 1e9, single * 1e9, mismatch ? " batch mismatch" : "");
+		failed |= deviation > CONSTRAINT_TEST_DEVIATION || mismatch;
+	}
+	free(x);
+	printf(failed ? "FAILED\n" : "PASSED\n");
+	return failed;
+}
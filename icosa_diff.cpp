@@ -0,0 +1,647 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Comparison of two solutions.
+
+	A solution is an OFF file (a patch, a dual or any mesh of the sphere
+	in the global frame) or a batch result (<hash>.res: the job key and the
+	solved seeds, the patch is rebuilt from the seeds without a solve).
+	The two need not hold the same copies of the vertices nor list them in
+	the same order, the vertices are compared by their symmetry orbits.
+
+	Every point is folded into the domain of the point in panel index (1/24
+	of the sphere, signs and cyclic permutations of the standard frame).
+	The group is the union of 5 cosets of those 24 transforms, so the images
+	of a point in the domain are the folds of its images by one transform
+	of each coset. The second solution is indexed by the folded images of
+	its vertices and of its edge midpoints in a grid over the domain; the
+	first is read in one pass, a block of vertices or edges at a time, each
+	point folded once and matched with the nearest image of the index.
+
+	The report is the largest and the root mean square vertex deviation and
+	edge length difference, and the vertices of the second solution whose
+	orbit no vertex of the first reached.
+
+*/
+// icosa_diff.cpp : Defines the comparison of two solutions (library).
+//
+#include "icosa_truncations.h"
+
+#define DIFF_TIE		1e-2	// fold ties (relative to the radius) the index keeps both cases of
+#define DIFF_LINE		1024
+#define DIFF_CELL		2		// images per cell of the grid
+#define DIFF_RINGS		3		// rings of cells searched before all the images are
+
+typedef struct {
+	DIFF_INDEX	*vertex, *edge;		// images of the vertices and edge midpoints of the second solution
+	double		*length;			// edge lengths of the second solution (face sides)
+	char		*hit;				// vertices of the second solution an orbit image was matched with
+	DIFF_REPORT	*report;
+	int			n;					// edges of the block
+	double		x[DIFF_BLOCK], y[DIFF_BLOCK], z[DIFF_BLOCK], l[DIFF_BLOCK];
+} DIFF_PASS;
+
+static void diff_fold(DIFF_INDEX *index, int n, double *x, double *y, double *z, double (*f)[3]);
+static int diff_covered(DIFF_INDEX *index, double *f, double radius, char *hit);
+static void diff_vertices(DIFF_PASS *pass, int n, double *x, double *y, double *z);
+static void diff_side(DIFF_PASS *pass, double *a, double *b);
+static void diff_edges(DIFF_PASS *pass);
+static int diff_result(FILE *fp, MESH *mesh);
+static int diff_off(FILE *fp, MESH *mesh);
+
+//---------------------------------------------------------------------------
+static void diff_fold(DIFF_INDEX *index, int n, double *x, double *y, double *z, double (*f)[3])
+//---------------------------------------------------------------------------
+{
+	// n points of the global frame into the domain (panel_fold)
+	double	*m = index->fold.frame, s[3];
+	int		i;
+
+	for (i = 0; i < n; ++i)
+	{
+		s[0] = x[i] * m[0] + y[i] * m[3] + z[i] * m[6];
+		s[1] = x[i] * m[1] + y[i] * m[4] + z[i] * m[7];
+		s[2] = x[i] * m[2] + y[i] * m[5] + z[i] * m[8];
+		panel_fold(s, f[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+int diff_index_build(SYMMETRY *sym, int n, double *x, double *y, double *z, DIFF_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	// Index of the folded images of n points (global frame), the item of
+	// an image is its point. Returns 0 or -1.
+	double	*ix, *iy, *iz, q[3], a[3], t[9], seen[DIFF_COSETS][3], (*f)[3], *c, r, tie, hi[2], extent;
+	int		*item, *key, g, i, j, k, m, count, cy, cz;
+
+	memset(index, 0, sizeof(DIFF_INDEX));
+	if (panel_fold_build(sym, &index->fold))
+		return -1;
+
+	// one transform of every coset: the transforms folding a generic point apart
+	q[0] = 3 / sqrt(14.0), q[1] = 2 / sqrt(14.0), q[2] = 1 / sqrt(14.0);
+	for (g = k = 0; g < sym->count && k < DIFF_COSETS; ++g)
+	{
+		for (i = 0; i < 9; ++i)
+			t[i] = 0;
+		for (i = 0; i < 3; ++i)
+			for (j = 0; j < 3; ++j)
+				for (m = 0; m < 9; ++m)
+					t[i * 3 + j] += index->fold.frame[(m / 3) * 3 + i] * sym->m[g][(m / 3) * 4 + m % 3] * index->fold.frame[(m % 3) * 3 + j];
+		for (j = 0; j < 3; ++j)
+			a[j] = q[0] * t[j] + q[1] * t[3 + j] + q[2] * t[6 + j];
+		panel_fold(a, seen[k]);
+		for (i = 0; i < k && fabs(seen[i][0] - seen[k][0]) + fabs(seen[i][1] - seen[k][1]) + fabs(seen[i][2] - seen[k][2]) > 1e-9; ++i)
+			;
+		if (i == k)
+			memcpy(index->coset[k++], t, sizeof(t));
+	}
+	if (k != DIFF_COSETS)
+		return -1;
+
+	// the images: every coset, and the other case of a fold near a tie of the largest coordinate
+	ix = (double*)malloc(n * DIFF_COSETS * 3 * 3 * sizeof(double));
+	item = (int*)malloc(n * DIFF_COSETS * 3 * 2 * sizeof(int));
+	f = (double(*)[3])malloc(DIFF_BLOCK * 3 * sizeof(double));
+	if (!ix || !item || !f)
+	{
+		free(ix);
+		free(item);
+		free(f);
+		return -1;
+	}
+	iy = ix + n * DIFF_COSETS * 3;
+	iz = iy + n * DIFF_COSETS * 3;
+	key = item + n * DIFF_COSETS * 3;
+	for (i = count = 0; i < n; ++i)
+	{
+		r = sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+		tie = r * DIFF_TIE;
+		diff_fold(index, 1, &x[i], &y[i], &z[i], f);
+		for (k = 0; k < DIFF_COSETS; ++k)
+		{
+			c = index->coset[k];
+			for (j = 0; j < 3; ++j)
+				a[j] = f[0][0] * c[j] + f[0][1] * c[3 + j] + f[0][2] * c[6 + j];
+			panel_fold(a, q);
+			for (m = 0; m < 3; ++m)
+			{
+				if (m && q[0] - q[m] > tie)
+					continue;
+				ix[count] = q[m], iy[count] = q[(m + 1) % 3], iz[count] = q[(m + 2) % 3];
+				item[count++] = i;
+			}
+		}
+	}
+	free(f);
+
+	// grid over the y and z of the images (x is the largest coordinate of
+	// the domain, the images form a surface over y and z), the images 
+	// sorted by cell
+	for (k = 0; k < 2; ++k)
+		index->lo[k] = hi[k] = 0;
+	for (i = 0; i < count; ++i)
+	{
+		index->lo[0] = !i || iy[i] < index->lo[0] ? iy[i] : index->lo[0], hi[0] = !i || iy[i] > hi[0] ? iy[i] : hi[0];
+		index->lo[1] = !i || iz[i] < index->lo[1] ? iz[i] : index->lo[1], hi[1] = !i || iz[i] > hi[1] ? iz[i] : hi[1];
+	}
+	extent = hi[0] - index->lo[0] > hi[1] - index->lo[1] ? hi[0] - index->lo[0] : hi[1] - index->lo[1];
+	index->grid = (int)sqrt(count / (double)DIFF_CELL);
+	index->grid = index->grid < 1 ? 1 : index->grid;
+	index->scale = extent > 0 ? index->grid / (extent * (1 + 1e-9)) : 1;
+	m = index->grid * index->grid;
+	index->cell = (int*)calloc(m + 1, sizeof(int));
+	index->x = (double*)malloc((count ? count : 1) * 3 * sizeof(double));
+	index->item = (int*)malloc((count ? count : 1) * sizeof(int));
+	if (!index->cell || !index->x || !index->item)
+	{
+		free(ix);
+		free(item);
+		diff_index_free(index);
+		return -1;
+	}
+	index->y = index->x + count;
+	index->z = index->y + count;
+	index->n = count;
+	for (i = 0; i < count; ++i)
+	{
+		cy = (int)((iy[i] - index->lo[0]) * index->scale);
+		cz = (int)((iz[i] - index->lo[1]) * index->scale);
+		cy = cy < index->grid ? cy : index->grid - 1;
+		cz = cz < index->grid ? cz : index->grid - 1;
+		key[i] = cy * index->grid + cz;
+		++index->cell[key[i] + 1];
+	}
+	for (k = 0; k < m; ++k)
+		index->cell[k + 1] += index->cell[k];
+	for (i = 0; i < count; ++i)
+	{
+		j = index->cell[key[i]]++;
+		index->x[j] = ix[i], index->y[j] = iy[i], index->z[j] = iz[i];
+		index->item[j] = item[i];
+	}
+	for (k = m; k > 0; --k)
+		index->cell[k] = index->cell[k - 1];
+	index->cell[0] = 0;
+	free(ix);
+	free(item);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void diff_index_free(DIFF_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	free(index->x);
+	free(index->item);
+	free(index->cell);
+	memset(index, 0, sizeof(DIFF_INDEX));
+}
+
+//---------------------------------------------------------------------------
+int diff_nearest(DIFF_INDEX *index, double *f, double *distance)
+//---------------------------------------------------------------------------
+{
+	// Item of the image nearest to a folded point and its distance: the
+	// cells in rings around the cell of the point until the nearest image
+	// found is nearer than any image outside the rings can be (the grid 
+	// distance is at most the distance), all the images for a point far 
+	// from every image. Returns -1 for an empty index.
+	double	u[2], dx, dy, dz, d, best, margin;
+	int		c[2], i, j, e, r, g, nearest;
+
+	g = index->grid;
+	for (i = 0; i < 2; ++i)
+	{
+		u[i] = (f[i + 1] - index->lo[i]) * index->scale;
+		c[i] = (int)floor(u[i]);
+		u[i] -= c[i];
+	}
+	best = 0;
+	nearest = -1;
+	for (r = 0; r <= DIFF_RINGS; ++r)
+	{
+		for (i = c[0] - r; i <= c[0] + r; ++i)
+		{
+			if (i < 0 || i >= g)
+				continue;
+			for (j = c[1] - r; j <= c[1] + r; j += abs(i - c[0]) == r ? 1 : 2 * r)
+			{
+				if (j >= 0 && j < g)
+				{
+					for (e = index->cell[i * g + j]; e < index->cell[i * g + j + 1]; ++e)
+					{
+						dx = index->x[e] - f[0], dy = index->y[e] - f[1], dz = index->z[e] - f[2];
+						d = dx * dx + dy * dy + dz * dz;
+						if (nearest < 0 || d < best)
+							best = d, nearest = index->item[e];
+					}
+				}
+				if (!r)
+					break;
+			}
+		}
+		// distance from the point to the cells outside the rings
+		margin = r + (u[0] < 1 - u[0] ? u[0] : 1 - u[0]);
+		margin = r + u[1] < margin ? r + u[1] : r + 1 - u[1] < margin ? r + 1 - u[1] : margin;
+		if (nearest >= 0 && best <= margin * margin / (index->scale * index->scale))
+		{
+			*distance = sqrt(best);
+			return nearest;
+		}
+	}
+	for (e = 0; e < index->n; ++e)
+	{
+		dx = index->x[e] - f[0], dy = index->y[e] - f[1], dz = index->z[e] - f[2];
+		d = dx * dx + dy * dy + dz * dz;
+		if (nearest < 0 || d < best)
+			best = d, nearest = index->item[e];
+	}
+	*distance = sqrt(best);
+	return nearest;
+}
+
+//---------------------------------------------------------------------------
+static int diff_covered(DIFF_INDEX *index, double *f, double radius, char *hit)
+//---------------------------------------------------------------------------
+{
+	// 1 when an image of a hit item is within the radius of a folded point
+	double	dx, dy, dz;
+	int		lo[2], hi[2], i, j, k, e;
+
+	for (k = 0; k < 2; ++k)
+	{
+		lo[k] = (int)floor((f[k + 1] - radius - index->lo[k]) * index->scale);
+		hi[k] = (int)floor((f[k + 1] + radius - index->lo[k]) * index->scale);
+		lo[k] = lo[k] < 0 ? 0 : lo[k];
+		hi[k] = hi[k] >= index->grid ? index->grid - 1 : hi[k];
+	}
+	for (i = lo[0]; i <= hi[0]; ++i)
+		for (j = lo[1]; j <= hi[1]; ++j)
+			for (e = index->cell[i * index->grid + j]; e < index->cell[i * index->grid + j + 1]; ++e)
+			{
+				dx = index->x[e] - f[0], dy = index->y[e] - f[1], dz = index->z[e] - f[2];
+				if (hit[index->item[e]] && dx * dx + dy * dy + dz * dz <= radius * radius)
+					return 1;
+			}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void diff_vertices(DIFF_PASS *pass, int n, double *x, double *y, double *z)
+//---------------------------------------------------------------------------
+{
+	// match a block of vertices of the first solution
+	DIFF_REPORT	*report = pass->report;
+	double		f[DIFF_BLOCK][3], d;
+	int			i, k;
+
+	diff_fold(pass->vertex, n, x, y, z, f);
+	for (i = 0; i < n; ++i)
+	{
+		k = diff_nearest(pass->vertex, f[i], &d);
+		if (k >= 0)
+			pass->hit[k] = 1;
+		report->max = d > report->max ? d : report->max;
+		report->rms += d * d;
+	}
+	report->vertices += n;
+}
+
+//---------------------------------------------------------------------------
+static void diff_side(DIFF_PASS *pass, double *a, double *b)
+//---------------------------------------------------------------------------
+{
+	// add a face side of the first solution to the block of edges
+	pass->x[pass->n] = (a[0] + b[0]) / 2;
+	pass->y[pass->n] = (a[1] + b[1]) / 2;
+	pass->z[pass->n] = (a[2] + b[2]) / 2;
+	pass->l[pass->n] = sqrt((b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]));
+	if (++pass->n == DIFF_BLOCK)
+		diff_edges(pass);
+}
+
+//---------------------------------------------------------------------------
+static void diff_edges(DIFF_PASS *pass)
+//---------------------------------------------------------------------------
+{
+	// match the block of edges by their midpoints and compare the lengths
+	DIFF_REPORT	*report = pass->report;
+	double		f[DIFF_BLOCK][3], d;
+	int			i, k;
+
+	diff_fold(pass->edge, pass->n, pass->x, pass->y, pass->z, f);
+	for (i = 0; i < pass->n; ++i)
+	{
+		k = diff_nearest(pass->edge, f[i], &d);
+		d = k >= 0 ? fabs(pass->l[i] - pass->length[k]) : pass->l[i];
+		report->edge_max = d > report->edge_max ? d : report->edge_max;
+		report->edge_rms += d * d;
+	}
+	report->edges += pass->n;
+	pass->n = 0;
+}
+
+//---------------------------------------------------------------------------
+static int diff_off(FILE *fp, MESH *mesh)
+//---------------------------------------------------------------------------
+{
+	// the mesh of an OFF file after its first line, returns 0 or -1
+	int		nv, nf, ne, i, k, n, size, *grown;
+
+	if (fscanf(fp, "%d %d %d", &nv, &nf, &ne) != 3 || nv < 0 || nf < 0 || mesh_alloc(mesh, nv ? nv : 1, nf, nf * 3 + 1))
+		return -1;
+	mesh->nv = nv;
+	for (i = 0; i < nv; ++i)
+	{
+		mesh->vorbit[i] = -1;
+		if (fscanf(fp, "%lf %lf %lf", &mesh->x[i], &mesh->y[i], &mesh->z[i]) != 3)
+			return -1;
+	}
+	for (i = 0, size = nf * 3 + 1; i < nf; ++i)
+	{
+		mesh->forbit[i] = -1;
+		if (fscanf(fp, "%d", &n) != 1 || n < 0 || n > INT_MAX / 2 - mesh->offset[i])
+			return -1;
+		if (mesh->offset[i] + n > size)
+		{
+			// more indices than triangles take, the mesh keeps its indices when there is no memory
+			size = (mesh->offset[i] + n) * 2;
+			grown = (int*)realloc(mesh->index, size * sizeof(int));
+			if (!grown)
+				return -1;
+			mesh->index = grown;
+		}
+		for (k = 0; k < n; ++k)
+		{
+			if (fscanf(fp, "%d", &mesh->index[mesh->offset[i] + k]) != 1 || mesh->index[mesh->offset[i] + k] < 0 || mesh->index[mesh->offset[i] + k] >= nv)
+				return -1;
+		}
+		mesh->offset[i + 1] = mesh->offset[i] + n;
+		++mesh->nf;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static int diff_result(FILE *fp, MESH *mesh)
+//---------------------------------------------------------------------------
+{
+	// The patch of a batch result, rebuilt from its solved seeds: the job
+	// key, then status, certified, residual, seeds and the seeds (see
+	// batch_run). Returns 0 or -1.
+	CONFIGURATION	*cfg;
+	PROGRAM			solved;
+	STAGE			*stage[2];
+	JOB				job;
+	GUT_POINT		gp[20];
+	double			residual, seed[CONFIGURATION_SEEDS];
+	char			key[DIFF_LINE];
+	int				i, k, status, certified, seeds;
+
+	if (!fgets(key, sizeof(key), fp) || job_parse(key, &job) != 1 || !(cfg = configuration_find(job.b, job.c))
+		|| job.variant < 0 || job.variant >= cfg->variants)
+		return -1;
+	if (fscanf(fp, "%d %d %lf %d", &status, &certified, &residual, &seeds) != 4 || status != JOB_OK || seeds < 0 || seeds > CONFIGURATION_SEEDS)
+		return -1;
+	for (k = 0; k < seeds; ++k)
+		if (fscanf(fp, "%lf", &seed[k]) != 1)
+			return -1;
+
+	program_init(&solved);
+	solved.quiet = 1;
+	solved.kernel = job.kernel;
+	if (cfg->prefix)
+		cfg->prefix(&solved);
+	stage[0] = cfg->shared;
+	stage[1] = cfg->stage[job.variant];
+	for (i = k = 0; i < 2; ++i)
+	{
+		if (!stage[i])
+			continue;
+		if (k == seeds)
+			return -1;
+		stage[i]->build(&seed[k++], &solved);
+	}
+	patch_geometry(&solved, cfg->patch, gp);
+
+	if (mesh_alloc(mesh, cfg->patch->nv, cfg->patch->nf, cfg->patch->nf * 3))
+		return -1;
+	mesh->nv = cfg->patch->nv;
+	mesh->nf = cfg->patch->nf;
+	for (i = 0; i < mesh->nv; ++i)
+	{
+		mesh->x[i] = gp[i].x * job.radius;
+		mesh->y[i] = gp[i].y * job.radius;
+		mesh->z[i] = gp[i].z * job.radius;
+		mesh->vorbit[i] = cfg->patch->vr[i].v;
+	}
+	for (i = 0; i < mesh->nf; ++i)
+	{
+		for (k = 0; k < 3; ++k)
+			mesh->index[i * 3 + k] = cfg->patch->f[i][k];
+		mesh->offset[i + 1] = (i + 1) * 3;
+		mesh->forbit[i] = i;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int solution_read(char *filename, MESH *mesh)
+//---------------------------------------------------------------------------
+{
+	// A solution (OFF file or batch result) as a mesh at its radius.
+	// Returns 0 or -1.
+	FILE	*fp;
+	char	word[8];
+	int		status;
+
+	memset(mesh, 0, sizeof(MESH));
+	fopen_s(&fp, filename, "r");
+	if (!fp)
+		return -1;
+	if (fscanf(fp, "%7s", word) == 1 && !strcmp(word, "OFF"))
+		status = diff_off(fp, mesh);
+	else
+	{
+		rewind(fp);
+		status = diff_result(fp, mesh);
+	}
+	fclose(fp);
+	if (status)
+		mesh_free(mesh);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+int solution_diff(PROGRAM *pgm, char *a, char *b, DIFF_REPORT *report)
+//---------------------------------------------------------------------------
+{
+	// Compare solution a with solution b (see above). An OFF file a is read
+	// in one pass, its vertices and faces a block at a time. Returns 0 or -1
+	// when a solution cannot be read.
+	SYMMETRY	*sym;
+	DIFF_INDEX	vertex, edge;
+	DIFF_PASS	pass;
+	MESH		mb, ma;
+	FILE		*fp;
+	double		*x, *y, *z, *px, *py, *pz, *length, p[2][3], f[1][3], radius;
+	char		word[8];
+	int			*side, i, j, k, n, nv, nf, ne, status;
+
+	memset(report, 0, sizeof(DIFF_REPORT));
+	if (solution_read(b, &mb))
+		return -1;
+	sym = symmetry_group(pgm);
+
+	// the second solution: images of its vertices and of its edge midpoints
+	n = mb.offset[mb.nf];
+	px = (double*)malloc((n ? n : 1) * 4 * sizeof(double));
+	side = (int*)malloc((n ? n : 1) * sizeof(int));
+	pass.hit = (char*)calloc(mb.nv ? mb.nv : 1, 1);
+	x = y = z = 0;
+	status = !px || !side || !pass.hit ? -1 : 0;
+	memset(&vertex, 0, sizeof(DIFF_INDEX));
+	memset(&edge, 0, sizeof(DIFF_INDEX));
+	if (!status)
+	{
+		py = px + n, pz = py + n, length = pz + n;
+		for (i = 0; i < mb.nf; ++i)
+		{
+			for (k = mb.offset[i]; k < mb.offset[i + 1]; ++k)
+			{
+				j = mb.index[k], side[k] = mb.index[k + 1 < mb.offset[i + 1] ? k + 1 : mb.offset[i]];
+				px[k] = (mb.x[j] + mb.x[side[k]]) / 2, py[k] = (mb.y[j] + mb.y[side[k]]) / 2, pz[k] = (mb.z[j] + mb.z[side[k]]) / 2;
+				length[k] = sqrt((mb.x[side[k]] - mb.x[j]) * (mb.x[side[k]] - mb.x[j]) + (mb.y[side[k]] - mb.y[j]) * (mb.y[side[k]] - mb.y[j])
+					+ (mb.z[side[k]] - mb.z[j]) * (mb.z[side[k]] - mb.z[j]));
+			}
+		}
+		status = diff_index_build(sym, mb.nv, mb.x, mb.y, mb.z, &vertex) || diff_index_build(sym, n, px, py, pz, &edge) ? -1 : 0;
+		pass.vertex = &vertex;
+		pass.edge = &edge;
+		pass.length = length;
+		pass.report = report;
+		pass.n = 0;
+	}
+
+	// the first solution in one pass: an OFF file as read, a batch result from its patch
+	fopen_s(&fp, a, "r");
+	if (!fp)
+		status = -1;
+	if (!status && fscanf(fp, "%7s", word) == 1 && !strcmp(word, "OFF"))
+	{
+		if (fscanf(fp, "%d %d %d", &nv, &nf, &ne) != 3 || nv < 0 || nf < 0 || !(x = (double*)malloc((nv ? nv : 1) * 3 * sizeof(double))))
+			status = -1;
+		y = x + nv, z = y + nv;
+		for (i = 0; !status && i < nv; i += n)
+		{
+			for (n = 0; !status && n < DIFF_BLOCK && i + n < nv; ++n)
+				status = fscanf(fp, "%lf %lf %lf", &x[i + n], &y[i + n], &z[i + n]) == 3 ? 0 : -1;
+			if (!status)
+				diff_vertices(&pass, n, x + i, y + i, z + i);
+		}
+		for (i = 0; !status && i < nf; ++i)
+		{
+			// the sides from the first vertex of the face around back to it
+			status = fscanf(fp, "%d %d", &n, &ne) == 2 && n > 0 && ne >= 0 && ne < nv ? 0 : -1;
+			for (k = 1, j = ne; !status && k <= n; ++k)
+			{
+				p[0][0] = x[j], p[0][1] = y[j], p[0][2] = z[j];
+				if (k < n)
+					status = fscanf(fp, "%d", &j) == 1 && j >= 0 && j < nv ? 0 : -1;
+				else
+					j = ne;
+				p[1][0] = x[j], p[1][1] = y[j], p[1][2] = z[j];
+				if (!status)
+					diff_side(&pass, p[0], p[1]);
+			}
+		}
+	}
+	else if (!status)
+	{
+		rewind(fp);
+		status = diff_result(fp, &ma);
+		if (!status)
+		{
+			diff_vertices(&pass, ma.nv, ma.x, ma.y, ma.z);
+			for (i = 0; i < ma.nf; ++i)
+			{
+				for (k = ma.offset[i]; k < ma.offset[i + 1]; ++k)
+				{
+					j = ma.index[k];
+					p[0][0] = ma.x[j], p[0][1] = ma.y[j], p[0][2] = ma.z[j];
+					j = ma.index[k + 1 < ma.offset[i + 1] ? k + 1 : ma.offset[i]];
+					p[1][0] = ma.x[j], p[1][1] = ma.y[j], p[1][2] = ma.z[j];
+					diff_side(&pass, p[0], p[1]);
+				}
+			}
+			mesh_free(&ma);
+		}
+	}
+	if (fp)
+		fclose(fp);
+	if (!status && pass.n)
+		diff_edges(&pass);
+
+	// vertices of the second solution whose orbit no vertex reached
+	if (!status)
+	{
+		for (i = 0, radius = 0; i < mb.nv; ++i)
+			radius = sqrt(mb.x[i] * mb.x[i] + mb.y[i] * mb.y[i] + mb.z[i] * mb.z[i]) > radius ? sqrt(mb.x[i] * mb.x[i] + mb.y[i] * mb.y[i] + mb.z[i] * mb.z[i]) : radius;
+		for (i = 0; i < mb.nv; ++i)
+		{
+			if (pass.hit[i])
+				continue;
+			diff_fold(&vertex, 1, &mb.x[i], &mb.y[i], &mb.z[i], f);
+			report->unmatched += !diff_covered(&vertex, f[0], radius * DIFF_WELD, pass.hit);
+		}
+		report->points = mb.nv;
+		report->rms = report->vertices ? sqrt(report->rms / report->vertices) : 0;
+		report->edge_rms = report->edges ? sqrt(report->edge_rms / report->edges) : 0;
+	}
+	free(x);
+	free(px);
+	free(side);
+	free(pass.hit);
+	diff_index_free(&vertex);
+	diff_index_free(&edge);
+	mesh_free(&mb);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+int diff_output(PROGRAM *pgm, char *a, char *b, double max)
+//---------------------------------------------------------------------------
+{
+	// Compare two solutions and print the report. Returns non zero when a
+	// solution cannot be read, a deviation is above max or a vertex orbit
+	// of b has no vertex in a.
+	DIFF_REPORT	report;
+	double		t;
+	int			failed;
+
+	t = clock_seconds();
+	if (solution_diff(pgm, a, b, &report))
+	{
+		LOG(LOG_ERROR, "compare", "cannot compare %s with %s", a, b);
+		return 2;
+	}
+	t = clock_seconds() - t;
+	failed = report.max > max || report.edge_max > max || report.unmatched;
+	printf("Comparison of %s with %s\n", a, b);
+	printf("%-10s %9s %12s %12s\n", "", "count", "max", "rms");
+	printf("%-10s %9d %12.3e %12.3e\n", "vertices", report.vertices, report.max, report.rms);
+	printf("%-10s %9d %12.3e %12.3e\n", "edges", report.edges, report.edge_max, report.edge_rms);
+	printf("%d of %d vertices of %s unmatched, %.3f ms\n", report.unmatched, report.points, b, t * 1e3);
+	printf(failed ? "DIFFERENT (limit %g)\n" : "EQUAL (limit %g)\n", max);
+	return failed;
+}
@@ -0,0 +1,917 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Exports of the whole sphere.
+
+	The sphere is 60 rotated copies of a small base mesh (mesh_instance), the
+	instanced exports write the base once with the rotations instead of every
+	copied vertex, viewers expand it on the GPU.
+
+	The solid frame (frame_output) is one strut per edge and one hub per 
+	vertex. The edges fall into a few length classes and the vertices into 
+	the valences 5 and 6, so one template mesh per class is written and every
+	strut and hub is an instance (translation and rotation) of its template:
+		strut	prism of FRAME_SIDES sides along +z from 0 to the class length,
+				one flat facing outward, placed at the first vertex of its edge
+		hub		prism of valence sides around z centred on the origin, z along
+				the vertex direction and one flat facing the first neighbour
+
+	The offset shell (shell_output) is one solid panel per face of the 
+	sphere (or of its dual) for cutting from sheet stock. The panels of a 
+	rotation orbit are congruent, so shell_build only builds the first face
+	of every orbit (about 1/60 of the sphere) and the export instances them 
+	with the 60 rotations. A panel lies between two planes parallel to its 
+	face, the outer one offset outward by 'outside' and the inner one by 
+	'outside' less the thickness. Its sides are mitred: the side of an edge 
+	lies in the plane bisecting the angle of the two faces, so neighbouring 
+	panels meet flush. Every corner is the intersection of an offset plane 
+	and the mitres of its two edges, solved for all the corners in one 
+	branch free pass (Cramer's rule on SoA arrays, the outer and inner 
+	corner share the mitre line).
+
+	glTF binary (.glb)
+		Every mesh (float positions and normals, 16 or 32 bit triangle 
+		indices) is on its own node with the EXT_mesh_gpu_instancing extension (TRANSLATION and
+		ROTATION per instance). A parent node turns the z up frame of the 
+		solutions to the y up frame of glTF. A viewer without the extension 
+		shows every template once. The normals are the vertex directions
+		on the sphere and the face normals on the flat faces of the frame 
+		(mesh_face_normals), renderers need no pass over the mesh. The 
+		buffers are written little endian as the host stores them.
+
+*/
+// icosa_export.cpp : Defines the instanced exports of the sphere (library).
+//
+#include <algorithm>
+#include "icosa_truncations.h"
+
+#define GLB_MAGIC		0x46546C67	// "glTF"
+#define GLB_VERSION		2
+#define GLB_CHUNK_JSON	0x4E4F534A	// "JSON"
+#define GLB_CHUNK_BIN	0x004E4942	// "BIN\0"
+#define GLB_JSON_SIZE	2048		// JSON of the scene and of every mesh
+
+#define FRAME_SIDES		8			// sides of the strut prisms
+#define FRAME_STRUT		0.05		// default strut radius (shortest edge)
+#define FRAME_HUB		2.5			// hub circumradius (strut radius)
+#define FRAME_CLASS		1e-9		// length difference of one strut class (unit sphere)
+
+// edge of the sphere (frame_output)
+typedef struct {
+	double	length;		// unit sphere
+	int		a, b;		// vertices
+} FRAME_EDGE;
+
+static void glb_quaternion(double m[], float q[]);
+static int glb_normals(GLB_MESH *g, float *normal);
+static void glb_frame(double *z, double *x, float *q);
+static int frame_prism(MESH *mesh, int sides, double radius, double z0, double z1, double phase);
+static void shell_plane(MESH *mesh, int f, double *plane);
+static int shell_mesh(SHELL *shell, MESH *solid);
+
+//---------------------------------------------------------------------------
+void instanced_output(PROGRAM *pgm, PATCH *patch, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Instanced sphere into <name>.glb next to the patch output (filename ends in .off)
+	MESH		tri, base;
+	GLB_MESH	glb;
+	SYMMETRY	*sym;
+	char		name[256];
+	int			i, n, drawn;
+	long		size;
+
+	if (mesh_expand(pgm, patch, &tri))
+		return;
+	drawn = mesh_instance(pgm, &tri, &base);
+	if (drawn < 0)
+	{
+		LOG(LOG_NOTE, "instanced", "\tNOTE: the rotations do not map the sphere onto itself, no instanced output");
+		mesh_free(&tri);
+		return;
+	}
+
+	memset(&glb, 0, sizeof(glb));
+	glb.mesh = &base;
+	glb.scale = pgm->radius;
+	glb.normals = GLB_NORMALS_SPHERE;
+	glb.instances = SYMMETRY_ROTATIONS;
+	glb.rotation = (float*)malloc(SYMMETRY_ROTATIONS * 4 * sizeof(float));
+	if (glb.rotation)
+	{
+		sym = symmetry_group(pgm);
+		for (i = 0; i < SYMMETRY_ROTATIONS; ++i)
+			glb_quaternion(sym->m[i], glb.rotation + i * 4);
+
+		n = (int)strlen(filename);
+		sprintf_s(name, sizeof(name), "%.*s.glb", n > 4 && !strcmp(filename + n - 4, ".off") ? n - 4 : n, filename);
+		size = glb_write(name, &glb, 1);
+		if (size >= 0)
+			LOG(LOG_INFO, "instanced_output", "\tInstanced output: %s (%d vertices, %d triangles x %d rotations, %d drawn for %d, %ld bytes)", 
+				name, base.nv, base.nf, SYMMETRY_ROTATIONS, drawn, tri.nf, size);
+		free(glb.rotation);
+	}
+	mesh_free(&tri);
+	mesh_free(&base);
+}
+
+//---------------------------------------------------------------------------
+void frame_output(PROGRAM *pgm, PATCH *patch, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Solid frame of the sphere into <name>_frame.glb next to the patch output (see above)
+	MESH		tri, *template_mesh;
+	GLB_MESH	*glb;
+	FRAME_EDGE	*edge;
+	float		*translation, *rotation;
+	double		d[3], x[3], radius, strut, hub;
+	int			*valence, *neighbour, *hubclass;
+	int			i, k, n, a, b, v, ne, nc, nh, nm, status;
+	char		name[256];
+	long		size;
+
+	if (mesh_expand(pgm, patch, &tri))
+		return;
+
+	// edges once (the triangles hold each as (a, b) and (b, a)), valences and a neighbour per vertex
+	ne = tri.nf * 3 / 2;
+	edge = (FRAME_EDGE*)malloc(ne * sizeof(FRAME_EDGE));
+	valence = (int*)calloc(tri.nv, sizeof(int));
+	neighbour = (int*)malloc(tri.nv * sizeof(int));
+	hubclass = (int*)calloc(tri.nv, sizeof(int));
+	translation = (float*)malloc((ne + tri.nv) * 3 * sizeof(float));
+	rotation = (float*)malloc((ne + tri.nv) * 4 * sizeof(float));
+	template_mesh = (MESH*)calloc(ne + tri.nv, sizeof(MESH));
+	glb = (GLB_MESH*)calloc(ne + tri.nv, sizeof(GLB_MESH));
+	if (!edge || !valence || !neighbour || !hubclass || !translation || !rotation || !template_mesh || !glb)
+	{
+		free(edge); free(valence); free(neighbour); free(hubclass); free(translation); free(rotation); free(template_mesh); free(glb);
+		mesh_free(&tri);
+		return;
+	}
+	for (i = ne = 0; i < tri.nf * 3; ++i)
+	{
+		a = tri.index[i];
+		b = tri.index[i % 3 == 2 ? i - 2 : i + 1];
+		neighbour[a] = b;
+		++valence[a];
+		if (a > b)
+			continue;
+		d[0] = tri.x[b] - tri.x[a], d[1] = tri.y[b] - tri.y[a], d[2] = tri.z[b] - tri.z[a];
+		edge[ne].a = a;
+		edge[ne].b = b;
+		edge[ne++].length = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	}
+	std::sort(edge, edge + ne, [](const FRAME_EDGE &p, const FRAME_EDGE &q) { return p.length < q.length; });
+
+	radius = pgm->radius;
+	strut = pgm->strut > 0 ? pgm->strut : FRAME_STRUT * edge[0].length * radius;
+	hub = FRAME_HUB * strut;
+
+	// strut classes: a template per length, the struts of the class as its instances
+	status = 0;
+	for (i = nm = 0; i < ne && !status; nm++)
+	{
+		glb[nm].mesh = &template_mesh[nm];
+		glb[nm].scale = 1;
+		glb[nm].normals = GLB_NORMALS_FLAT;
+		glb[nm].translation = translation + i * 3;
+		glb[nm].rotation = rotation + i * 4;
+		status = frame_prism(&template_mesh[nm], FRAME_SIDES, strut, 0, edge[i].length * radius, DTR(180.0) / FRAME_SIDES);
+		for (k = i; k < ne && edge[k].length - edge[i].length < FRAME_CLASS; ++k)
+		{
+			a = edge[k].a, b = edge[k].b;
+			d[0] = (tri.x[b] - tri.x[a]) / edge[k].length;
+			d[1] = (tri.y[b] - tri.y[a]) / edge[k].length;
+			d[2] = (tri.z[b] - tri.z[a]) / edge[k].length;
+			x[0] = tri.x[a] + tri.x[b], x[1] = tri.y[a] + tri.y[b], x[2] = tri.z[a] + tri.z[b];
+			translation[k * 3] = (float)(tri.x[a] * radius);
+			translation[k * 3 + 1] = (float)(tri.y[a] * radius);
+			translation[k * 3 + 2] = (float)(tri.z[a] * radius);
+			glb_frame(d, x, rotation + k * 4);
+		}
+		glb[nm].instances = k - i;
+		i = k;
+	}
+	nc = nm;
+
+	// hub classes: a template per valence
+	for (v = 0; v < tri.nv; ++v)
+		hubclass[v] = -1;
+	for (nh = 0, i = ne; nh < tri.nv && !status; ++nh)
+	{
+		for (v = 0; v < tri.nv && hubclass[v] >= 0; ++v)
+			;
+		if (v == tri.nv)
+			break;
+		glb[nm].mesh = &template_mesh[nm];
+		glb[nm].scale = 1;
+		glb[nm].normals = GLB_NORMALS_FLAT;
+		glb[nm].translation = translation + i * 3;
+		glb[nm].rotation = rotation + i * 4;
+		status = frame_prism(&template_mesh[nm], valence[v], hub, -strut, strut, DTR(180.0) / valence[v]);
+		for (k = v, b = valence[v]; k < tri.nv; ++k)
+		{
+			if (valence[k] != b)
+				continue;
+			hubclass[k] = nm;
+			a = neighbour[k];
+			d[0] = tri.x[k], d[1] = tri.y[k], d[2] = tri.z[k];
+			x[0] = tri.x[a] - tri.x[k], x[1] = tri.y[a] - tri.y[k], x[2] = tri.z[a] - tri.z[k];
+			translation[i * 3] = (float)(tri.x[k] * radius);
+			translation[i * 3 + 1] = (float)(tri.y[k] * radius);
+			translation[i * 3 + 2] = (float)(tri.z[k] * radius);
+			glb_frame(d, x, rotation + i * 4);
+			++i;
+			++glb[nm].instances;
+		}
+		++nm;
+	}
+
+	n = (int)strlen(filename);
+	sprintf_s(name, sizeof(name), "%.*s_frame.glb", n > 4 && !strcmp(filename + n - 4, ".off") ? n - 4 : n, filename);
+	size = status ? -1 : glb_write(name, glb, nm);
+	if (size >= 0)
+	{
+		LOG(LOG_INFO, "frame_output", "\tFrame output: %s (%d struts in %d classes, %d hubs in %d classes, %ld bytes)", 
+			name, ne, nc, tri.nv, nm - nc, size);
+		for (i = 0; i < nm; ++i)
+		{
+			if (i < nc)
+				LOG(LOG_INFO, "frame_class", "\t\tstrut %2d: %4d x length %.9f", i + 1, glb[i].instances, 
+					edge[(glb[i].translation - translation) / 3].length * radius);
+			else
+				LOG(LOG_INFO, "frame_class", "\t\thub   %2d: %4d x valence %d", i - nc + 1, glb[i].instances, template_mesh[i].nv / 6);
+		}
+	}
+
+	for (i = 0; i < nm; ++i)
+		mesh_free(&template_mesh[i]);
+	free(edge); free(valence); free(neighbour); free(hubclass); free(translation); free(rotation); free(template_mesh); free(glb);
+	mesh_free(&tri);
+}
+
+//---------------------------------------------------------------------------
+static int frame_prism(MESH *mesh, int sides, double radius, double z0, double z1, double phase)
+//---------------------------------------------------------------------------
+{
+	// Prism around the z axis from z0 to z1, corners at the radius and the 
+	// phase angle plus multiples of 360 / sides. Every face has its own 
+	// vertices (flat faces), triangles counter clockwise seen from outside.
+	double	angle;
+	int		i, k, n, f, *t;
+
+	if (mesh_alloc(mesh, sides * 6, sides * 4 - 4, (sides * 4 - 4) * 3))
+		return -1;
+	for (i = 0; i < sides * 6; ++i)
+	{
+		// sides: 4 corners (k, z0) (k + 1, z0) (k + 1, z1) (k, z1), then the caps z0 and z1
+		k = i < sides * 4 ? i / 4 + (i % 4 == 1 || i % 4 == 2) : (i - sides * 4) % sides;
+		angle = phase + DTR(360.0) * k / sides;
+		mesh->x[i] = radius * cos(angle);
+		mesh->y[i] = radius * sin(angle);
+		mesh->z[i] = i < sides * 4 ? (i % 4 < 2 ? z0 : z1) : (i < sides * 5 ? z0 : z1);
+		mesh->vorbit[i] = 0;
+	}
+	for (i = f = 0; i < sides; ++i)
+	{
+		n = i * 4;
+		t = &mesh->index[f * 3];
+		t[0] = n, t[1] = n + 1, t[2] = n + 2;
+		t[3] = n, t[4] = n + 2, t[5] = n + 3;
+		f += 2;
+	}
+	for (i = 1; i < sides - 1; ++i)
+	{
+		n = sides * 4;
+		t = &mesh->index[f * 3];
+		t[0] = n, t[1] = n + i + 1, t[2] = n + i;					// z0 facing -z
+		t[3] = n + sides, t[4] = n + sides + i, t[5] = n + sides + i + 1;	// z1 facing +z
+		f += 2;
+	}
+	for (i = 0; i < f; ++i)
+	{
+		mesh->offset[i + 1] = (i + 1) * 3;
+		mesh->forbit[i] = 0;
+	}
+	mesh->nv = sides * 6;
+	mesh->nf = f;
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void shell_output(PROGRAM *pgm, PATCH *patch, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Offset shell of the sphere, or of its dual with -dual, into 
+	// <name>_shell.glb next to the patch output (see above)
+	MESH		tri, dual, solid, *mesh;
+	SHELL		shell;
+	GLB_MESH	glb;
+	SYMMETRY	*sym;
+	char		name[256], text[LOG_MESSAGE];
+	double		t, dx, dy, dz, ex, ey, ez;
+	int			*vperm, *fperm;
+	int			i, k, n, c, e, p, inverted, status;
+	long		size;
+
+	if (mesh_expand(pgm, patch, &tri))
+		return;
+	memset(&dual, 0, sizeof(dual));
+	memset(&solid, 0, sizeof(solid));
+	memset(&shell, 0, sizeof(shell));
+	vperm = (int*)malloc(SYMMETRY_ROTATIONS * tri.nv * sizeof(int));
+	fperm = (int*)malloc(SYMMETRY_ROTATIONS * tri.nf * sizeof(int));
+	status = !vperm || !fperm ? -1 : mesh_permutation(pgm, &tri, SYMMETRY_ROTATIONS, vperm, fperm);
+	if (status)
+		LOG(LOG_NOTE, "shell", "\tNOTE: the rotations do not map the sphere onto itself, no shell output");
+
+	// the faces of the dual are the vertices of the sphere, their images too
+	mesh = &tri;
+	if (!status && pgm->dual)
+	{
+		status = dual_build(&tri, pgm->dual, &dual);
+		mesh = &dual;
+		if (status)
+			LOG(LOG_NOTE, "shell", "\tNOTE: the triangles do not form a closed surface, no shell output");
+	}
+
+	t = clock_seconds();
+	if (!status && shell_build(mesh, mesh == &dual ? vperm : fperm, pgm->outside / pgm->radius, pgm->shell / pgm->radius, &shell))
+	{
+		LOG(LOG_NOTE, "shell", "\tNOTE: the faces do not form a closed surface, no shell output");
+		status = -1;
+	}
+	t = clock_seconds() - t;
+	if (!status)
+		status = shell_mesh(&shell, &solid);
+
+	memset(&glb, 0, sizeof(glb));
+	glb.mesh = &solid;
+	glb.scale = pgm->radius;
+	glb.normals = GLB_NORMALS_FLAT;
+	glb.instances = SYMMETRY_ROTATIONS;
+	glb.rotation = status ? 0 : (float*)malloc(SYMMETRY_ROTATIONS * 4 * sizeof(float));
+	if (glb.rotation)
+	{
+		sym = symmetry_group(pgm);
+		for (i = 0; i < SYMMETRY_ROTATIONS; ++i)
+			glb_quaternion(sym->m[i], glb.rotation + i * 4);
+
+		n = (int)strlen(filename);
+		sprintf_s(name, sizeof(name), "%.*s_shell.glb", n > 4 && !strcmp(filename + n - 4, ".off") ? n - 4 : n, filename);
+		size = glb_write(name, &glb, 1);
+		if (size >= 0)
+		{
+			LOG(LOG_INFO, "shell_output", "\tShell output: %s (%d panels x %d rotations, %d drawn for %d, thickness %g, %ld bytes, built in %.1f us)", 
+				name, shell.count, SYMMETRY_ROTATIONS, shell.count * SYMMETRY_ROTATIONS, mesh->nf, pgm->shell, size, t * 1e6);
+
+			// cut list: the outer edges at the radius and their mitres, a 
+			// panel is inverted when an inner edge runs against its outer edge
+			for (p = inverted = 0; p < shell.count; ++p)
+			{
+				n = sprintf_s(text, sizeof(text), "\t\tpanel %2d: %3d x edges", p + 1, shell.orbit[p]);
+				for (c = shell.first[p], k = 0; c < shell.first[p + 1]; ++c)
+				{
+					e = c + 1 < shell.first[p + 1] ? c + 1 : shell.first[p];
+					dx = shell.x[e] - shell.x[c], dy = shell.y[e] - shell.y[c], dz = shell.z[e] - shell.z[c];
+					ex = shell.x[shell.corners + e] - shell.x[shell.corners + c];
+					ey = shell.y[shell.corners + e] - shell.y[shell.corners + c];
+					ez = shell.z[shell.corners + e] - shell.z[shell.corners + c];
+					k |= dx * ex + dy * ey + dz * ez <= 0;
+					n += sprintf_s(text + n, sizeof(text) - n, " %.6f", sqrt(dx * dx + dy * dy + dz * dz) * pgm->radius);
+				}
+				n += sprintf_s(text + n, sizeof(text) - n, "  mitres");
+				for (c = shell.first[p]; c < shell.first[p + 1]; ++c)
+					n += sprintf_s(text + n, sizeof(text) - n, " %.3f", RTD(shell.bevel[c]));
+				LOG(LOG_INFO, "shell_panel", "%s", text);
+				inverted += k;
+			}
+			if (inverted)
+				LOG(LOG_NOTE, "shell", "\tNOTE: the thickness inverts the inner face of %d panels", inverted);
+		}
+		free(glb.rotation);
+	}
+	free(vperm);
+	free(fperm);
+	shell_free(&shell);
+	mesh_free(&solid);
+	mesh_free(&dual);
+	mesh_free(&tri);
+}
+
+//---------------------------------------------------------------------------
+int shell_build(MESH *mesh, int *fperm, double outside, double thickness, SHELL *shell)
+//---------------------------------------------------------------------------
+{
+	// Offset panels of the first face of every rotation orbit (see above), 
+	// fperm holds the face images under the 60 rotations, the offsets are at
+	// the unit sphere. Returns 0 or -1 when an edge has no neighbouring face.
+	double			*nx, *ny, *nz, *nd, *mx, *my, *mz, *md;
+	double			plane[4], ux, uy, uz, wx, wy, wz, d;
+	int				*first, *face, *prev;
+	unsigned char	*covered;
+	int				i, k, j, n, c, f, g, a, b, p, status;
+
+	memset(shell, 0, sizeof(SHELL));
+	covered = (unsigned char*)calloc(mesh->nf, 1);
+	first = (int*)calloc(mesh->nv + 1, sizeof(int));
+	face = (int*)malloc(mesh->offset[mesh->nf] * sizeof(int));
+	shell->face = (int*)malloc(mesh->nf * sizeof(int));
+	shell->orbit = (int*)malloc(mesh->nf * sizeof(int));
+	if (!covered || !first || !face || !shell->face || !shell->orbit)
+	{
+		free(covered); free(first); free(face);
+		shell_free(shell);
+		return -1;
+	}
+
+	// the first face of every orbit and the faces it stands for
+	for (f = 0; f < mesh->nf; ++f)
+	{
+		if (covered[f])
+			continue;
+		shell->face[shell->count] = f;
+		shell->orbit[shell->count] = 0;
+		for (g = 0; g < SYMMETRY_ROTATIONS; ++g)
+		{
+			i = fperm[g * mesh->nf + f];
+			shell->orbit[shell->count] += !covered[i];
+			covered[i] = 1;
+		}
+		shell->corners += mesh->offset[f + 1] - mesh->offset[f];
+		++shell->count;
+	}
+	n = shell->corners;
+	shell->first = (int*)malloc((shell->count + 1) * sizeof(int));
+	shell->x = (double*)malloc(n * 7 * sizeof(double));
+	nx = (double*)malloc(n * 8 * sizeof(double));
+	prev = (int*)malloc(n * sizeof(int));
+	if (!shell->first || !shell->x || !nx || !prev)
+	{
+		free(covered); free(first); free(face); free(nx); free(prev);
+		shell_free(shell);
+		return -1;
+	}
+	shell->y = shell->x + n * 2, shell->z = shell->y + n * 2, shell->bevel = shell->z + n * 2;
+	ny = nx + n, nz = ny + n, nd = nz + n, mx = nd + n, my = mx + n, mz = my + n, md = mz + n;
+
+	// vertex to face adjacency (CSR)
+	for (i = 0; i < mesh->offset[mesh->nf]; ++i)
+		++first[mesh->index[i] + 1];
+	for (a = 0; a < mesh->nv; ++a)
+		first[a + 1] += first[a];
+	for (f = 0; f < mesh->nf; ++f)
+		for (i = mesh->offset[f]; i < mesh->offset[f + 1]; ++i)
+			face[first[mesh->index[i]]++] = f;
+	for (a = mesh->nv; a > 0; --a)
+		first[a] = first[a - 1];
+	first[0] = 0;
+
+	// the plane of every panel and the mitre of every edge (a, b), the plane 
+	// bisecting the planes of its two faces (the edge itself when they hold it)
+	status = 0;
+	for (p = c = 0; p < shell->count && !status; ++p)
+	{
+		f = shell->face[p];
+		n = mesh->offset[f + 1] - mesh->offset[f];
+		shell->first[p] = c;
+		shell_plane(mesh, f, plane);
+		for (k = 0; k < n && !status; ++k, ++c)
+		{
+			a = mesh->index[mesh->offset[f] + k];
+			b = mesh->index[mesh->offset[f] + (k + 1) % n];
+			for (i = first[a], g = -1; i < first[a + 1] && g < 0; ++i)
+			{
+				if (face[i] == f)
+					continue;
+				for (j = mesh->offset[face[i]]; j < mesh->offset[face[i] + 1] && mesh->index[j] != b; ++j)
+					;
+				if (j < mesh->offset[face[i] + 1])
+					g = face[i];
+			}
+			if (g < 0)
+			{
+				status = -1;
+				break;
+			}
+			nx[c] = plane[0], ny[c] = plane[1], nz[c] = plane[2], nd[c] = plane[3];
+			shell_plane(mesh, g, plane);
+			mx[c] = nx[c] - plane[0];
+			my[c] = ny[c] - plane[1];
+			mz[c] = nz[c] - plane[2];
+			md[c] = nd[c] - plane[3];
+			d = nx[c] * plane[0] + ny[c] * plane[1] + nz[c] * plane[2];
+			shell->bevel[c] = 0.5 * acos(d < 1 ? d : 1);
+			prev[c] = shell->first[p] + (k + n - 1) % n;
+			plane[0] = nx[c], plane[1] = ny[c], plane[2] = nz[c], plane[3] = nd[c];
+		}
+	}
+	shell->first[shell->count] = c;
+
+	// corners: the offset plane n . p = d + o and the mitres (ma, da) before 
+	// and (mb, db) after the corner, p = ((d + o) u + w) / (n . u) with the 
+	// mitre line u = ma x mb and w = da (mb x n) + db (n x ma)
+	n = shell->corners;
+	for (c = 0; c < n && !status; ++c)
+	{
+		j = prev[c];
+		ux = my[j] * mz[c] - mz[j] * my[c];
+		uy = mz[j] * mx[c] - mx[j] * mz[c];
+		uz = mx[j] * my[c] - my[j] * mx[c];
+		wx = md[j] * (my[c] * nz[c] - mz[c] * ny[c]) + md[c] * (ny[c] * mz[j] - nz[c] * my[j]);
+		wy = md[j] * (mz[c] * nx[c] - mx[c] * nz[c]) + md[c] * (nz[c] * mx[j] - nx[c] * mz[j]);
+		wz = md[j] * (mx[c] * ny[c] - my[c] * nx[c]) + md[c] * (nx[c] * my[j] - ny[c] * mx[j]);
+		d = 1 / (nx[c] * ux + ny[c] * uy + nz[c] * uz);
+		shell->x[c] = ((nd[c] + outside) * ux + wx) * d;
+		shell->y[c] = ((nd[c] + outside) * uy + wy) * d;
+		shell->z[c] = ((nd[c] + outside) * uz + wz) * d;
+		shell->x[n + c] = shell->x[c] - thickness * ux * d;
+		shell->y[n + c] = shell->y[c] - thickness * uy * d;
+		shell->z[n + c] = shell->z[c] - thickness * uz * d;
+	}
+
+	free(covered);
+	free(first);
+	free(face);
+	free(nx);
+	free(prev);
+	if (status)
+		shell_free(shell);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+void shell_free(SHELL *shell)
+//---------------------------------------------------------------------------
+{
+	free(shell->face);
+	free(shell->orbit);
+	free(shell->first);
+	free(shell->x);
+	memset(shell, 0, sizeof(SHELL));
+}
+
+//---------------------------------------------------------------------------
+static void shell_plane(MESH *mesh, int f, double *plane)
+//---------------------------------------------------------------------------
+{
+	// plane (unit normal, distance) of a face, the Newell normal through the 
+	// centroid so faces a little off plane (sphere dual) get their mean plane
+	double	x, y, z, cx, cy, cz, d;
+	int		i, a, b, n;
+
+	n = mesh->offset[f + 1] - mesh->offset[f];
+	x = y = z = cx = cy = cz = 0;
+	for (i = 0; i < n; ++i)
+	{
+		a = mesh->index[mesh->offset[f] + i];
+		b = mesh->index[mesh->offset[f] + (i + 1) % n];
+		x += (mesh->y[a] - mesh->y[b]) * (mesh->z[a] + mesh->z[b]);
+		y += (mesh->z[a] - mesh->z[b]) * (mesh->x[a] + mesh->x[b]);
+		z += (mesh->x[a] - mesh->x[b]) * (mesh->y[a] + mesh->y[b]);
+		cx += mesh->x[a], cy += mesh->y[a], cz += mesh->z[a];
+	}
+	d = 1 / sqrt(x * x + y * y + z * z);
+	plane[0] = x * d, plane[1] = y * d, plane[2] = z * d;
+	plane[3] = (plane[0] * cx + plane[1] * cy + plane[2] * cz) / n;
+}
+
+//---------------------------------------------------------------------------
+static int shell_mesh(SHELL *shell, MESH *solid)
+//---------------------------------------------------------------------------
+{
+	// Solid of every panel: the outer face, the inner face and a quad per 
+	// side, each with its own vertices (flat faces), triangles counter 
+	// clockwise seen from outside the panel. Returns 0 or -1.
+	double	*x, *y, *z;
+	int		i, k, c, e, p, n, v, f, nc, *t;
+
+	nc = shell->corners;
+	if (mesh_alloc(solid, nc * 6, nc * 4 - shell->count * 4, (nc * 4 - shell->count * 4) * 3))
+		return -1;
+	x = shell->x, y = shell->y, z = shell->z;
+	for (p = v = f = 0; p < shell->count; ++p)
+	{
+		n = shell->first[p + 1] - shell->first[p];
+
+		// outer and inner face, fans from their first corner
+		for (k = 0; k < n * 2; ++k)
+		{
+			c = shell->first[p] + k % n + (k < n ? 0 : nc);
+			solid->x[v + k] = x[c], solid->y[v + k] = y[c], solid->z[v + k] = z[c];
+		}
+		for (k = 1; k < n - 1; ++k)
+		{
+			t = &solid->index[f * 3];
+			t[0] = v, t[1] = v + k, t[2] = v + k + 1;
+			t[3] = v + n, t[4] = v + n + k + 1, t[5] = v + n + k;
+			f += 2;
+		}
+		v += n * 2;
+
+		// sides: outer c, outer e, inner e, inner c
+		for (k = 0; k < n; ++k)
+		{
+			c = shell->first[p] + k;
+			e = shell->first[p] + (k + 1) % n;
+			solid->x[v] = x[c], solid->y[v] = y[c], solid->z[v] = z[c];
+			solid->x[v + 1] = x[e], solid->y[v + 1] = y[e], solid->z[v + 1] = z[e];
+			solid->x[v + 2] = x[nc + e], solid->y[v + 2] = y[nc + e], solid->z[v + 2] = z[nc + e];
+			solid->x[v + 3] = x[nc + c], solid->y[v + 3] = y[nc + c], solid->z[v + 3] = z[nc + c];
+			t = &solid->index[f * 3];
+			t[0] = v, t[1] = v + 2, t[2] = v + 1;
+			t[3] = v, t[4] = v + 3, t[5] = v + 2;
+			f += 2;
+			v += 4;
+		}
+	}
+	for (i = 0; i < v; ++i)
+		solid->vorbit[i] = 0;
+	for (i = 0; i < f; ++i)
+	{
+		solid->offset[i + 1] = (i + 1) * 3;
+		solid->forbit[i] = 0;
+	}
+	solid->nv = v;
+	solid->nf = f;
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void glb_frame(double *z, double *x, float *q)
+//---------------------------------------------------------------------------
+{
+	// quaternion of the rotation taking +z to the unit direction z and +x 
+	// to the part of x perpendicular to it
+	double	m[16], d;
+
+	d = x[0] * z[0] + x[1] * z[1] + x[2] * z[2];
+	m[0] = x[0] - d * z[0], m[1] = x[1] - d * z[1], m[2] = x[2] - d * z[2];
+	d = 1 / sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+	m[0] *= d, m[1] *= d, m[2] *= d;
+	m[8] = z[0], m[9] = z[1], m[10] = z[2];
+	m[4] = z[1] * m[2] - z[2] * m[1];
+	m[5] = z[2] * m[0] - z[0] * m[2];
+	m[6] = z[0] * m[1] - z[1] * m[0];
+	glb_quaternion(m, q);
+}
+
+//---------------------------------------------------------------------------
+static void glb_quaternion(double m[], float q[])
+//---------------------------------------------------------------------------
+{
+	// unit quaternion (x, y, z, w) of a rotation (p' = p * m, r[i][j] = m[j * 4 + i])
+	double	r00 = m[0], r01 = m[4], r02 = m[8], r10 = m[1], r11 = m[5], r12 = m[9], r20 = m[2], r21 = m[6], r22 = m[10];
+	double	s, x, y, z, w, d;
+
+	if (r00 + r11 + r22 > 0)
+	{
+		s = 0.5 / sqrt(r00 + r11 + r22 + 1);
+		w = 0.25 / s, x = (r21 - r12) * s, y = (r02 - r20) * s, z = (r10 - r01) * s;
+	}
+	else if (r00 > r11 && r00 > r22)
+	{
+		s = 2 * sqrt(1 + r00 - r11 - r22);
+		w = (r21 - r12) / s, x = 0.25 * s, y = (r01 + r10) / s, z = (r02 + r20) / s;
+	}
+	else if (r11 > r22)
+	{
+		s = 2 * sqrt(1 + r11 - r00 - r22);
+		w = (r02 - r20) / s, x = (r01 + r10) / s, y = 0.25 * s, z = (r12 + r21) / s;
+	}
+	else
+	{
+		s = 2 * sqrt(1 + r22 - r00 - r11);
+		w = (r10 - r01) / s, x = (r02 + r20) / s, y = (r12 + r21) / s, z = 0.25 * s;
+	}
+	d = 1 / sqrt(x * x + y * y + z * z + w * w);
+	q[0] = (float)(x * d), q[1] = (float)(y * d), q[2] = (float)(z * d), q[3] = (float)(w * d);
+}
+
+//---------------------------------------------------------------------------
+static int glb_normals(GLB_MESH *g, float *normal)
+//---------------------------------------------------------------------------
+{
+	// vertex normals of a mesh (GLB_NORMALS_*) as floats, returns 0 or -1
+	double	*nx, *ny, *nz;
+	int		i, k, v;
+
+	nx = (double*)malloc((g->normals == GLB_NORMALS_FLAT ? g->mesh->nf : g->mesh->nv) * 3 * sizeof(double));
+	if (!nx)
+		return -1;
+	if (g->normals == GLB_NORMALS_FLAT)
+	{
+		// the normal of the face of every vertex (faces do not share vertices)
+		ny = nx + g->mesh->nf, nz = ny + g->mesh->nf;
+		mesh_face_normals(g->mesh, nx, ny, nz);
+		for (i = 0; i < g->mesh->nf; ++i)
+		{
+			for (k = 0; k < 3; ++k)
+			{
+				v = g->mesh->index[i * 3 + k];
+				normal[v * 3] = (float)nx[i], normal[v * 3 + 1] = (float)ny[i], normal[v * 3 + 2] = (float)nz[i];
+			}
+		}
+	}
+	else
+	{
+		ny = nx + g->mesh->nv, nz = ny + g->mesh->nv;
+		mesh_vertex_normals(g->mesh, nx, ny, nz);
+		for (v = 0; v < g->mesh->nv; ++v)
+			normal[v * 3] = (float)nx[v], normal[v * 3 + 1] = (float)ny[v], normal[v * 3 + 2] = (float)nz[v];
+	}
+	free(nx);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+long glb_write(char *filename, GLB_MESH *mesh, int count)
+//---------------------------------------------------------------------------
+{
+	// glTF binary of the triangle meshes and their instances (see above). 
+	// Returns the file size or -1.
+	FILE			*fp;
+	GLB_MESH		*g;
+	char			*json;
+	unsigned char	*bin;
+	float			*position, lo[3], hi[3];
+	unsigned short	*index16;
+	unsigned int	header[5], *index32;
+	int				i, m, n, size, wide, view, npos, nidx, nbin, njson, status;
+	int				normal, translation, rotation;
+
+	// buffer: positions, normals, triangle indices and the instance translations and rotations of every mesh
+	for (m = nbin = 0; m < count; ++m)
+	{
+		g = &mesh[m];
+		nbin += g->mesh->nv * (g->normals ? 24 : 12) + ((g->mesh->nf * 3 * (g->mesh->nv > 65535 ? 4 : 2) + 3) & ~3);
+		nbin += (g->instances && g->translation ? g->instances * 12 : 0) + (g->instances && g->rotation ? g->instances * 16 : 0);
+	}
+	size = GLB_JSON_SIZE * (count + 1);
+	bin = (unsigned char*)calloc(nbin, 1);
+	json = (char*)malloc(size);
+	if (!bin || !json)
+	{
+		free(bin);
+		free(json);
+		return -1;
+	}
+
+	// the buffer views of a mesh (one accessor each) are the position, the 
+	// normal, the indices, the translation and the rotation that it has
+	n = sprintf_s(json, size, 
+		"{\"asset\":{\"version\":\"2.0\",\"generator\":\"icosa_truncations\"},"
+		"\"extensionsUsed\":[\"EXT_mesh_gpu_instancing\"],"
+		"\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+		"\"buffers\":[{\"byteLength\":%d}],"
+		"\"nodes\":[{\"rotation\":[-0.70710678,0,0,0.70710678],\"children\":[", nbin);
+	for (m = 0; m < count; ++m)
+		n += sprintf_s(json + n, size - n, "%s%d", m ? "," : "", m + 1);
+	n += sprintf_s(json + n, size - n, "]}");
+	for (m = view = 0; m < count; ++m)
+	{
+		g = &mesh[m];
+		normal = g->normals != 0;
+		translation = g->instances && g->translation;
+		rotation = g->instances && g->rotation;
+		n += sprintf_s(json + n, size - n, ",{\"mesh\":%d", m);
+		if (g->instances)
+		{
+			n += sprintf_s(json + n, size - n, ",\"extensions\":{\"EXT_mesh_gpu_instancing\":{\"attributes\":{");
+			if (translation)
+				n += sprintf_s(json + n, size - n, "\"TRANSLATION\":%d%s", view + 2 + normal, rotation ? "," : "");
+			if (rotation)
+				n += sprintf_s(json + n, size - n, "\"ROTATION\":%d", view + 2 + normal + translation);
+			n += sprintf_s(json + n, size - n, "}}}");
+		}
+		n += sprintf_s(json + n, size - n, "}");
+		view += 2 + normal + translation + rotation;
+	}
+	n += sprintf_s(json + n, size - n, "],\"meshes\":[");
+	for (m = view = 0; m < count; ++m)
+	{
+		g = &mesh[m];
+		normal = g->normals != 0;
+		n += sprintf_s(json + n, size - n, "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%d", m ? "," : "", view);
+		if (normal)
+			n += sprintf_s(json + n, size - n, ",\"NORMAL\":%d", view + 1);
+		n += sprintf_s(json + n, size - n, "},\"indices\":%d}]}", view + 1 + normal);
+		view += 2 + normal + (g->instances && g->translation) + (g->instances && g->rotation);
+	}
+
+	// the data and its buffer views
+	n += sprintf_s(json + n, size - n, "],\"bufferViews\":[");
+	for (m = 0, nbin = 0, status = 0; m < count; ++m)
+	{
+		g = &mesh[m];
+		wide = g->mesh->nv > 65535;
+		npos = g->mesh->nv * 12;
+		nidx = g->mesh->nf * 3 * (wide ? 4 : 2);
+		position = (float*)(bin + nbin);
+		for (i = 0; i < g->mesh->nv; ++i)
+		{
+			position[i * 3] = (float)(g->mesh->x[i] * g->scale);
+			position[i * 3 + 1] = (float)(g->mesh->y[i] * g->scale);
+			position[i * 3 + 2] = (float)(g->mesh->z[i] * g->scale);
+		}
+		n += sprintf_s(json + n, size - n, "%s{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d,\"target\":34962}", m ? "," : "", nbin, npos);
+		nbin += npos;
+		if (g->normals)
+		{
+			status |= glb_normals(g, (float*)(bin + nbin));
+			n += sprintf_s(json + n, size - n, ",{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d,\"target\":34962}", nbin, npos);
+			nbin += npos;
+		}
+		index16 = (unsigned short*)(bin + nbin);
+		index32 = (unsigned int*)(bin + nbin);
+		for (i = 0; i < g->mesh->nf * 3; ++i)
+		{
+			if (wide)
+				index32[i] = g->mesh->index[i];
+			else
+				index16[i] = (unsigned short)g->mesh->index[i];
+		}
+		n += sprintf_s(json + n, size - n, ",{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d,\"target\":34963}", nbin, nidx);
+		nbin += (nidx + 3) & ~3;
+		if (g->instances && g->translation)
+		{
+			memcpy(bin + nbin, g->translation, g->instances * 12);
+			n += sprintf_s(json + n, size - n, ",{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d}", nbin, g->instances * 12);
+			nbin += g->instances * 12;
+		}
+		if (g->instances && g->rotation)
+		{
+			memcpy(bin + nbin, g->rotation, g->instances * 16);
+			n += sprintf_s(json + n, size - n, ",{\"buffer\":0,\"byteOffset\":%d,\"byteLength\":%d}", nbin, g->instances * 16);
+			nbin += g->instances * 16;
+		}
+	}
+
+	// accessors in the order of the buffer views
+	n += sprintf_s(json + n, size - n, "],\"accessors\":[");
+	for (m = 0, view = 0, nbin = 0; m < count; ++m)
+	{
+		g = &mesh[m];
+		position = (float*)(bin + nbin);
+		for (i = 0; i < g->mesh->nv * 3; ++i)
+		{
+			lo[i % 3] = i < 3 || position[i] < lo[i % 3] ? position[i] : lo[i % 3];
+			hi[i % 3] = i < 3 || position[i] > hi[i % 3] ? position[i] : hi[i % 3];
+		}
+		n += sprintf_s(json + n, size - n, "%s{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\","
+			"\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]}", m ? "," : "", view++, g->mesh->nv, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]);
+		if (g->normals)
+			n += sprintf_s(json + n, size - n, ",{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"}", view++, g->mesh->nv);
+		n += sprintf_s(json + n, size - n, ",{\"bufferView\":%d,\"componentType\":%d,\"count\":%d,\"type\":\"SCALAR\"}", 
+			view++, g->mesh->nv > 65535 ? 5125 : 5123, g->mesh->nf * 3);
+		nbin += g->mesh->nv * (g->normals ? 24 : 12) + ((g->mesh->nf * 3 * (g->mesh->nv > 65535 ? 4 : 2) + 3) & ~3);
+		if (g->instances && g->translation)
+		{
+			n += sprintf_s(json + n, size - n, ",{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"}", view++, g->instances);
+			nbin += g->instances * 12;
+		}
+		if (g->instances && g->rotation)
+		{
+			n += sprintf_s(json + n, size - n, ",{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC4\"}", view++, g->instances);
+			nbin += g->instances * 16;
+		}
+	}
+	n += sprintf_s(json + n, size - n, "]}");
+	for (njson = n; njson % 4; ++njson)
+		json[njson] = ' ';
+
+	fp = 0;
+	if (!status)
+		fopen_s(&fp, filename, "wb");
+	if (!fp)
+	{
+		free(bin);
+		free(json);
+		return -1;
+	}
+	header[0] = GLB_MAGIC;
+	header[1] = GLB_VERSION;
+	header[2] = 12 + 8 + njson + 8 + nbin;
+	header[3] = njson;
+	header[4] = GLB_CHUNK_JSON;
+	fwrite(header, sizeof(unsigned int), 5, fp);
+	fwrite(json, 1, njson, fp);
+	header[0] = nbin;
+	header[1] = GLB_CHUNK_BIN;
+	fwrite(header, sizeof(unsigned int), 2, fp);
+	fwrite(bin, 1, nbin, fp);
+	status = ferror(fp);
+	fclose(fp);
+	free(bin);
+	free(json);
+	return status ? -1 : 12 + 8 + njson + 8 + nbin;
+}
@@ -0,0 +1,962 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Whole sphere geometry from the LCD patch.
+
+	A solved configuration is one LCD patch, the sphere is its images under 
+	the 120 transforms of the icosahedral group (60 rotations and their 
+	compositions with the central inversion). symmetry_group builds the group 
+	once in the global frame of the patch (face 0 centred on the z axis) from
+	a 3 fold rotation about the face centre and a 5 fold rotation about one of
+	its corners.
+
+	mesh_expand maps the patch vertices through every transform, welds the
+	coincident images (the patch overlaps the neighbouring LCD areas) with a 
+	spatial hash and keeps every distinct triangle once, oriented counter 
+	clockwise seen from outside. Every vertex and face keeps its orbit (the 
+	vertex id of the construction, the first patch triangle) so later stages
+	can work on one representative per orbit.
+
+	dual_build builds the truncated dual: one dual vertex per triangle and
+	one pentagon or hexagon around every vertex. The faces around a vertex 
+	come from the vertex to triangle adjacency (CSR) and are ordered by 
+	walking the shared edges. The dual vertices are computed in one pass over
+	the triangles (SoA arrays, no branches):
+		DUAL_SPHERE		circumcentre projected to the sphere (the normal of the 
+						triangle plane), the dual vertices stay on the sphere
+		DUAL_POLAR		intersection of the tangent planes at the three corners
+						(polar reciprocal), the dual faces are planar
+
+	mesh_instance picks the triangles of the sphere whose images under the 60 
+	rotations cover it, one per rotation orbit, nearest to the patch first so 
+	they form one piece (about two LCD areas: the improper transforms are not 
+	instanced, renderers would flip their winding). The instanced exports 
+	write this base once with the rotations. Triangles centred on a rotation 
+	axis (face centres) are drawn once per rotation fixing them.
+
+	Meshes hold their faces in CSR form (offset, index) so triangles and 
+	polygons share one type and one OFF writer.
+
+	dual_planarity fits a plane to dual faces (least squares: the normal is 
+	the eigenvector of the smallest eigenvalue of the 3x3 covariance, solved 
+	in closed form) and measures the out of plane deviation of their corners.
+	The faces of an orbit are congruent, so only the first face of every 
+	orbit is evaluated unless all faces are requested (verification).
+
+*/
+// icosa_geometry.cpp : Defines the symmetry group, sphere expansion and dual (library).
+//
+#include <mutex>
+#include "icosa_truncations.h"
+
+#define WELD_CELL		1e-6	// spatial hash cell of the weld
+#define WELD_TOLERANCE	1e-9	// distance of coincident vertices (unit sphere)
+#define MESH_BLOCK		256		// triangles per block of mesh_face_normals
+
+// triangle of the sphere and its distance from the patch (mesh_instance)
+typedef struct {
+	double	distance;
+	int		f;
+} INSTANCE_ORDER;
+
+static void symmetry_init(PROGRAM *pgm, SYMMETRY *sym);
+static void symmetry_rotation(double *axis, double angle, double m[]);
+static int symmetry_find(SYMMETRY *sym, double m[]);
+static unsigned int weld_hash(long long x, long long y, long long z);
+static int weld_find(MESH *mesh, int *head, int *next, unsigned mask, double x, double y, double z, unsigned *bucket);
+static int instance_compare(const void *a, const void *b);
+static void plane_fit(int n, double *c, double *normal);
+
+//---------------------------------------------------------------------------
+SYMMETRY *symmetry_group(PROGRAM *pgm)
+//---------------------------------------------------------------------------
+{
+	// the icosahedral group in the global frame, built once (all programs share the frame)
+	static SYMMETRY			group;
+	static std::once_flag	once;
+
+	std::call_once(once, symmetry_init, pgm, &group);
+	return &group;
+}
+
+//---------------------------------------------------------------------------
+static void symmetry_init(PROGRAM *pgm, SYMMETRY *sym)
+//---------------------------------------------------------------------------
+{
+	// Close the group of the 3 fold rotation about the centre of face 0 and
+	// the 5 fold rotation about its first corner, then add the inversions.
+	GUT_SPHERICAL_COORD	sc;
+	GUT_POINT			local[3], corner[3];
+	double				generator[2][16], m[16], axis[3];
+	int					i, k, g;
+
+	// corners of the local face (build_face_transforms) in the global frame
+	sc.radius = 1;
+	sc.inclination = DTR(180.0) - atan(2.0);
+	sc.azimuth = DTR(36.0);
+	gut_spherical_to_cartesian(&sc, &local[0]);
+	sc.inclination = atan(2.0);
+	sc.azimuth = 0;
+	gut_spherical_to_cartesian(&sc, &local[1]);
+	sc.inclination = DTR(180.0) - atan(2.0);
+	sc.azimuth = DTR(-36.0);
+	gut_spherical_to_cartesian(&sc, &local[2]);
+	for (i = 0; i < 3; ++i)
+		local[i].w = 0;
+	mtx_vec4_multiply(3, (GUT_VECTOR*)local, (GUT_VECTOR*)corner, pgm->face.tm);
+	for (i = 0; i < 3; ++i)
+	{
+		sym->corner[i][0] = corner[i].x;
+		sym->corner[i][1] = corner[i].y;
+		sym->corner[i][2] = corner[i].z;
+	}
+
+	axis[0] = corner[0].x + corner[1].x + corner[2].x;
+	axis[1] = corner[0].y + corner[1].y + corner[2].y;
+	axis[2] = corner[0].z + corner[1].z + corner[2].z;
+	symmetry_rotation(axis, DTR(120.0), generator[0]);
+	axis[0] = corner[0].x;
+	axis[1] = corner[0].y;
+	axis[2] = corner[0].z;
+	symmetry_rotation(axis, DTR(72.0), generator[1]);
+
+	// breadth first closure of the rotations
+	mtx_set_unity(sym->m[0]);
+	sym->count = 1;
+	for (i = 0; i < sym->count && sym->count < SYMMETRY_ROTATIONS; ++i)
+	{
+		for (g = 0; g < 2; ++g)
+		{
+			mtx_multiply_matrix(sym->m[i], generator[g], m);
+			if (symmetry_find(sym, m) < 0 && sym->count < SYMMETRY_ROTATIONS)
+				memcpy(sym->m[sym->count++], m, sizeof(m));
+		}
+	}
+
+	// rotations composed with the central inversion
+	for (i = 0; i < SYMMETRY_ROTATIONS; ++i)
+	{
+		for (k = 0; k < 16; ++k)
+			sym->m[SYMMETRY_ROTATIONS + i][k] = (k % 4 < 3 && k < 12) ? -sym->m[i][k] : sym->m[i][k];
+	}
+	sym->count = SYMMETRY_ORDER;
+}
+
+//---------------------------------------------------------------------------
+static void symmetry_rotation(double *axis, double angle, double m[])
+//---------------------------------------------------------------------------
+{
+	// rotation about the axis (Rodrigues) in the row vector form of mtx_vec4_multiply
+	double	x, y, z, d, c, s, t, r[3][3];
+	int		i, k;
+
+	d = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	x = axis[0] / d;
+	y = axis[1] / d;
+	z = axis[2] / d;
+	c = cos(angle);
+	s = sin(angle);
+	t = 1 - c;
+	r[0][0] = t * x * x + c;		r[0][1] = t * x * y - s * z;	r[0][2] = t * x * z + s * y;
+	r[1][0] = t * x * y + s * z;	r[1][1] = t * y * y + c;		r[1][2] = t * y * z - s * x;
+	r[2][0] = t * x * z - s * y;	r[2][1] = t * y * z + s * x;	r[2][2] = t * z * z + c;
+
+	mtx_set_unity(m);
+	for (i = 0; i < 3; ++i)
+	{
+		for (k = 0; k < 3; ++k)
+			m[k * 4 + i] = r[i][k]; // p' = p * m
+	}
+}
+
+//---------------------------------------------------------------------------
+static int symmetry_find(SYMMETRY *sym, double m[])
+//---------------------------------------------------------------------------
+{
+	// index of the transform equal to m or -1
+	int		i, k;
+
+	for (i = 0; i < sym->count; ++i)
+	{
+		for (k = 0; k < 16 && fabs(sym->m[i][k] - m[k]) < 1e-9; ++k)
+			;
+		if (k == 16)
+			return i;
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+int mesh_alloc(MESH *mesh, int nv, int nf, int ni)
+//---------------------------------------------------------------------------
+{
+	// arrays of a mesh with room for the vertices, faces and face indices
+	memset(mesh, 0, sizeof(MESH));
+	mesh->x = (double*)malloc(nv * sizeof(double));
+	mesh->y = (double*)malloc(nv * sizeof(double));
+	mesh->z = (double*)malloc(nv * sizeof(double));
+	mesh->vorbit = (int*)malloc(nv * sizeof(int));
+	mesh->offset = (int*)malloc((nf + 1) * sizeof(int));
+	mesh->index = (int*)malloc(ni * sizeof(int));
+	mesh->forbit = (int*)malloc(nf * sizeof(int));
+	if (!mesh->x || !mesh->y || !mesh->z || !mesh->vorbit || !mesh->offset || !mesh->index || !mesh->forbit)
+	{
+		mesh_free(mesh);
+		return -1;
+	}
+	mesh->offset[0] = 0;
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void mesh_free(MESH *mesh)
+//---------------------------------------------------------------------------
+{
+	free(mesh->x);
+	free(mesh->y);
+	free(mesh->z);
+	free(mesh->vorbit);
+	free(mesh->offset);
+	free(mesh->index);
+	free(mesh->forbit);
+	memset(mesh, 0, sizeof(MESH));
+}
+
+//---------------------------------------------------------------------------
+static unsigned int weld_hash(long long x, long long y, long long z)
+//---------------------------------------------------------------------------
+{
+	return (unsigned int)((x * 73856093LL) ^ (y * 19349663LL) ^ (z * 83492791LL));
+}
+
+//---------------------------------------------------------------------------
+static int weld_find(MESH *mesh, int *head, int *next, unsigned mask, double x, double y, double z, unsigned *bucket)
+//---------------------------------------------------------------------------
+{
+	// mesh vertex coincident with the point (hash chains per cell, 27 neighbour 
+	// cells) or -1, the bucket of the point's own cell for the insertion
+	long long	cx, cy, cz, dx, dy, dz;
+	double		d;
+	int			k, n;
+
+	cx = (long long)floor(x / WELD_CELL);
+	cy = (long long)floor(y / WELD_CELL);
+	cz = (long long)floor(z / WELD_CELL);
+	if (bucket)
+		*bucket = weld_hash(cx, cy, cz) & mask;
+	for (n = 0; n < 27; ++n)
+	{
+		dx = n % 3 - 1, dy = n / 3 % 3 - 1, dz = n / 9 - 1;
+		for (k = head[weld_hash(cx + dx, cy + dy, cz + dz) & mask]; k >= 0; k = next[k])
+		{
+			d = fabs(mesh->x[k] - x) + fabs(mesh->y[k] - y) + fabs(mesh->z[k] - z);
+			if (d < WELD_TOLERANCE)
+				return k;
+		}
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+int mesh_expand(PROGRAM *pgm, PATCH *patch, MESH *mesh)
+//---------------------------------------------------------------------------
+{
+	// Triangles of the whole unit sphere from the solved patch (see above).
+	// Returns 0 or -1 when the images do not close into a sphere.
+	SYMMETRY	*sym;
+	GUT_POINT	gp[20], image[20];
+	int			*map, *head, *next, *table, *t;
+	unsigned	h, mask, size, tmask;
+	double		nx, ny, nz;
+	int			g, i, f, a, b, c, nv, nf, capacity, found;
+
+	sym = symmetry_group(pgm);
+	patch_geometry(pgm, patch, gp);
+	capacity = SYMMETRY_ORDER * patch->nv;
+	if (mesh_alloc(mesh, capacity, SYMMETRY_ORDER * patch->nf, SYMMETRY_ORDER * patch->nf * 3))
+		return -1;
+
+	for (size = 1; size < (unsigned)capacity * 2; size <<= 1)
+		;
+	mask = size - 1;
+	for (tmask = 1; tmask < (unsigned)(SYMMETRY_ORDER * patch->nf) * 2; tmask <<= 1)
+		;
+	--tmask;
+	map = (int*)malloc(capacity * sizeof(int));
+	head = (int*)malloc(size * sizeof(int));
+	next = (int*)malloc(capacity * sizeof(int));
+	table = (int*)malloc((tmask + 1) * sizeof(int));
+	if (!map || !head || !next || !table)
+	{
+		free(map); free(head); free(next); free(table);
+		mesh_free(mesh);
+		return -1;
+	}
+
+	// weld the images of the patch vertices
+	for (h = 0; h < size; ++h)
+		head[h] = -1;
+	for (i = 0; i < patch->nv; ++i)
+		gp[i].w = 0;
+	for (g = nv = 0; g < SYMMETRY_ORDER; ++g)
+	{
+		mtx_vec4_multiply(patch->nv, (GUT_VECTOR*)gp, (GUT_VECTOR*)image, sym->m[g]);
+		for (i = 0; i < patch->nv; ++i)
+		{
+			found = weld_find(mesh, head, next, mask, image[i].x, image[i].y, image[i].z, &h);
+			if (found < 0)
+			{
+				found = nv++;
+				mesh->x[found] = image[i].x;
+				mesh->y[found] = image[i].y;
+				mesh->z[found] = image[i].z;
+				mesh->vorbit[found] = patch->vr[i].v;
+				next[found] = head[h];
+				head[h] = found;
+			}
+			map[g * patch->nv + i] = found;
+		}
+	}
+
+	// distinct triangles (open addressing on the sorted corners), outward orientation
+	for (h = 0; h <= tmask; ++h)
+		table[h] = -1;
+	for (f = nf = 0; f < patch->nf; ++f)
+	{
+		for (g = 0; g < SYMMETRY_ORDER; ++g)
+		{
+			a = map[g * patch->nv + patch->f[f][0]];
+			b = map[g * patch->nv + patch->f[f][1]];
+			c = map[g * patch->nv + patch->f[f][2]];
+			if (a == b || b == c || a == c)
+				continue;
+			h = (weld_hash(a < b ? (a < c ? a : c) : (b < c ? b : c), a + b + c, (long long)a * b * c) & tmask);
+			for (; table[h] >= 0; h = (h + 1) & tmask)
+			{
+				t = &mesh->index[table[h] * 3];
+				if (a + b + c == t[0] + t[1] + t[2] && (a == t[0] || a == t[1] || a == t[2])
+					&& (b == t[0] || b == t[1] || b == t[2]) && (c == t[0] || c == t[1] || c == t[2]))
+					break;
+			}
+			if (table[h] >= 0)
+				continue;
+			table[h] = nf;
+
+			// counter clockwise seen from outside
+			nx = (mesh->y[b] - mesh->y[a]) * (mesh->z[c] - mesh->z[a]) - (mesh->z[b] - mesh->z[a]) * (mesh->y[c] - mesh->y[a]);
+			ny = (mesh->z[b] - mesh->z[a]) * (mesh->x[c] - mesh->x[a]) - (mesh->x[b] - mesh->x[a]) * (mesh->z[c] - mesh->z[a]);
+			nz = (mesh->x[b] - mesh->x[a]) * (mesh->y[c] - mesh->y[a]) - (mesh->y[b] - mesh->y[a]) * (mesh->x[c] - mesh->x[a]);
+			t = &mesh->index[nf * 3];
+			t[0] = a;
+			if (nx * (mesh->x[a] + mesh->x[b] + mesh->x[c]) + ny * (mesh->y[a] + mesh->y[b] + mesh->y[c]) + nz * (mesh->z[a] + mesh->z[b] + mesh->z[c]) >= 0)
+				t[1] = b, t[2] = c;
+			else
+				t[1] = c, t[2] = b;
+			mesh->forbit[nf++] = f;
+			mesh->offset[nf] = nf * 3;
+		}
+	}
+	free(map);
+	free(head);
+	free(next);
+	free(table);
+
+	mesh->nv = nv;
+	mesh->nf = nf;
+
+	// a closed triangulated sphere has V - E + F = 2 with E = 3F / 2
+	if (2 * nv - nf != 4)
+	{
+		LOG(LOG_NOTE, "sphere", "\tNOTE: the patch images do not close into a sphere (%d vertices, %d triangles)", nv, nf);
+		mesh_free(mesh);
+		return -1;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static int instance_compare(const void *a, const void *b)
+//---------------------------------------------------------------------------
+{
+	// triangles by increasing distance from the patch (INSTANCE_ORDER)
+	double	da = ((INSTANCE_ORDER*)a)->distance, db = ((INSTANCE_ORDER*)b)->distance;
+
+	return da < db ? -1 : da > db ? 1 : ((INSTANCE_ORDER*)a)->f - ((INSTANCE_ORDER*)b)->f;
+}
+
+//---------------------------------------------------------------------------
+int mesh_permutation(PROGRAM *pgm, MESH *tri, int transforms, int *vperm, int *fperm)
+//---------------------------------------------------------------------------
+{
+	// Vertex (vperm[g * nv + v]) and triangle (fperm[g * nf + f]) images under
+	// the first transforms of the group, the vertices through the weld hash 
+	// of the sphere and the triangles through the vertex to triangle 
+	// adjacency. Returns 0 or -1 when a transform does not map the mesh onto itself.
+	SYMMETRY	*sym;
+	double		*m, x, y, z;
+	int			*head, *next, *first, *face, *t;
+	unsigned	h, mask, size;
+	int			g, i, k, f, v, a, b, c, status;
+
+	sym = symmetry_group(pgm);
+	for (size = 1; size < (unsigned)tri->nv * 2; size <<= 1)
+		;
+	mask = size - 1;
+	head = (int*)malloc(size * sizeof(int));
+	next = (int*)malloc(tri->nv * sizeof(int));
+	first = (int*)calloc(tri->nv + 1, sizeof(int));
+	face = (int*)malloc(tri->nf * 3 * sizeof(int));
+	if (!head || !next || !first || !face)
+	{
+		free(head); free(next); free(first); free(face);
+		return -1;
+	}
+	status = 0;
+
+	for (h = 0; h < size; ++h)
+		head[h] = -1;
+	for (v = 0; v < tri->nv; ++v)
+	{
+		weld_find(tri, head, next, mask, tri->x[v], tri->y[v], tri->z[v], &h);
+		next[v] = head[h];
+		head[h] = v;
+	}
+	for (g = 0; g < transforms && !status; ++g)
+	{
+		m = sym->m[g];
+		for (v = 0; v < tri->nv && !status; ++v)
+		{
+			x = tri->x[v] * m[0] + tri->y[v] * m[4] + tri->z[v] * m[8];
+			y = tri->x[v] * m[1] + tri->y[v] * m[5] + tri->z[v] * m[9];
+			z = tri->x[v] * m[2] + tri->y[v] * m[6] + tri->z[v] * m[10];
+			if ((vperm[g * tri->nv + v] = weld_find(tri, head, next, mask, x, y, z, 0)) < 0)
+				status = -1;
+		}
+	}
+
+	// vertex to triangle adjacency (CSR)
+	for (i = 0; i < tri->nf * 3; ++i)
+		++first[tri->index[i] + 1];
+	for (v = 0; v < tri->nv; ++v)
+		first[v + 1] += first[v];
+	for (f = 0; f < tri->nf; ++f)
+		for (k = 0; k < 3; ++k)
+			face[first[tri->index[f * 3 + k]]++] = f;
+	for (v = tri->nv; v > 0; --v)
+		first[v] = first[v - 1];
+	first[0] = 0;
+
+	// the triangle around the image of the first corner holding the other two
+	for (g = 0; g < transforms && !status; ++g)
+	{
+		for (f = 0; f < tri->nf && !status; ++f)
+		{
+			a = vperm[g * tri->nv + tri->index[f * 3]];
+			b = vperm[g * tri->nv + tri->index[f * 3 + 1]];
+			c = vperm[g * tri->nv + tri->index[f * 3 + 2]];
+			for (k = first[a]; k < first[a + 1]; ++k)
+			{
+				t = &tri->index[face[k] * 3];
+				if ((b == t[0] || b == t[1] || b == t[2]) && (c == t[0] || c == t[1] || c == t[2]))
+					break;
+			}
+			if (k < first[a + 1])
+				fperm[g * tri->nf + f] = face[k];
+			else
+				status = -1;
+		}
+	}
+	free(head);
+	free(next);
+	free(first);
+	free(face);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+int mesh_instance(PROGRAM *pgm, MESH *tri, MESH *base)
+//---------------------------------------------------------------------------
+{
+	// Triangles of the sphere whose images under the 60 rotations cover it 
+	// once (see above), nearest to the patch first so the base stays in one 
+	// piece. Returns the number of triangles the rotations draw (the sphere 
+	// plus the repeats of the triangles centred on a rotation axis) or -1.
+	INSTANCE_ORDER	*order;
+	double			x, y, z;
+	int				*vperm, *fperm, *map, *t;
+	unsigned char	*covered;
+	int				g, i, k, f, v, nv, nf, status;
+
+	vperm = (int*)malloc(SYMMETRY_ROTATIONS * tri->nv * sizeof(int));
+	fperm = (int*)malloc(SYMMETRY_ROTATIONS * tri->nf * sizeof(int));
+	map = (int*)malloc(tri->nv * sizeof(int));
+	order = (INSTANCE_ORDER*)malloc(tri->nf * sizeof(INSTANCE_ORDER));
+	covered = (unsigned char*)calloc(tri->nf, 1);
+	memset(base, 0, sizeof(MESH));
+	if (!vperm || !fperm || !map || !order || !covered)
+	{
+		free(vperm); free(fperm); free(map); free(order); free(covered);
+		return -1;
+	}
+	status = mesh_permutation(pgm, tri, SYMMETRY_ROTATIONS, vperm, fperm);
+
+	// orbit representatives, nearest to the first triangle (patch) first
+	t = tri->index;
+	x = tri->x[t[0]] + tri->x[t[1]] + tri->x[t[2]];
+	y = tri->y[t[0]] + tri->y[t[1]] + tri->y[t[2]];
+	z = tri->z[t[0]] + tri->z[t[1]] + tri->z[t[2]];
+	for (f = 0; f < tri->nf; ++f)
+	{
+		t = &tri->index[f * 3];
+		order[f].f = f;
+		order[f].distance = -(x * (tri->x[t[0]] + tri->x[t[1]] + tri->x[t[2]]) + y * (tri->y[t[0]] + tri->y[t[1]] + tri->y[t[2]])
+			+ z * (tri->z[t[0]] + tri->z[t[1]] + tri->z[t[2]]));
+	}
+	qsort(order, tri->nf, sizeof(INSTANCE_ORDER), instance_compare);
+	for (i = nf = 0; i < tri->nf && !status; ++i)
+	{
+		f = order[i].f;
+		if (covered[f])
+			continue;
+		order[nf++].f = f;
+		for (g = 0; g < SYMMETRY_ROTATIONS; ++g)
+			covered[fperm[g * tri->nf + f]] = 1;
+	}
+
+	// base mesh of the representatives and the vertices they use
+	for (v = 0; v < tri->nv; ++v)
+		map[v] = -1;
+	for (i = nv = 0; i < nf * 3; ++i)
+		if (map[v = tri->index[order[i / 3].f * 3 + i % 3]] < 0)
+			map[v] = nv++;
+	if (!status && mesh_alloc(base, nv, nf, nf * 3))
+		status = -1;
+	for (v = 0; v < tri->nv && !status; ++v)
+	{
+		if ((k = map[v]) < 0)
+			continue;
+		base->x[k] = tri->x[v];
+		base->y[k] = tri->y[v];
+		base->z[k] = tri->z[v];
+		base->vorbit[k] = tri->vorbit[v];
+	}
+	for (i = 0; i < nf && !status; ++i)
+	{
+		f = order[i].f;
+		for (k = 0; k < 3; ++k)
+			base->index[i * 3 + k] = map[tri->index[f * 3 + k]];
+		base->forbit[i] = tri->forbit[f];
+		base->offset[i + 1] = (i + 1) * 3;
+	}
+	if (!status)
+	{
+		base->nv = nv;
+		base->nf = nf;
+		status = nf * SYMMETRY_ROTATIONS;
+	}
+	free(vperm);
+	free(fperm);
+	free(map);
+	free(order);
+	free(covered);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+int dual_build(MESH *tri, int method, MESH *dual)
+//---------------------------------------------------------------------------
+{
+	// Dual of a closed triangle mesh (see above): vertex i of the dual is 
+	// triangle i, face i of the dual surrounds vertex i. Returns 0 or -1.
+	double	*ax, *ay, *az, *bx, *by, *bz, *cx, *cy, *cz;
+	double	nx, ny, nz, d;
+	int		*first, *face, *corner;
+	int		i, k, j, v, n, f, from, nf;
+
+	nf = tri->nf;
+	if (mesh_alloc(dual, nf, tri->nv, nf * 3))
+		return -1;
+	first = (int*)calloc(tri->nv + 1, sizeof(int));
+	face = (int*)malloc(nf * 3 * sizeof(int));
+	corner = (int*)malloc(nf * 3 * sizeof(int));
+	ax = (double*)malloc(nf * 9 * sizeof(double));
+	if (!first || !face || !corner || !ax)
+	{
+		free(first); free(face); free(corner); free(ax);
+		mesh_free(dual);
+		return -1;
+	}
+	ay = ax + nf, az = ay + nf, bx = az + nf, by = bx + nf, bz = by + nf, cx = bz + nf, cy = cx + nf, cz = cy + nf;
+
+	// vertex to triangle adjacency (CSR): triangles and the corner of the vertex in each
+	for (i = 0; i < nf * 3; ++i)
+		++first[tri->index[i] + 1];
+	for (v = 0; v < tri->nv; ++v)
+		first[v + 1] += first[v];
+	for (f = 0; f < nf; ++f)
+	{
+		for (k = 0; k < 3; ++k)
+		{
+			v = tri->index[f * 3 + k];
+			n = first[v]++;
+			face[n] = f;
+			corner[n] = k;
+		}
+	}
+	for (v = tri->nv; v > 0; --v)
+		first[v] = first[v - 1];
+	first[0] = 0;
+
+	// dual faces: walk the triangles around each vertex counter clockwise, the 
+	// triangle after (v, a, b) is the one continuing with (v, b, ...)
+	for (v = 0, n = 0; v < tri->nv; ++v)
+	{
+		dual->offset[v] = n;
+		dual->forbit[v] = tri->vorbit[v];
+		j = first[v];
+		for (k = first[v]; k < first[v + 1]; ++k)
+		{
+			dual->index[n++] = face[j];
+			from = tri->index[face[j] * 3 + (corner[j] + 2) % 3]; // b of (v, a, b)
+			for (i = first[v]; i < first[v + 1] && tri->index[face[i] * 3 + (corner[i] + 1) % 3] != from; ++i)
+				;
+			if (i == first[v + 1])
+			{
+				free(first); free(face); free(corner); free(ax);
+				mesh_free(dual);
+				return -1; // not a closed manifold mesh
+			}
+			j = i;
+		}
+	}
+	dual->offset[tri->nv] = n;
+
+	// dual vertices, one pass over the triangle corners in SoA form
+	if (method == DUAL_POLAR)
+	{
+		for (f = 0; f < nf; ++f)
+		{
+			ax[f] = tri->x[tri->index[f * 3]], ay[f] = tri->y[tri->index[f * 3]], az[f] = tri->z[tri->index[f * 3]];
+			bx[f] = tri->x[tri->index[f * 3 + 1]], by[f] = tri->y[tri->index[f * 3 + 1]], bz[f] = tri->z[tri->index[f * 3 + 1]];
+			cx[f] = tri->x[tri->index[f * 3 + 2]], cy[f] = tri->y[tri->index[f * 3 + 2]], cz[f] = tri->z[tri->index[f * 3 + 2]];
+		}
+
+		// x . a = x . b = x . c = 1: x = (b x c + c x a + a x b) / (a . (b x c))
+		for (f = 0; f < nf; ++f)
+		{
+			nx = (by[f] * cz[f] - bz[f] * cy[f]) + (cy[f] * az[f] - cz[f] * ay[f]) + (ay[f] * bz[f] - az[f] * by[f]);
+			ny = (bz[f] * cx[f] - bx[f] * cz[f]) + (cz[f] * ax[f] - cx[f] * az[f]) + (az[f] * bx[f] - ax[f] * bz[f]);
+			nz = (bx[f] * cy[f] - by[f] * cx[f]) + (cx[f] * ay[f] - cy[f] * ax[f]) + (ax[f] * by[f] - ay[f] * bx[f]);
+			d = ax[f] * (by[f] * cz[f] - bz[f] * cy[f]) + ay[f] * (bz[f] * cx[f] - bx[f] * cz[f]) + az[f] * (bx[f] * cy[f] - by[f] * cx[f]);
+			dual->x[f] = nx / d;
+			dual->y[f] = ny / d;
+			dual->z[f] = nz / d;
+		}
+	}
+	else
+		mesh_face_normals(tri, dual->x, dual->y, dual->z); // normal of the triangle plane through the circumcentre
+	for (f = 0; f < nf; ++f)
+		dual->vorbit[f] = tri->forbit[f];
+	dual->nv = nf;
+	dual->nf = tri->nv;
+
+	free(first);
+	free(face);
+	free(corner);
+	free(ax);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void mesh_write_off(FILE *fp, MESH *mesh, double radius)
+//---------------------------------------------------------------------------
+{
+	// OFF geometry of the mesh (unit sphere) at the radius, polygons as index lists
+	int		i, k;
+
+	fprintf(fp, "OFF\n");
+	fprintf(fp, "%d %d 0\n", mesh->nv, mesh->nf);
+	for (i = 0; i < mesh->nv; ++i)
+		fprintf(fp, "%12.9f %12.9f %12.9f \n", mesh->x[i] * radius, mesh->y[i] * radius, mesh->z[i] * radius);
+	for (i = 0; i < mesh->nf; ++i)
+	{
+		fprintf(fp, "%d", mesh->offset[i + 1] - mesh->offset[i]);
+		for (k = mesh->offset[i]; k < mesh->offset[i + 1]; ++k)
+			fprintf(fp, " %d", mesh->index[k]);
+		fprintf(fp, " \n");
+	}
+}
+
+//---------------------------------------------------------------------------
+void mesh_vertex_normals(MESH *mesh, double *nx, double *ny, double *nz)
+//---------------------------------------------------------------------------
+{
+	// normals of the vertices of a sphere mesh: their directions (no pass over the faces)
+	double	d;
+	int		i;
+
+	for (i = 0; i < mesh->nv; ++i)
+	{
+		d = 1 / sqrt(mesh->x[i] * mesh->x[i] + mesh->y[i] * mesh->y[i] + mesh->z[i] * mesh->z[i]);
+		nx[i] = mesh->x[i] * d;
+		ny[i] = mesh->y[i] * d;
+		nz[i] = mesh->z[i] * d;
+	}
+}
+
+//---------------------------------------------------------------------------
+void mesh_face_normals(MESH *mesh, double *nx, double *ny, double *nz)
+//---------------------------------------------------------------------------
+{
+	// Unit normals of the triangles (counter clockwise outward). The corners 
+	// are gathered into SoA blocks, the cross products and normalisation run
+	// over the blocks without branches.
+	double	ax[MESH_BLOCK], ay[MESH_BLOCK], az[MESH_BLOCK], bx[MESH_BLOCK], by[MESH_BLOCK], bz[MESH_BLOCK];
+	double	cx[MESH_BLOCK], cy[MESH_BLOCK], cz[MESH_BLOCK], x, y, z, d;
+	int		f, i, n, *t;
+
+	for (f = 0; f < mesh->nf; f += n)
+	{
+		n = mesh->nf - f < MESH_BLOCK ? mesh->nf - f : MESH_BLOCK;
+		for (i = 0; i < n; ++i)
+		{
+			t = &mesh->index[(f + i) * 3];
+			ax[i] = mesh->x[t[0]], ay[i] = mesh->y[t[0]], az[i] = mesh->z[t[0]];
+			bx[i] = mesh->x[t[1]], by[i] = mesh->y[t[1]], bz[i] = mesh->z[t[1]];
+			cx[i] = mesh->x[t[2]], cy[i] = mesh->y[t[2]], cz[i] = mesh->z[t[2]];
+		}
+		for (i = 0; i < n; ++i)
+		{
+			x = (by[i] - ay[i]) * (cz[i] - az[i]) - (bz[i] - az[i]) * (cy[i] - ay[i]);
+			y = (bz[i] - az[i]) * (cx[i] - ax[i]) - (bx[i] - ax[i]) * (cz[i] - az[i]);
+			z = (bx[i] - ax[i]) * (cy[i] - ay[i]) - (by[i] - ay[i]) * (cx[i] - ax[i]);
+			d = 1 / sqrt(x * x + y * y + z * z);
+			nx[f + i] = x * d;
+			ny[f + i] = y * d;
+			nz[f + i] = z * d;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+void dual_output(PROGRAM *pgm, PATCH *patch, char *filename)
+//---------------------------------------------------------------------------
+{
+	// Dual of the whole sphere into <name>_dual.off next to the patch output 
+	// (filename ends in .off) and the planarity report of its faces.
+	MESH	tri, dual;
+	FILE	*fp;
+	char	name[256];
+	int		i, n, count[3];
+
+	if (mesh_expand(pgm, patch, &tri))
+		return;
+	if (dual_build(&tri, pgm->dual ? pgm->dual : DUAL_SPHERE, &dual))
+	{
+		LOG(LOG_NOTE, "dual", "\tNOTE: the triangles do not form a closed surface, no dual");
+		mesh_free(&tri);
+		return;
+	}
+
+	if (pgm->planarity)
+		planarity_report(pgm, &dual);
+
+	n = (int)strlen(filename);
+	sprintf_s(name, sizeof(name), "%.*s_dual.off", n > 4 && !strcmp(filename + n - 4, ".off") ? n - 4 : n, filename);
+	fp = 0;
+	if (pgm->dual)
+		fopen_s(&fp, name, "w");
+	if (fp)
+	{
+		mesh_write_off(fp, &dual, pgm->radius);
+		fclose(fp);
+
+		// pentagons, hexagons and any other polygon
+		count[0] = count[1] = count[2] = 0;
+		for (i = 0; i < dual.nf; ++i)
+		{
+			n = dual.offset[i + 1] - dual.offset[i];
+			++count[n == 5 ? 0 : n == 6 ? 1 : 2];
+		}
+		LOG(LOG_INFO, "dual_output", "\tDual output: %s (%d vertices, %d pentagons, %d hexagons)", name, dual.nv, count[0], count[1]);
+		if (count[2])
+			LOG(LOG_NOTE, "dual", "\tNOTE: %d dual faces are neither pentagons nor hexagons", count[2]);
+	}
+	mesh_free(&tri);
+	mesh_free(&dual);
+}
+
+//---------------------------------------------------------------------------
+void planarity_report(PROGRAM *pgm, MESH *dual)
+//---------------------------------------------------------------------------
+{
+	// log the out of plane deviation of the dual faces per orbit at the radius
+	PLANARITY	planarity[PLANARITY_CLASSES];
+	double		t, max;
+	int			i, n;
+
+	t = clock_seconds();
+	n = dual_planarity(dual, 0, planarity, PLANARITY_CLASSES);
+	t = clock_seconds() - t;
+	if (n < 0)
+		return;
+	for (i = 0, max = 0; i < n; ++i)
+		max = planarity[i].max > max ? planarity[i].max : max;
+	LOG(LOG_INFO, "planarity", "\tPlanarity of the %s dual faces: max deviation %.3e (%d orbits evaluated in %.1f us)", 
+		pgm->dual == DUAL_POLAR ? "polar" : "sphere", max * pgm->radius, n, t * 1e6);
+	for (i = 0; i < n; ++i)
+		LOG(LOG_INFO, "planarity_class", "\t\tvertex %2d: %d x %-8s max %.3e  mean %.3e", planarity[i].orbit, planarity[i].faces, 
+			planarity[i].sides == 5 ? "pentagon" : planarity[i].sides == 6 ? "hexagon" : "polygon", 
+			planarity[i].max * pgm->radius, planarity[i].mean * pgm->radius);
+}
+
+//---------------------------------------------------------------------------
+int dual_planarity(MESH *dual, int all, PLANARITY *planarity, int size)
+//---------------------------------------------------------------------------
+{
+	// Out of plane deviation (unit sphere) of the dual faces per orbit, the 
+	// first face of each orbit or all of them. Returns the number of orbits 
+	// (classes in planarity, ordered by orbit) or -1.
+	double	*c, *centre, *normal, d, x, y, z, dx, dy, dz, sum, max;
+	int		*face, *slot, i, k, n, f, classes, orbits;
+
+	for (f = orbits = 0; f < dual->nf; ++f)
+		orbits = dual->forbit[f] + 1 > orbits ? dual->forbit[f] + 1 : orbits;
+	slot = (int*)malloc(orbits * sizeof(int));
+	face = (int*)malloc(dual->nf * sizeof(int));
+	c = (double*)malloc(dual->nf * 12 * sizeof(double));
+	if (!slot || !face || !c)
+	{
+		free(slot); free(face); free(c);
+		return -1;
+	}
+	centre = c + dual->nf * 6;
+	normal = centre + dual->nf * 3;
+
+	// classes in orbit order and the faces to evaluate
+	for (i = 0; i < orbits; ++i)
+		slot[i] = -1;
+	for (f = 0; f < dual->nf; ++f)
+		slot[dual->forbit[f]] = 0;
+	for (i = classes = 0; i < orbits; ++i)
+	{
+		if (slot[i] < 0 || classes == size)
+			continue;
+		slot[i] = classes;
+		memset(&planarity[classes], 0, sizeof(PLANARITY));
+		planarity[classes++].orbit = i;
+	}
+	for (f = n = 0; f < dual->nf; ++f)
+	{
+		k = slot[dual->forbit[f]];
+		if (k < 0)
+			continue;
+		if (!planarity[k].faces++ || all)
+		{
+			planarity[k].sides = dual->offset[f + 1] - dual->offset[f];
+			face[n++] = f;
+		}
+	}
+
+	// centroid and covariance (xx xy xz yy yz zz) of every evaluated face
+	for (i = 0; i < n; ++i)
+	{
+		f = face[i];
+		x = y = z = 0;
+		for (k = dual->offset[f]; k < dual->offset[f + 1]; ++k)
+		{
+			x += dual->x[dual->index[k]];
+			y += dual->y[dual->index[k]];
+			z += dual->z[dual->index[k]];
+		}
+		d = 1.0 / (dual->offset[f + 1] - dual->offset[f]);
+		centre[i * 3] = x *= d, centre[i * 3 + 1] = y *= d, centre[i * 3 + 2] = z *= d;
+		for (k = 0; k < 6; ++k)
+			c[i * 6 + k] = 0;
+		for (k = dual->offset[f]; k < dual->offset[f + 1]; ++k)
+		{
+			dx = dual->x[dual->index[k]] - x, dy = dual->y[dual->index[k]] - y, dz = dual->z[dual->index[k]] - z;
+			c[i * 6 + 0] += dx * dx, c[i * 6 + 1] += dx * dy, c[i * 6 + 2] += dx * dz;
+			c[i * 6 + 3] += dy * dy, c[i * 6 + 4] += dy * dz, c[i * 6 + 5] += dz * dz;
+		}
+	}
+
+	// all the planes at once
+	plane_fit(n, c, normal);
+
+	// deviation of the corners from the plane through the centroid
+	for (i = 0; i < n; ++i)
+	{
+		f = face[i];
+		for (sum = max = 0, k = dual->offset[f]; k < dual->offset[f + 1]; ++k)
+		{
+			d = fabs((dual->x[dual->index[k]] - centre[i * 3]) * normal[i * 3] + (dual->y[dual->index[k]] - centre[i * 3 + 1]) * normal[i * 3 + 1] 
+				+ (dual->z[dual->index[k]] - centre[i * 3 + 2]) * normal[i * 3 + 2]);
+			sum += d;
+			max = d > max ? d : max;
+		}
+		k = slot[dual->forbit[f]];
+		planarity[k].max = max > planarity[k].max ? max : planarity[k].max;
+		planarity[k].mean += sum / (dual->offset[f + 1] - dual->offset[f]);
+		++planarity[k].evaluated;
+	}
+	for (k = 0; k < classes; ++k)
+		planarity[k].mean /= planarity[k].evaluated;
+
+	free(slot);
+	free(face);
+	free(c);
+	return classes;
+}
+
+//---------------------------------------------------------------------------
+static void plane_fit(int n, double *c, double *normal)
+//---------------------------------------------------------------------------
+{
+	// Normals of n planes from their covariances (xx xy xz yy yz zz each): the
+	// eigenvector of the smallest eigenvalue, closed form for symmetric 3x3
+	// (trigonometric eigenvalues, the vector from the largest cross product of
+	// two rows of the shifted matrix).
+	double	a00, a01, a02, a11, a12, a22, q, p, p1, p2, r, phi, e;
+	double	b00, b11, b22, u[3], v[3], w[3], lu, lv, lw, *best, l;
+	int		i;
+
+	for (i = 0; i < n; ++i, c += 6, normal += 3)
+	{
+		a00 = c[0], a01 = c[1], a02 = c[2], a11 = c[3], a12 = c[4], a22 = c[5];
+		p1 = a01 * a01 + a02 * a02 + a12 * a12;
+		q = (a00 + a11 + a22) / 3;
+		p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q) + (a22 - q) * (a22 - q) + 2 * p1;
+		p = sqrt(p2 / 6);
+		if (p <= 0)
+		{
+			normal[0] = 0, normal[1] = 0, normal[2] = 1; // degenerate, all corners coincide
+			continue;
+		}
+		b00 = (a00 - q) / p, b11 = (a11 - q) / p, b22 = (a22 - q) / p;
+		r = 0.5 * (b00 * (b11 * b22 - a12 * a12 / (p * p)) - a01 / p * (a01 / p * b22 - a12 / p * a02 / p) 
+			+ a02 / p * (a01 / p * a12 / p - b11 * a02 / p));
+		r = r < -1 ? -1 : r > 1 ? 1 : r;
+		phi = acos(r) / 3;
+		e = q + 2 * p * cos(phi + 2.0943951023931954923); // smallest eigenvalue
+
+		// rows of A - e I, the null vector is orthogonal to all of them
+		u[0] = a01 * a12 - a02 * (a11 - e), u[1] = a02 * a01 - (a00 - e) * a12, u[2] = (a00 - e) * (a11 - e) - a01 * a01;
+		v[0] = a01 * (a22 - e) - a02 * a12, v[1] = a02 * a02 - (a00 - e) * (a22 - e), v[2] = (a00 - e) * a12 - a01 * a02;
+		w[0] = (a11 - e) * (a22 - e) - a12 * a12, w[1] = a12 * a02 - a01 * (a22 - e), w[2] = a01 * a12 - (a11 - e) * a02;
+		lu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+		lv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		lw = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+		best = lu >= lv && lu >= lw ? u : lv >= lw ? v : w;
+		l = sqrt(best == u ? lu : best == v ? lv : lw);
+		normal[0] = best[0] / l, normal[1] = best[1] / l, normal[2] = best[2] / l;
+	}
+}
@@ -0,0 +1,977 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Spatial queries on the solved sphere.
+
+	Point in panel (panel_find): the triangle of the sphere mesh holding a 
+	direction. The direction is first canonicalised with the icosahedral 
+	group. In the standard frame of the icosahedron (vertices at the cyclic
+	permutations of (0, +-1, +-phi)) the sign changes of the coordinates and
+	their cyclic permutations are transforms of the group (the pyritohedral 
+	subgroup, 24 elements), so the absolute values rotated to put the 
+	largest first move any direction into the domain x >= y, x >= z >= 0 
+	(1/24 of the sphere) without a search. The index keeps the rotation of
+	the global frame into the standard frame and the group transform of 
+	every sign and permutation case.
+
+	In the domain the direction is projected from the centre of the sphere 
+	onto the plane touching the domain (gnomonic, the planes of the triangle
+	edges through the centre become lines) and a grid over the domain lists
+	the few triangles that can hold it. The triangle with the largest 
+	smallest edge distance is the answer (on an edge either neighbour, never
+	none), mapped back by the triangle permutation of the transform. A query 
+	is a fixed number of operations and one grid cell for any mesh size.
+
+	Nearest vertices (near_find): the k vertices of the sphere nearest to a
+	point. All the vertices are on the sphere, so the order is the order of
+	the dot products and the point folds like a direction. Every cell of 
+	the grid lists the vertices within the distance of the k-th nearest 
+	vertex of its centre plus twice the cell radius, a superset of the k 
+	nearest of any point in the cell. The build buckets the directions of 
+	the vertices into boxes and a cell only looks at the boxes around its 
+	centre, so it stays linear in the vertices. A query evaluates the 
+	distances of the list in one loop (vectorized), keeps the k best and 
+	maps them back by the vertex permutation of the transform.
+
+*/
+// icosa_index.cpp : Defines the spatial queries on the sphere (library).
+//
+#include <algorithm>
+#include "icosa_truncations.h"
+
+#define PANEL_MARGIN	1e-6	// grid margin around the projected domain
+#define PANEL_CONTAINS	1e-12	// edge distance of a direction on the edge of its triangle (panel_test)
+#define PANEL_PHI		1.6180339887498949
+#define PANEL_BLOCK		256		// directions per block of panel_find_batch
+#define NEAR_SLACK		1e-9	// angle added to the cell lists against rounding
+
+static void panel_point(PANEL_FOLD *fold, double *p, double *x, double *y);
+static double panel_brute(MESH *mesh, double *d, int *triangle);
+static int near_select(NEAR_INDEX *index, double *p, int n, int g, int k, int *vertex, double *distance);
+static int near_gather(int b, int *box, int *member, double *c, double r, int *found);
+static void near_brute(MESH *mesh, double *d, int k, int *vertex, double *distance);
+
+//---------------------------------------------------------------------------
+int panel_fold_build(SYMMETRY *sym, PANEL_FOLD *fold)
+//---------------------------------------------------------------------------
+{
+	// Standard frame, fold cases and domain projection of the group (see 
+	// above). Returns 0 or -1.
+	double	target[3][3], inverse[9], domain[4][3], lo[2], hi[2], p[3], q[3], a[3], *m;
+	double	d, r;
+	int		g, i, j, k, n;
+
+	// rotation of the global frame into the standard frame: the corners of 
+	// face 0 onto the face (0, 1, phi) (0, -1, phi) (phi, 0, 1), frame = corner^-1 target
+	d = 1 / sqrt(1 + PANEL_PHI * PANEL_PHI);
+	target[0][0] = 0, target[0][1] = d, target[0][2] = PANEL_PHI * d;
+	target[1][0] = 0, target[1][1] = -d, target[1][2] = PANEL_PHI * d;
+	target[2][0] = PANEL_PHI * d, target[2][1] = 0, target[2][2] = d;
+	m = &sym->corner[0][0];
+	inverse[0] = m[4] * m[8] - m[5] * m[7], inverse[1] = m[2] * m[7] - m[1] * m[8], inverse[2] = m[1] * m[5] - m[2] * m[4];
+	inverse[3] = m[5] * m[6] - m[3] * m[8], inverse[4] = m[0] * m[8] - m[2] * m[6], inverse[5] = m[2] * m[3] - m[0] * m[5];
+	inverse[6] = m[3] * m[7] - m[4] * m[6], inverse[7] = m[1] * m[6] - m[0] * m[7], inverse[8] = m[0] * m[4] - m[1] * m[3];
+	d = 1 / (m[0] * inverse[0] + m[1] * inverse[3] + m[2] * inverse[6]);
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 3; ++j)
+			fold->frame[i * 3 + j] = (inverse[i * 3] * target[0][j] + inverse[i * 3 + 1] * target[1][j] + inverse[i * 3 + 2] * target[2][j]) * d;
+	m = fold->frame;
+	if (m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]) < 0)
+		m[0] = -m[0], m[3] = -m[3], m[6] = -m[6]; // the mirror x -> -x keeps the icosahedron, the frame a rotation
+
+	// the group transform of every sign and permutation case: the transforms that are signed 
+	// cyclic permutations in the standard frame, named by the case of their image of a domain point
+	for (i = 0; i < PANEL_CASES; ++i)
+		fold->region[i] = -1;
+	q[0] = 3 / sqrt(14.0), q[1] = 2 / sqrt(14.0), q[2] = 1 / sqrt(14.0);
+	for (g = n = 0; g < SYMMETRY_ORDER; ++g)
+	{
+		// the transform in the standard frame: frame^T m frame
+		for (i = 0; i < 3; ++i)
+			for (j = 0; j < 3; ++j)
+				inverse[i * 3 + j] = 0;
+		for (i = 0; i < 3; ++i)
+			for (j = 0; j < 3; ++j)
+				for (k = 0; k < 9; ++k)
+					inverse[i * 3 + j] += fold->frame[(k / 3) * 3 + i] * sym->m[g][(k / 3) * 4 + k % 3] * fold->frame[(k % 3) * 3 + j];
+		for (k = 0; k < 9 && (fabs(inverse[k]) < 1e-9 || fabs(fabs(inverse[k]) - 1) < 1e-9); ++k)
+			;
+		if (k < 9)
+			continue;
+		for (j = 0; j < 3; ++j)
+			a[j] = q[0] * inverse[j] + q[1] * inverse[3 + j] + q[2] * inverse[6 + j];
+		i = panel_fold(a, p);
+		if (fold->region[i] >= 0 || ++n > PANEL_CASES)
+			break;
+		fold->region[i] = g;
+	}
+	if (n != PANEL_CASES)
+		return -1;
+
+	// gnomonic projection touching the domain: its corners (1,0,0) (1,1,0) (1,0,1) (1,1,1) and their centre
+	domain[0][0] = 1, domain[0][1] = 0, domain[0][2] = 0;
+	domain[1][0] = sqrt(0.5), domain[1][1] = sqrt(0.5), domain[1][2] = 0;
+	domain[2][0] = sqrt(0.5), domain[2][1] = 0, domain[2][2] = sqrt(0.5);
+	domain[3][0] = sqrt(1 / 3.0), domain[3][1] = sqrt(1 / 3.0), domain[3][2] = sqrt(1 / 3.0);
+	for (k = 0; k < 3; ++k)
+		fold->origin[k] = domain[0][k] + domain[1][k] + domain[2][k] + domain[3][k];
+	d = 1 / sqrt(fold->origin[0] * fold->origin[0] + fold->origin[1] * fold->origin[1] + fold->origin[2] * fold->origin[2]);
+	for (k = 0; k < 3; ++k)
+		fold->origin[k] *= d;
+	d = fold->origin[0];
+	for (k = 0; k < 3; ++k)
+		fold->u[k] = domain[0][k] - d * fold->origin[k];
+	d = 1 / sqrt(fold->u[0] * fold->u[0] + fold->u[1] * fold->u[1] + fold->u[2] * fold->u[2]);
+	for (k = 0; k < 3; ++k)
+		fold->u[k] *= d;
+	fold->v[0] = fold->origin[1] * fold->u[2] - fold->origin[2] * fold->u[1];
+	fold->v[1] = fold->origin[2] * fold->u[0] - fold->origin[0] * fold->u[2];
+	fold->v[2] = fold->origin[0] * fold->u[1] - fold->origin[1] * fold->u[0];
+	for (i = 0, r = 1; i < 4; ++i)
+	{
+		panel_point(fold, domain[i], &a[0], &a[1]);
+		for (k = 0; k < 2; ++k)
+		{
+			lo[k] = i && lo[k] < a[k] ? lo[k] : a[k];
+			hi[k] = i && hi[k] > a[k] ? hi[k] : a[k];
+		}
+		d = domain[i][0] * fold->origin[0] + domain[i][1] * fold->origin[1] + domain[i][2] * fold->origin[2];
+		r = d < r ? d : r;
+	}
+	fold->radius = acos(r);
+	for (k = 0; k < 2; ++k)
+		fold->lo[k] = lo[k] - PANEL_MARGIN, fold->hi[k] = hi[k] + PANEL_MARGIN;
+	return 0;
+
+}
+
+//---------------------------------------------------------------------------
+int panel_index_build(PROGRAM *pgm, PATCH *patch, PANEL_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	// Index of the sphere of the solved program (see above). Returns 0 or -1.
+	SYMMETRY	*sym;
+	MESH		*mesh;
+	PANEL_FOLD	*fold;
+	double		corner[3][2], lo[2], hi[2], p[3], *standard;
+	double		d, r, reach;
+	int			*vperm, *fperm, *candidate, *t;
+	int			g, i, j, k, f, n, x0, x1, y0, y1, x, y, status;
+
+	memset(index, 0, sizeof(PANEL_INDEX));
+	mesh = &index->mesh;
+	if (mesh_expand(pgm, patch, mesh))
+		return -1;
+	sym = index->sym = symmetry_group(pgm);
+
+	fold = &index->fold;
+	status = panel_fold_build(sym, fold);
+	r = fold->radius;
+	lo[0] = fold->lo[0], lo[1] = fold->lo[1];
+	hi[0] = fold->hi[0], hi[1] = fold->hi[1];
+
+	// candidates: triangles whose centre is within the domain radius plus the radius of the triangle
+	candidate = (int*)malloc(mesh->nf * sizeof(int));
+	vperm = (int*)malloc(SYMMETRY_ORDER * mesh->nv * sizeof(int));
+	fperm = (int*)malloc(SYMMETRY_ORDER * mesh->nf * sizeof(int));
+	standard = (double*)malloc(mesh->nv * 3 * sizeof(double));
+	if (!candidate || !vperm || !fperm || !standard || status)
+		status = -1;
+	for (i = 0; i < mesh->nv && !status; ++i)
+	{
+		// the mesh in the standard frame
+		p[0] = mesh->x[i], p[1] = mesh->y[i], p[2] = mesh->z[i];
+		for (k = 0; k < 3; ++k)
+			standard[i * 3 + k] = p[0] * fold->frame[k] + p[1] * fold->frame[3 + k] + p[2] * fold->frame[6 + k];
+	}
+	for (f = n = 0; f < mesh->nf && !status; ++f)
+	{
+		t = &mesh->index[f * 3];
+		for (k = 0; k < 3; ++k)
+			p[k] = standard[t[0] * 3 + k] + standard[t[1] * 3 + k] + standard[t[2] * 3 + k];
+		d = 1 / sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		p[0] *= d, p[1] *= d, p[2] *= d;
+		for (k = 0, reach = 1; k < 3; ++k)
+		{
+			d = p[0] * standard[t[k] * 3] + p[1] * standard[t[k] * 3 + 1] + p[2] * standard[t[k] * 3 + 2];
+			reach = d < reach ? d : reach;
+		}
+		reach = r + acos(reach);
+		if (acos(std::min(1.0, p[0] * fold->origin[0] + p[1] * fold->origin[1] + p[2] * fold->origin[2])) <= reach)
+		{
+			candidate[n++] = f;
+			for (k = 0; k < 3; ++k)
+				if (standard[t[k] * 3] * fold->origin[0] + standard[t[k] * 3 + 1] * fold->origin[1] + standard[t[k] * 3 + 2] * fold->origin[2] <= 0)
+					status = -1; // behind the projection plane
+		}
+	}
+
+	// edge lines of the candidates (unit normals pointing inside) and the grid cells they cover
+	index->nc = n;
+	index->grid = (int)ceil(2 * sqrt((double)n));
+	index->grid = index->grid < 4 ? 4 : index->grid;
+	index->lo[0] = lo[0], index->lo[1] = lo[1];
+	index->scale[0] = index->grid / (hi[0] - lo[0]);
+	index->scale[1] = index->grid / (hi[1] - lo[1]);
+	index->cell = (int*)calloc(index->grid * index->grid + 1, sizeof(int));
+	index->edge = (double*)malloc(n * 9 * sizeof(double));
+	index->image = (int*)malloc(SYMMETRY_ORDER * n * sizeof(int));
+	if (!index->cell || !index->edge || !index->image)
+		status = -1;
+	for (j = 0; j < 2 && !status; ++j)
+	{
+		// count the cells of every candidate, then list them
+		for (k = 0; k < n; ++k)
+		{
+			t = &mesh->index[candidate[k] * 3];
+			for (i = 0; i < 3; ++i)
+			{
+				panel_point(fold, &standard[t[i] * 3], &corner[i][0], &corner[i][1]);
+			}
+			x0 = (int)floor((std::min(std::min(corner[0][0], corner[1][0]), corner[2][0]) - lo[0]) * index->scale[0]);
+			x1 = (int)floor((std::max(std::max(corner[0][0], corner[1][0]), corner[2][0]) - lo[0]) * index->scale[0]);
+			y0 = (int)floor((std::min(std::min(corner[0][1], corner[1][1]), corner[2][1]) - lo[1]) * index->scale[1]);
+			y1 = (int)floor((std::max(std::max(corner[0][1], corner[1][1]), corner[2][1]) - lo[1]) * index->scale[1]);
+			x0 = x0 < 0 ? 0 : x0, y0 = y0 < 0 ? 0 : y0;
+			x1 = x1 >= index->grid ? index->grid - 1 : x1, y1 = y1 >= index->grid ? index->grid - 1 : y1;
+			for (y = y0; y <= y1; ++y)
+				for (x = x0; x <= x1; ++x)
+					if (j)
+						index->list[index->cell[y * index->grid + x]++] = k;
+					else
+						++index->cell[y * index->grid + x + 1];
+			for (i = 0; i < 3 && j; ++i)
+			{
+				// a x + b y + c >= 0 inside (counter clockwise), distance in the projection plane
+				x = (i + 1) % 3;
+				index->edge[k * 9 + i * 3] = corner[i][1] - corner[x][1];
+				index->edge[k * 9 + i * 3 + 1] = corner[x][0] - corner[i][0];
+				d = 1 / sqrt(index->edge[k * 9 + i * 3] * index->edge[k * 9 + i * 3] + index->edge[k * 9 + i * 3 + 1] * index->edge[k * 9 + i * 3 + 1]);
+				index->edge[k * 9 + i * 3] *= d;
+				index->edge[k * 9 + i * 3 + 1] *= d;
+				index->edge[k * 9 + i * 3 + 2] = -(index->edge[k * 9 + i * 3] * corner[i][0] + index->edge[k * 9 + i * 3 + 1] * corner[i][1]);
+			}
+		}
+		if (j)
+		{
+			// the fill advanced every cell to the next one
+			for (i = index->grid * index->grid; i > 0; --i)
+				index->cell[i] = index->cell[i - 1];
+			index->cell[0] = 0;
+		}
+		else
+		{
+			for (i = 0; i < index->grid * index->grid; ++i)
+				index->cell[i + 1] += index->cell[i];
+			index->list = (int*)malloc((index->cell[index->grid * index->grid] + 1) * sizeof(int));
+			status = index->list ? 0 : -1;
+		}
+	}
+
+	// candidates under every transform (the permutations do not depend on the frame)
+	if (!status)
+		status = mesh_permutation(pgm, mesh, SYMMETRY_ORDER, vperm, fperm);
+	for (g = 0; g < SYMMETRY_ORDER && !status; ++g)
+		for (k = 0; k < n; ++k)
+			index->image[g * n + k] = fperm[g * mesh->nf + candidate[k]];
+	free(candidate);
+	free(vperm);
+	free(fperm);
+	free(standard);
+	if (status)
+		panel_index_free(index);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+void panel_index_free(PANEL_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	mesh_free(&index->mesh);
+	free(index->cell);
+	free(index->list);
+	free(index->edge);
+	free(index->image);
+	memset(index, 0, sizeof(PANEL_INDEX));
+}
+
+//---------------------------------------------------------------------------
+int panel_fold(double *d, double *p)
+//---------------------------------------------------------------------------
+{
+	// Direction of the standard frame into the domain (p), returns its case:
+	// the signs of the coordinates times 3 plus the cyclic permutation
+	double	a, b, c;
+	int		k, s;
+
+	s = (d[0] < 0) | (d[1] < 0) << 1 | (d[2] < 0) << 2;
+	a = fabs(d[0]), b = fabs(d[1]), c = fabs(d[2]);
+	k = a >= b && a >= c ? 0 : b >= c ? 1 : 2;
+	p[0] = k == 0 ? a : k == 1 ? b : c;
+	p[1] = k == 0 ? b : k == 1 ? c : a;
+	p[2] = k == 0 ? c : k == 1 ? a : b;
+	return s * 3 + k;
+}
+
+//---------------------------------------------------------------------------
+static void panel_point(PANEL_FOLD *fold, double *p, double *x, double *y)
+//---------------------------------------------------------------------------
+{
+	// gnomonic projection of a direction onto the plane touching the domain
+	double	w = 1 / (p[0] * fold->origin[0] + p[1] * fold->origin[1] + p[2] * fold->origin[2]);
+
+	*x = (p[0] * fold->u[0] + p[1] * fold->u[1] + p[2] * fold->u[2]) * w;
+	*y = (p[0] * fold->v[0] + p[1] * fold->v[1] + p[2] * fold->v[2]) * w;
+}
+
+//---------------------------------------------------------------------------
+int panel_find(PANEL_INDEX *index, double *d)
+//---------------------------------------------------------------------------
+{
+	// triangle of the mesh holding the direction d (global frame, not zero, any length)
+	double	s[3], p[3], x, y, e, best, *m, *edge;
+	int		g, i, k, n, hit;
+
+	m = index->fold.frame;
+	for (k = 0; k < 3; ++k)
+		s[k] = d[0] * m[k] + d[1] * m[3 + k] + d[2] * m[6 + k];
+	g = index->fold.region[panel_fold(s, p)];
+	panel_point(&index->fold, p, &x, &y);
+	i = (int)((x - index->lo[0]) * index->scale[0]);
+	k = (int)((y - index->lo[1]) * index->scale[1]);
+	i = i < 0 ? 0 : i >= index->grid ? index->grid - 1 : i;
+	k = k < 0 ? 0 : k >= index->grid ? index->grid - 1 : k;
+	n = k * index->grid + i;
+	for (i = index->cell[n], best = -1e300, hit = 0; i < index->cell[n + 1]; ++i)
+	{
+		edge = &index->edge[index->list[i] * 9];
+		e = std::min(std::min(edge[0] * x + edge[1] * y + edge[2], edge[3] * x + edge[4] * y + edge[5]), edge[6] * x + edge[7] * y + edge[8]);
+		hit = e > best ? index->list[i] : hit;
+		best = e > best ? e : best;
+	}
+	return index->image[g * index->nc + hit];
+}
+
+//---------------------------------------------------------------------------
+void panel_find_batch(PANEL_INDEX *index, int n, double *x, double *y, double *z, int *triangle)
+//---------------------------------------------------------------------------
+{
+	// Triangles holding n directions (SoA). Blocks of directions are folded 
+	// and projected first (no branches, the loop vectorizes), then the cells
+	// are scanned.
+	double	px[PANEL_BLOCK], py[PANEL_BLOCK], s[3], p[3], e, best, *m, *edge;
+	int		cell[PANEL_BLOCK], g[PANEL_BLOCK];
+	int		i, j, k, c, n0, hit;
+
+	m = index->fold.frame;
+	for (n0 = 0; n0 < n; n0 += PANEL_BLOCK)
+	{
+		c = n - n0 < PANEL_BLOCK ? n - n0 : PANEL_BLOCK;
+		for (j = 0; j < c; ++j)
+		{
+			for (k = 0; k < 3; ++k)
+				s[k] = x[n0 + j] * m[k] + y[n0 + j] * m[3 + k] + z[n0 + j] * m[6 + k];
+			g[j] = panel_fold(s, p);
+			panel_point(&index->fold, p, &px[j], &py[j]);
+			i = (int)((px[j] - index->lo[0]) * index->scale[0]);
+			k = (int)((py[j] - index->lo[1]) * index->scale[1]);
+			i = i < 0 ? 0 : i >= index->grid ? index->grid - 1 : i;
+			k = k < 0 ? 0 : k >= index->grid ? index->grid - 1 : k;
+			cell[j] = k * index->grid + i;
+		}
+		for (j = 0; j < c; ++j)
+		{
+			for (i = index->cell[cell[j]], best = -1e300, hit = 0; i < index->cell[cell[j] + 1]; ++i)
+			{
+				edge = &index->edge[index->list[i] * 9];
+				e = std::min(std::min(edge[0] * px[j] + edge[1] * py[j] + edge[2], edge[3] * px[j] + edge[4] * py[j] + edge[5]), edge[6] * px[j] + edge[7] * py[j] + edge[8]);
+				hit = e > best ? index->list[i] : hit;
+				best = e > best ? e : best;
+			}
+			triangle[n0 + j] = index->image[index->fold.region[g[j]] * index->nc + hit];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+static double panel_brute(MESH *mesh, double *d, int *triangle)
+//---------------------------------------------------------------------------
+{
+	// Smallest distance of the direction inside the planes of the edges of 
+	// a triangle (d . (a x b) / |a x b|, >= 0 inside). With a triangle given 
+	// the distance for that triangle, otherwise the best over all triangles 
+	// (brute force) into *triangle.
+	double	a[3], b[3], n[3], e, best;
+	int		f, f0, f1, k, *t;
+
+	f0 = *triangle >= 0 ? *triangle : 0;
+	f1 = *triangle >= 0 ? *triangle + 1 : mesh->nf;
+	for (f = f0, best = -1e300; f < f1; ++f)
+	{
+		t = &mesh->index[f * 3];
+		for (k = 0, e = 1e300; k < 3; ++k)
+		{
+			a[0] = mesh->x[t[k]], a[1] = mesh->y[t[k]], a[2] = mesh->z[t[k]];
+			b[0] = mesh->x[t[(k + 1) % 3]], b[1] = mesh->y[t[(k + 1) % 3]], b[2] = mesh->z[t[(k + 1) % 3]];
+			n[0] = a[1] * b[2] - a[2] * b[1];
+			n[1] = a[2] * b[0] - a[0] * b[2];
+			n[2] = a[0] * b[1] - a[1] * b[0];
+			e = std::min(e, (d[0] * n[0] + d[1] * n[1] + d[2] * n[2]) / sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+		}
+		if (e > best)
+		{
+			best = e;
+			if (f1 - f0 > 1)
+				*triangle = f;
+		}
+	}
+	return best;
+}
+
+//---------------------------------------------------------------------------
+int panel_test(PROGRAM *pgm, long count)
+//---------------------------------------------------------------------------
+{
+	// Index every solved variant, query count random directions in one batch 
+	// and check that every answer holds its direction. Reports the cost per 
+	// query against the brute force search. Returns non zero when it failed.
+	PANEL_INDEX			index;
+	CONFIGURATION		*cfg;
+	unsigned long long	state;
+	double				*x, *y, *z, d[3], seed[CONFIGURATION_SEEDS], residual, t, build, query, brute, e;
+	int					*triangle, variant, f, brutes, failed, wrong;
+	long				i;
+
+	x = (double*)malloc(count * 3 * sizeof(double));
+	triangle = (int*)malloc(count * sizeof(int));
+	if (!x || !triangle)
+	{
+		free(x);
+		free(triangle);
+		return 1;
+	}
+	y = x + count, z = y + count;
+	state = 0x9E3779B97F4A7C15ULL;
+	for (i = 0; i < count; ++i)
+	{
+		// uniform on the sphere
+		z[i] = difftest_uniform(&state, -1, 1);
+		t = difftest_uniform(&state, 0, DTR(360.0));
+		x[i] = sqrt(1 - z[i] * z[i]) * cos(t);
+		y[i] = sqrt(1 - z[i] * z[i]) * sin(t);
+	}
+
+	printf("Point in panel index, %ld random directions per variant\n", count);
+	printf("%-8s %8s %10s %10s %10s %12s %12s %8s\n", "config", "variant", "triangles", "candidates", "build ms", "query ns", "brute ns", "wrong");
+	failed = 0;
+	for (cfg = configuration_table; cfg < configuration_table + configuration_count; ++cfg)
+	{
+		for (variant = 0; variant < cfg->variants; ++variant)
+		{
+			if (configuration_solve(pgm, cfg, variant, seed, &residual) < 0)
+			{
+				failed = 1;
+				continue;
+			}
+			t = clock_seconds();
+			if (panel_index_build(pgm, cfg->patch, &index))
+			{
+				printf("(%d,%d) %8d  no index\n", cfg->b, cfg->c, variant);
+				failed = 1;
+				continue;
+			}
+			build = clock_seconds() - t;
+
+			t = clock_seconds();
+			panel_find_batch(&index, (int)count, x, y, z, triangle);
+			query = (clock_seconds() - t) / count;
+
+			// every answer holds its direction (on an edge within rounding)
+			for (i = wrong = 0; i < count; ++i)
+			{
+				d[0] = x[i], d[1] = y[i], d[2] = z[i];
+				f = triangle[i];
+				e = panel_brute(&index.mesh, d, &f);
+				wrong += e < -PANEL_CONTAINS;
+			}
+
+			// brute force on a sample
+			brutes = count < 1000 ? (int)count : 1000;
+			t = clock_seconds();
+			for (i = 0; i < brutes; ++i)
+			{
+				d[0] = x[i], d[1] = y[i], d[2] = z[i];
+				f = -1;
+				panel_brute(&index.mesh, d, &f);
+			}
+			brute = (clock_seconds() - t) / brutes;
+
+			printf("(%d,%d) %10d %10d %10d %10.3f %12.1f %12.1f %8d\n", cfg->b, cfg->c, variant, index.mesh.nf, index.nc, 
+				build * 1e3, query * 1e9, brute * 1e9, wrong);
+			failed |= wrong != 0;
+			panel_index_free(&index);
+		}
+	}
+	free(x);
+	free(triangle);
+	printf(failed ? "FAILED\n" : "PASSED\n");
+	return failed;
+}
+//---------------------------------------------------------------------------
+int near_index_build(PROGRAM *pgm, PATCH *patch, int k, NEAR_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	// Index of the k nearest vertices of the sphere of the solved program 
+	// (see above), k 1 .. NEAR_MAX. Returns 0 or -1.
+	SYMMETRY	*sym;
+	MESH		*mesh;
+	PANEL_FOLD	*fold;
+	double		centre[3], corner[3], *standard, *angle, *nearest;
+	double		d, rho, reach, bound, r, x, y;
+	int			*vperm, *fperm, *candidate, *box, *member, *found;
+	int			g, i, j, c, m, n, b, nv, cx, cy, status;
+
+	memset(index, 0, sizeof(NEAR_INDEX));
+	if (k < 1 || k > NEAR_MAX)
+		return -1;
+	mesh = &index->mesh;
+	if (mesh_expand(pgm, patch, mesh))
+		return -1;
+	sym = index->sym = symmetry_group(pgm);
+	fold = &index->fold;
+	status = panel_fold_build(sym, fold);
+	index->k = k;
+	nv = mesh->nv;
+
+	// about nv / 24 vertices fall into the domain, 16 cells each
+	index->grid = (int)ceil(4 * sqrt(nv / (double)PANEL_CASES));
+	index->grid = index->grid < 4 ? 4 : index->grid;
+	index->lo[0] = fold->lo[0], index->lo[1] = fold->lo[1];
+	index->scale[0] = index->grid / (fold->hi[0] - fold->lo[0]);
+	index->scale[1] = index->grid / (fold->hi[1] - fold->lo[1]);
+
+	// the directions of the vertices in a grid of b^3 boxes over the cube 
+	// [-1, 1]^3, a few vertices in every box on the sphere
+	b = (int)ceil(2 * cbrt((double)nv));
+	b = b < 2 ? 2 : b;
+
+	standard = (double*)malloc(nv * 3 * sizeof(double));
+	angle = (double*)malloc(nv * 2 * sizeof(double));
+	candidate = (int*)malloc(nv * 3 * sizeof(int));
+	box = (int*)calloc(b * b * b + 1, sizeof(int));
+	vperm = (int*)malloc(SYMMETRY_ORDER * nv * sizeof(int));
+	fperm = (int*)malloc(SYMMETRY_ORDER * mesh->nf * sizeof(int));
+	index->cell = (int*)calloc(index->grid * index->grid + 1, sizeof(int));
+	if (!standard || !angle || !candidate || !box || !vperm || !fperm || !index->cell)
+		status = -1;
+	nearest = angle + nv;
+	member = candidate + nv, found = member + nv;
+	for (i = 0; i < nv && !status; ++i)
+	{
+		// the vertices in the standard frame, none a candidate yet
+		for (j = 0; j < 3; ++j)
+			standard[i * 3 + j] = mesh->x[i] * fold->frame[j] + mesh->y[i] * fold->frame[3 + j] + mesh->z[i] * fold->frame[6 + j];
+		candidate[i] = -1;
+		d = 1 / sqrt(standard[i * 3] * standard[i * 3] + standard[i * 3 + 1] * standard[i * 3 + 1] + standard[i * 3 + 2] * standard[i * 3 + 2]);
+		for (j = 0, m = 0; j < 3; ++j)
+			m = m * b + std::max(0, std::min(b - 1, (int)floor((standard[i * 3 + 2 - j] * d + 1) * b / 2)));
+		found[i] = m;
+		++box[m + 1];
+	}
+	for (m = 0; m < b * b * b && !status; ++m)
+		box[m + 1] += box[m];
+	for (i = 0; i < nv && !status; ++i)
+		member[box[found[i]]++] = i;
+	for (m = b * b * b; m > 0 && !status; --m)
+		box[m] = box[m - 1];
+	if (!status)
+		box[0] = 0;
+	for (j = 0; j < 2 && !status; ++j)
+	{
+		// count the vertices of every cell, then list them
+		for (c = 0; c < index->grid * index->grid; ++c)
+		{
+			// cell centre and radius on the sphere (the corners of the cell on the projection plane)
+			cx = c % index->grid, cy = c / index->grid;
+			x = index->lo[0] + (cx + 0.5) / index->scale[0];
+			y = index->lo[1] + (cy + 0.5) / index->scale[1];
+			for (n = 0; n < 3; ++n)
+				centre[n] = fold->origin[n] + x * fold->u[n] + y * fold->v[n];
+			d = 1 / sqrt(centre[0] * centre[0] + centre[1] * centre[1] + centre[2] * centre[2]);
+			for (n = 0; n < 3; ++n)
+				centre[n] *= d;
+			for (i = 0, rho = 1; i < 4; ++i)
+			{
+				x = index->lo[0] + (cx + (i & 1)) / index->scale[0];
+				y = index->lo[1] + (cy + (i >> 1)) / index->scale[1];
+				for (n = 0; n < 3; ++n)
+					corner[n] = fold->origin[n] + x * fold->u[n] + y * fold->v[n];
+				d = sqrt(corner[0] * corner[0] + corner[1] * corner[1] + corner[2] * corner[2]);
+				rho = std::min(rho, (corner[0] * centre[0] + corner[1] * centre[1] + corner[2] * centre[2]) / d);
+			}
+			rho = acos(std::min(1.0, rho));
+
+			// angles of the vertices from the centre, the k-th nearest bounds the 
+			// list: the boxes of a cube around the centre hold every vertex within
+			// bound of it, grown until k of them are
+			for (r = 2.0 / b; ; r *= 2)
+			{
+				m = near_gather(b, box, member, centre, r, found);
+				bound = 2 * asin(std::min(1.0, r / 2)) - NEAR_SLACK;
+				for (i = n = 0; i < m; ++i)
+				{
+					d = (standard[found[i] * 3] * centre[0] + standard[found[i] * 3 + 1] * centre[1] + standard[found[i] * 3 + 2] * centre[2]);
+					d /= sqrt(standard[found[i] * 3] * standard[found[i] * 3] + standard[found[i] * 3 + 1] * standard[found[i] * 3 + 1] + standard[found[i] * 3 + 2] * standard[found[i] * 3 + 2]);
+					nearest[i] = acos(std::max(-1.0, std::min(1.0, d)));
+					n += nearest[i] <= bound;
+				}
+				if (n >= k || r >= 2)
+					break;
+			}
+			std::nth_element(nearest, nearest + k - 1, nearest + m);
+			reach = nearest[k - 1] + 2 * rho + NEAR_SLACK;
+
+			// the vertices within reach, in the boxes of the cube of its chord
+			m = near_gather(b, box, member, centre, reach < DTR(180.0) ? 2 * sin(reach / 2) + NEAR_SLACK : 2, found);
+			for (n = 0; n < m; ++n)
+			{
+				i = found[n];
+				d = (standard[i * 3] * centre[0] + standard[i * 3 + 1] * centre[1] + standard[i * 3 + 2] * centre[2]);
+				d /= sqrt(standard[i * 3] * standard[i * 3] + standard[i * 3 + 1] * standard[i * 3 + 1] + standard[i * 3 + 2] * standard[i * 3 + 2]);
+				angle[i] = acos(std::max(-1.0, std::min(1.0, d)));
+				if (angle[i] > reach)
+					continue;
+				if (!j)
+				{
+					++index->cell[c + 1];
+					continue;
+				}
+				g = index->cell[c]++;
+				if (candidate[i] < 0)
+					candidate[i] = index->nc++;
+				index->list[g] = candidate[i];
+				index->x[g] = standard[i * 3], index->y[g] = standard[i * 3 + 1], index->z[g] = standard[i * 3 + 2];
+				index->w[g] = standard[i * 3] * standard[i * 3] + standard[i * 3 + 1] * standard[i * 3 + 1] + standard[i * 3 + 2] * standard[i * 3 + 2];
+			}
+		}
+		if (j)
+		{
+			// the fill advanced every cell to the next one
+			for (c = index->grid * index->grid; c > 0; --c)
+				index->cell[c] = index->cell[c - 1];
+			index->cell[0] = 0;
+		}
+		else
+		{
+			for (c = 0; c < index->grid * index->grid; ++c)
+			{
+				status |= index->cell[c + 1] > NEAR_LIST ? -1 : 0;
+				index->cell[c + 1] += index->cell[c];
+			}
+			n = index->cell[index->grid * index->grid] + 1;
+			index->list = (int*)malloc(n * sizeof(int));
+			index->x = (double*)malloc(n * 4 * sizeof(double));
+			if (!index->list || !index->x)
+				status = -1;
+			else
+				index->y = index->x + n, index->z = index->y + n, index->w = index->z + n;
+		}
+	}
+
+	// candidates under every transform
+	if (!status)
+		status = mesh_permutation(pgm, mesh, SYMMETRY_ORDER, vperm, fperm);
+	if (!status)
+		index->image = (int*)malloc(SYMMETRY_ORDER * index->nc * sizeof(int));
+	if (!status && !index->image)
+		status = -1;
+	for (g = 0; g < SYMMETRY_ORDER && !status; ++g)
+		for (i = 0; i < nv; ++i)
+			if (candidate[i] >= 0)
+				index->image[g * index->nc + candidate[i]] = vperm[g * nv + i];
+	free(standard);
+	free(angle);
+	free(candidate);
+	free(box);
+	free(vperm);
+	free(fperm);
+	if (status)
+		near_index_free(index);
+	return status;
+}
+
+//---------------------------------------------------------------------------
+static int near_gather(int b, int *box, int *member, double *c, double r, int *found)
+//---------------------------------------------------------------------------
+{
+	// The vertices of the boxes (near_index_build) overlapping the cube of 
+	// half side r around the direction c, by vertex. Returns their number.
+	int		lo[3], hi[3], x, y, z, i, m, n;
+
+	for (i = 0; i < 3; ++i)
+	{
+		lo[i] = std::max(0, std::min(b - 1, (int)floor((c[i] - r + 1) * b / 2)));
+		hi[i] = std::max(0, std::min(b - 1, (int)floor((c[i] + r + 1) * b / 2)));
+	}
+	for (z = lo[2], n = 0; z <= hi[2]; ++z)
+		for (y = lo[1]; y <= hi[1]; ++y)
+			for (x = lo[0]; x <= hi[0]; ++x)
+			{
+				m = (z * b + y) * b + x;
+				for (i = box[m]; i < box[m + 1]; ++i)
+					found[n++] = member[i];
+			}
+	std::sort(found, found + n);
+	return n;
+}
+
+//---------------------------------------------------------------------------
+void near_index_free(NEAR_INDEX *index)
+//---------------------------------------------------------------------------
+{
+	mesh_free(&index->mesh);
+	free(index->cell);
+	free(index->list);
+	free(index->x);
+	free(index->image);
+	memset(index, 0, sizeof(NEAR_INDEX));
+}
+
+//---------------------------------------------------------------------------
+static int near_select(NEAR_INDEX *index, double *p, int n, int g, int k, int *vertex, double *distance)
+//---------------------------------------------------------------------------
+{
+	// The k nearest of the folded point p in the list of cell n, mapped by 
+	// transform g, nearest first. Returns their number (k or fewer).
+	double	key[NEAR_LIST], best[NEAR_MAX], e, dd;
+	int		hit[NEAR_MAX], i, j, c, first;
+
+	// 2 p.v - |v|^2, the largest is the nearest (|p - v|^2 = |p|^2 - key)
+	first = index->cell[n];
+	c = index->cell[n + 1] - first;
+	for (i = 0; i < c; ++i)
+		key[i] = 2 * (p[0] * index->x[first + i] + p[1] * index->y[first + i] + p[2] * index->z[first + i]) - index->w[first + i];
+
+	k = std::min(std::min(k, index->k), c);
+	if (k == 1)
+	{
+		for (i = 1, j = 0; i < c; ++i)
+			j = key[i] > key[j] ? i : j;
+		best[0] = key[j], hit[0] = j;
+	}
+	else
+	{
+		for (i = 0; i < k; ++i)
+			best[i] = -1e300, hit[i] = 0;
+		for (i = 0; i < c; ++i)
+		{
+			if (key[i] <= best[k - 1])
+				continue;
+			for (j = k - 1; j > 0 && best[j - 1] < key[i]; --j)
+				best[j] = best[j - 1], hit[j] = hit[j - 1];
+			best[j] = key[i], hit[j] = i;
+		}
+	}
+	dd = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+	for (i = 0; i < k; ++i)
+	{
+		vertex[i] = index->image[g * index->nc + index->list[first + hit[i]]];
+		if (distance)
+		{
+			e = dd - best[i];
+			distance[i] = e > 0 ? sqrt(e) : 0;
+		}
+	}
+	return k;
+}
+
+//---------------------------------------------------------------------------
+int near_find(NEAR_INDEX *index, double *d, int k, int *vertex, double *distance)
+//---------------------------------------------------------------------------
+{
+	// The k nearest vertices of the point d (global frame) and their distances 
+	// (optional), nearest first. Returns their number, at most the k of the index.
+	double	s[3], p[3], x, y, *m;
+	int		c, i, j;
+
+	m = index->fold.frame;
+	for (j = 0; j < 3; ++j)
+		s[j] = d[0] * m[j] + d[1] * m[3 + j] + d[2] * m[6 + j];
+	c = panel_fold(s, p);
+	panel_point(&index->fold, p, &x, &y);
+	i = (int)((x - index->lo[0]) * index->scale[0]);
+	j = (int)((y - index->lo[1]) * index->scale[1]);
+	i = i < 0 ? 0 : i >= index->grid ? index->grid - 1 : i;
+	j = j < 0 ? 0 : j >= index->grid ? index->grid - 1 : j;
+	return near_select(index, p, j * index->grid + i, index->fold.region[c], k, vertex, distance);
+}
+
+//---------------------------------------------------------------------------
+void near_find_batch(NEAR_INDEX *index, int n, double *x, double *y, double *z, int k, int *vertex)
+//---------------------------------------------------------------------------
+{
+	// The k nearest vertices of n points (SoA) into vertex (n x k, -1 past 
+	// the k of the index). Blocks of points are folded and projected first.
+	double	p[PANEL_BLOCK][3], s[3], px, py, *m;
+	int		cell[PANEL_BLOCK], g[PANEL_BLOCK];
+	int		i, j, c, f, n0;
+
+	m = index->fold.frame;
+	for (n0 = 0; n0 < n; n0 += PANEL_BLOCK)
+	{
+		c = n - n0 < PANEL_BLOCK ? n - n0 : PANEL_BLOCK;
+		for (j = 0; j < c; ++j)
+		{
+			for (i = 0; i < 3; ++i)
+				s[i] = x[n0 + j] * m[i] + y[n0 + j] * m[3 + i] + z[n0 + j] * m[6 + i];
+			g[j] = index->fold.region[panel_fold(s, p[j])];
+			panel_point(&index->fold, p[j], &px, &py);
+			i = (int)((px - index->lo[0]) * index->scale[0]);
+			f = (int)((py - index->lo[1]) * index->scale[1]);
+			i = i < 0 ? 0 : i >= index->grid ? index->grid - 1 : i;
+			f = f < 0 ? 0 : f >= index->grid ? index->grid - 1 : f;
+			cell[j] = f * index->grid + i;
+		}
+		for (j = 0; j < c; ++j)
+			for (i = near_select(index, p[j], cell[j], g[j], k, &vertex[(n0 + j) * k], NULL); i < k; ++i)
+				vertex[(n0 + j) * k + i] = -1;
+	}
+}
+
+//---------------------------------------------------------------------------
+static void near_brute(MESH *mesh, double *d, int k, int *vertex, double *distance)
+//---------------------------------------------------------------------------
+{
+	// the k nearest vertices by distance to every vertex (brute force)
+	double	e;
+	int		i, j;
+
+	for (i = 0; i < k; ++i)
+		distance[i] = 1e300, vertex[i] = -1;
+	for (i = 0; i < mesh->nv; ++i)
+	{
+		e = (d[0] - mesh->x[i]) * (d[0] - mesh->x[i]) + (d[1] - mesh->y[i]) * (d[1] - mesh->y[i]) + (d[2] - mesh->z[i]) * (d[2] - mesh->z[i]);
+		if (e >= distance[k - 1])
+			continue;
+		for (j = k - 1; j > 0 && distance[j - 1] > e; --j)
+			distance[j] = distance[j - 1], vertex[j] = vertex[j - 1];
+		distance[j] = e, vertex[j] = i;
+	}
+	for (i = 0; i < k; ++i)
+		distance[i] = sqrt(distance[i]);
+}
+
+//---------------------------------------------------------------------------
+int near_test(PROGRAM *pgm, long count)
+//---------------------------------------------------------------------------
+{
+	// Index every solved variant for the NEAR_TEST_K nearest vertices, query 
+	// count random points (directions at 0.5 to 1.5 radii) in batches and 
+	// check the answers against the brute force search (same distances, 
+	// ties may swap). Returns non zero when it failed.
+	NEAR_INDEX			index;
+	CONFIGURATION		*cfg;
+	unsigned long long	state;
+	double				*x, *y, *z, d[3], seed[CONFIGURATION_SEEDS], residual, t, r, build, nearest, knn, brute, e;
+	double				found[NEAR_TEST_K], expect[NEAR_TEST_K];
+	int					*vertex, index_vertex[NEAR_TEST_K], brute_vertex[NEAR_TEST_K], variant, j, brutes, failed, wrong;
+	long				i;
+
+	x = (double*)malloc(count * 3 * sizeof(double));
+	vertex = (int*)malloc(count * NEAR_TEST_K * sizeof(int));
+	if (!x || !vertex)
+	{
+		free(x);
+		free(vertex);
+		return 1;
+	}
+	y = x + count, z = y + count;
+	state = 0x9E3779B97F4A7C15ULL;
+	for (i = 0; i < count; ++i)
+	{
+		// uniform in direction, radius 0.5 .. 1.5
+		z[i] = difftest_uniform(&state, -1, 1);
+		t = difftest_uniform(&state, 0, DTR(360.0));
+		r = difftest_uniform(&state, 0.5, 1.5) * pgm->radius;
+		x[i] = sqrt(1 - z[i] * z[i]) * cos(t) * r;
+		y[i] = sqrt(1 - z[i] * z[i]) * sin(t) * r;
+		z[i] *= r;
+	}
+
+	printf("Nearest vertex index, %ld random points per variant, %d nearest\n", count, NEAR_TEST_K);
+	printf("%-8s %8s %10s %10s %10s %12s %12s %12s %8s\n", "config", "variant", "vertices", "list", "build ms", "nearest ns", "knn ns", "brute ns", "wrong");
+	failed = 0;
+	for (cfg = configuration_table; cfg < configuration_table + configuration_count; ++cfg)
+	{
+		for (variant = 0; variant < cfg->variants; ++variant)
+		{
+			if (configuration_solve(pgm, cfg, variant, seed, &residual) < 0)
+			{
+				failed = 1;
+				continue;
+			}
+			t = clock_seconds();
+			if (near_index_build(pgm, cfg->patch, NEAR_TEST_K, &index))
+			{
+				printf("(%d,%d) %8d  no index\n", cfg->b, cfg->c, variant);
+				failed = 1;
+				continue;
+			}
+			build = clock_seconds() - t;
+
+			t = clock_seconds();
+			near_find_batch(&index, (int)count, x, y, z, 1, vertex);
+			nearest = (clock_seconds() - t) / count;
+			t = clock_seconds();
+			near_find_batch(&index, (int)count, x, y, z, NEAR_TEST_K, vertex);
+			knn = (clock_seconds() - t) / count;
+
+			// the distances of the answers are the brute force distances
+			for (i = wrong = 0; i < count; ++i)
+			{
+				d[0] = x[i], d[1] = y[i], d[2] = z[i];
+				near_brute(&index.mesh, d, NEAR_TEST_K, brute_vertex, expect);
+				for (j = 0, e = 0; j < NEAR_TEST_K; ++j)
+				{
+					index_vertex[j] = vertex[i * NEAR_TEST_K + j];
+					if (index_vertex[j] < 0)
+					{
+						e = 1;
+						break;
+					}
+					found[j] = sqrt((d[0] - index.mesh.x[index_vertex[j]]) * (d[0] - index.mesh.x[index_vertex[j]]) +
+						(d[1] - index.mesh.y[index_vertex[j]]) * (d[1] - index.mesh.y[index_vertex[j]]) + (d[2] - index.mesh.z[index_vertex[j]]) * (d[2] - index.mesh.z[index_vertex[j]]));
+					e = std::max(e, fabs(found[j] - expect[j]));
+				}
+				wrong += e > 1e-12 * pgm->radius;
+			}
+
+			// brute force nearest on a sample
+			brutes = count < 1000 ? (int)count : 1000;
+			t = clock_seconds();
+			for (i = 0; i < brutes; ++i)
+			{
+				d[0] = x[i], d[1] = y[i], d[2] = z[i];
+				near_brute(&index.mesh, d, 1, brute_vertex, expect);
+			}
+			brute = (clock_seconds() - t) / brutes;
+
+			printf("(%d,%d) %10d %10d %10.1f %10.3f %12.1f %12.1f %12.1f %8d\n", cfg->b, cfg->c, variant, index.mesh.nv, 
+				index.cell[index.grid * index.grid] / (double)(index.grid * index.grid), build * 1e3, nearest * 1e9, knn * 1e9, brute * 1e9, wrong);
+			failed |= wrong != 0;
+			near_index_free(&index);
+		}
+	}
+	free(x);
+	free(vertex);
+	printf(failed ? "FAILED\n" : "PASSED\n");
+	return failed;
+}
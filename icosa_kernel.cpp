@@ -0,0 +1,168 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Instruction set variants of the batch kernels.
+
+	generic is the scalar loop of icosa_truncations.cpp built with the flags
+	of the build. avx2 and avx512 evaluate 4 and 8 elements at a time with the
+	vector math functions of glibc (libmvec) and are compiled from the same
+	body (icosa_kernel.h) inside a target region each, so the build needs no
+	per file flags. The processor is asked once, when the program or library
+	is loaded, and the best variant it supports is used (kernel_isa). -isa
+	forces a variant for benchmarks and the differential test.
+
+*/
+// icosa_kernel.cpp : Defines the instruction set variants of the batch kernels (library).
+//
+#include "icosa_truncations.h"
+
+#if KERNEL_ISA_VARIANTS
+#include <immintrin.h>
+
+typedef long long	KERNEL_V4L __attribute__((vector_size(32)));
+typedef long long	KERNEL_V8L __attribute__((vector_size(64)));
+
+// avx2: 4 doubles, libmvec _ZGVdN4 functions
+#pragma GCC push_options
+#pragma GCC target("avx2")
+extern "C" {
+__m256d _ZGVdN4v_sin(__m256d x);
+__m256d _ZGVdN4v_cos(__m256d x);
+__m256d _ZGVdN4v_tan(__m256d x);
+__m256d _ZGVdN4v_asin(__m256d x);
+__m256d _ZGVdN4v_acos(__m256d x);
+__m256d _ZGVdN4v_atan(__m256d x);
+__m256d _ZGVdN4vv_atan2(__m256d y, __m256d x);
+}
+#define KERNEL_W			4
+#define KERNEL_VD			__m256d
+#define KERNEL_VM			KERNEL_V4L
+#define KERNEL_NAME(f)		f##_avx2
+#define KERNEL_SIN			_ZGVdN4v_sin
+#define KERNEL_COS			_ZGVdN4v_cos
+#define KERNEL_TAN			_ZGVdN4v_tan
+#define KERNEL_ASIN			_ZGVdN4v_asin
+#define KERNEL_ACOS			_ZGVdN4v_acos
+#define KERNEL_ATAN			_ZGVdN4v_atan
+#define KERNEL_ATAN2		_ZGVdN4vv_atan2
+#define KERNEL_SQRT			_mm256_sqrt_pd
+#include "icosa_kernel.h"
+#undef KERNEL_W
+#undef KERNEL_VD
+#undef KERNEL_VM
+#undef KERNEL_NAME
+#undef KERNEL_SIN
+#undef KERNEL_COS
+#undef KERNEL_TAN
+#undef KERNEL_ASIN
+#undef KERNEL_ACOS
+#undef KERNEL_ATAN
+#undef KERNEL_ATAN2
+#undef KERNEL_SQRT
+#pragma GCC pop_options
+
+// avx512: 8 doubles, libmvec _ZGVeN8 functions
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+extern "C" {
+__m512d _ZGVeN8v_sin(__m512d x);
+__m512d _ZGVeN8v_cos(__m512d x);
+__m512d _ZGVeN8v_tan(__m512d x);
+__m512d _ZGVeN8v_asin(__m512d x);
+__m512d _ZGVeN8v_acos(__m512d x);
+__m512d _ZGVeN8v_atan(__m512d x);
+__m512d _ZGVeN8vv_atan2(__m512d y, __m512d x);
+}
+#define KERNEL_W			8
+#define KERNEL_VD			__m512d
+#define KERNEL_VM			KERNEL_V8L
+#define KERNEL_NAME(f)		f##_avx512
+#define KERNEL_SIN			_ZGVeN8v_sin
+#define KERNEL_COS			_ZGVeN8v_cos
+#define KERNEL_TAN			_ZGVeN8v_tan
+#define KERNEL_ASIN			_ZGVeN8v_asin
+#define KERNEL_ACOS			_ZGVeN8v_acos
+#define KERNEL_ATAN			_ZGVeN8v_atan
+#define KERNEL_ATAN2		_ZGVeN8vv_atan2
+#define KERNEL_SQRT(x)		_mm512_maskz_sqrt_pd(0xFF, x)
+#include "icosa_kernel.h"
+#pragma GCC pop_options
+
+//---------------------------------------------------------------------------
+int kernel_isa_avx2(void)
+//---------------------------------------------------------------------------
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+//---------------------------------------------------------------------------
+int kernel_isa_avx512(void)
+//---------------------------------------------------------------------------
+{
+	return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+//---------------------------------------------------------------------------
+int kernel_isa_generic(void)
+//---------------------------------------------------------------------------
+{
+	return 1;
+}
+
+// instruction set variants of the batch kernels, in increasing order of preference
+// (libm is within 1 ulp, the documented bound of libmvec is 4 ulp)
+KERNEL_ISA kernel_isa_table[] = {
+	{ "generic", kernel_isa_generic, 1, sph_tri_bcC_generic, gut_spherical_to_cartesian_generic, gut_cartesian_to_spherical_generic },
+#if KERNEL_ISA_VARIANTS
+	{ "avx2", kernel_isa_avx2, 4, sph_tri_bcC_avx2, gut_spherical_to_cartesian_avx2, gut_cartesian_to_spherical_avx2 },
+	{ "avx512", kernel_isa_avx512, 4, sph_tri_bcC_avx512, gut_spherical_to_cartesian_avx512, gut_cartesian_to_spherical_avx512 },
+#endif
+};
+
+// variant of the batch kernels, the best one of the processor from the start
+int kernel_isa = kernel_isa_best();
+
+//---------------------------------------------------------------------------
+int kernel_isa_best(void)
+//---------------------------------------------------------------------------
+{
+	// index of the most capable variant the processor supports
+	int		i;
+
+#if KERNEL_ISA_VARIANTS
+	__builtin_cpu_init(); // called from a static initializer, before the one of libgcc
+#endif
+	for (i = (int)(sizeof(kernel_isa_table) / sizeof(KERNEL_ISA)) - 1; i > 0; --i)
+	{
+		if (kernel_isa_table[i].supported())
+			return i;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+int kernel_isa_select(char *name)
+//---------------------------------------------------------------------------
+{
+	// Force the named variant of the batch kernels (null: the best supported one).
+	// Returns its index or -1 when it is unknown or the processor lacks it.
+	int		i;
+
+	if (!name)
+		return kernel_isa = kernel_isa_best();
+	for (i = 0; i < (int)(sizeof(kernel_isa_table) / sizeof(KERNEL_ISA)); ++i)
+	{
+		if (!strcmp(kernel_isa_table[i].name, name))
+			return kernel_isa_table[i].supported() ? (kernel_isa = i) : -1;
+	}
+	return -1;
+}
@@ -0,0 +1,166 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Vector bodies of the batch kernels, not a public header.
+
+	icosa_kernel.cpp includes this file once per instruction set, inside the
+	target region of that instruction set, after defining:
+		KERNEL_W			doubles per vector
+		KERNEL_VD			vector of KERNEL_W doubles (GCC vector extension)
+		KERNEL_VM			comparison result of two KERNEL_VD (lanes 0 or -1)
+		KERNEL_NAME(f)		name of function f for the instruction set
+		KERNEL_SIN ... 		vector math functions (libmvec) and square root
+	The equations and the order of the operations are those of the generic
+	bodies in icosa_truncations.cpp, only the math functions differ.
+
+*/
+
+//---------------------------------------------------------------------------
+static inline KERNEL_VD KERNEL_NAME(kernel_load)(int k, double *p)
+//---------------------------------------------------------------------------
+{
+	// 'k' elements into a vector, the remaining lanes repeat the last one
+	// so a partial vector computes nothing a full one would not
+	KERNEL_VD	v;
+	double		t[KERNEL_W];
+	int			j;
+
+	if (k == KERNEL_W)
+	{
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	for (j = 0; j < KERNEL_W; ++j)
+		t[j] = p[j < k ? j : k - 1];
+	memcpy(&v, t, sizeof(v));
+	return v;
+}
+
+//---------------------------------------------------------------------------
+static inline void KERNEL_NAME(kernel_store)(int k, KERNEL_VD v, double *p)
+//---------------------------------------------------------------------------
+{
+	// the first 'k' lanes of a vector
+	if (k == KERNEL_W)
+		memcpy(p, &v, sizeof(v));
+	else
+		memcpy(p, &v, k * sizeof(double));
+}
+
+//---------------------------------------------------------------------------
+static inline int KERNEL_NAME(kernel_any)(KERNEL_VM m)
+//---------------------------------------------------------------------------
+{
+	// any lane set
+	int		j;
+
+	for (j = 0; j < KERNEL_W; ++j)
+	{
+		if (m[j])
+			return 1;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+void KERNEL_NAME(sph_tri_bcC)(int n, double *b, double *c, double *C, double *a, double *A, double *B)
+//---------------------------------------------------------------------------
+{
+	// Same solution as sph_tri_bcC_body, KERNEL_W triangles at a time. Every
+	// lane takes the regular case, the complex case and its second solution
+	// are only evaluated for the vectors that have a lane needing them.
+	KERNEL_VD	bi, ci, Ci, sb, sc, x, k, ai, Ai, Bi, ac, Ac, Bc, A2, B2;
+	KERNEL_VM	complex, second;
+	int			i, m;
+
+	for (i = 0; i < n; i += KERNEL_W)
+	{
+		m = n - i < KERNEL_W ? n - i : KERNEL_W;
+		bi = KERNEL_NAME(kernel_load)(m, b + i);
+		ci = KERNEL_NAME(kernel_load)(m, c + i);
+		Ci = KERNEL_NAME(kernel_load)(m, C + i);
+		sb = KERNEL_SIN(bi);
+		sc = KERNEL_SIN(ci);
+		x = sb * KERNEL_SIN(Ci) / sc;
+
+		// regular case, Napier's Analogies
+		Bi = KERNEL_ASIN(x > 1.0 ? 1.0 : (x < -1.0 ? -1.0 : x));
+		ai = 2.0 * KERNEL_ATAN(KERNEL_TAN((bi + ci) / 2.0) * KERNEL_COS((Bi + Ci) / 2.0) / KERNEL_COS((Bi - Ci) / 2.0));
+		Ai = KERNEL_ACOS((KERNEL_COS(ai) - KERNEL_COS(bi) * KERNEL_COS(ci)) / (sb * sc));
+
+		complex = (bi > ci) & (Ci < DTR(90.0));
+		if (KERNEL_NAME(kernel_any)(complex))
+		{
+			k = KERNEL_SIN((ci + bi) / 2.0) / KERNEL_SIN((ci - bi) / 2.0);
+			Bc = KERNEL_ASIN(x);
+			Ac = KERNEL_ATAN(1 / (KERNEL_TAN((Ci - Bc) / 2.0) * k)) * 2.0;
+			second = complex & (Ac < 0);
+			if (KERNEL_NAME(kernel_any)(second))
+			{
+				B2 = DTR(180.0) - Bc;
+				A2 = KERNEL_ATAN(1 / (KERNEL_TAN((Ci - B2) / 2.0) * k)) * 2.0;
+				Bc = second ? B2 : Bc;
+				Ac = second ? A2 : Ac;
+			}
+			ac = KERNEL_ASIN(KERNEL_SIN(Ac) * sb / KERNEL_SIN(Bc));
+			ai = complex ? ac : ai;
+			Ai = complex ? Ac : Ai;
+			Bi = complex ? Bc : Bi;
+		}
+		KERNEL_NAME(kernel_store)(m, ai, a + i);
+		KERNEL_NAME(kernel_store)(m, Ai, A + i);
+		KERNEL_NAME(kernel_store)(m, Bi, B + i);
+	}
+}
+
+//---------------------------------------------------------------------------
+void KERNEL_NAME(gut_spherical_to_cartesian)(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z)
+//---------------------------------------------------------------------------
+{
+	// same conversion as gut_spherical_to_cartesian_body, KERNEL_W coordinates at a time
+	KERNEL_VD	r, s, az, in;
+	int			i, m;
+
+	for (i = 0; i < n; i += KERNEL_W)
+	{
+		m = n - i < KERNEL_W ? n - i : KERNEL_W;
+		r = KERNEL_NAME(kernel_load)(m, radius + i);
+		az = KERNEL_NAME(kernel_load)(m, azimuth + i);
+		in = KERNEL_NAME(kernel_load)(m, inclination + i);
+		s = r * KERNEL_SIN(in);
+		KERNEL_NAME(kernel_store)(m, s * KERNEL_COS(az), x + i);
+		KERNEL_NAME(kernel_store)(m, s * KERNEL_SIN(az), y + i);
+		KERNEL_NAME(kernel_store)(m, r * KERNEL_COS(in), z + i);
+	}
+}
+
+//---------------------------------------------------------------------------
+void KERNEL_NAME(gut_cartesian_to_spherical)(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination)
+//---------------------------------------------------------------------------
+{
+	// same conversion as gut_cartesian_to_spherical_body, KERNEL_W points at a time
+	KERNEL_VD	r, xi, yi, zi, in;
+	int			i, m;
+
+	for (i = 0; i < n; i += KERNEL_W)
+	{
+		m = n - i < KERNEL_W ? n - i : KERNEL_W;
+		xi = KERNEL_NAME(kernel_load)(m, x + i);
+		yi = KERNEL_NAME(kernel_load)(m, y + i);
+		zi = KERNEL_NAME(kernel_load)(m, z + i);
+		r = KERNEL_SQRT(xi * xi + yi * yi + zi * zi);
+		in = KERNEL_ACOS(zi / r);
+		in = r > 0.0 ? in : 0.0;
+		KERNEL_NAME(kernel_store)(m, KERNEL_ATAN2(yi, xi), azimuth + i);
+		KERNEL_NAME(kernel_store)(m, in, inclination + i);
+		KERNEL_NAME(kernel_store)(m, r, radius + i);
+	}
+}
@@ -0,0 +1,397 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Structured logging.
+
+	The solver reports (configuration banners, geometry and sensitivity 
+	output, certification, iteration notes) are log records instead of 
+	console output. A thread formats its records into its own ring buffer
+	(single producer and single consumer, no lock) and numbers them from one
+	counter. The flushing thread collects the buffers every LOG_INTERVAL 
+	milliseconds (sooner when a buffer fills) and writes the records in 
+	number order, so records of different threads never interleave and the
+	console order is the order in which they were written.
+
+	Below the level nothing is formatted or written, a disabled record costs
+	one relaxed load. The level is LOG_OFF until log_open: the library, the
+	C interface, the batch and the service are silent unless a level is set 
+	(-log), the console solutions log at LOG_INFO in the text format.
+
+	Formats
+		LOG_FORMAT_TEXT		the message only (as the console output)
+		LOG_FORMAT_FIELDS	time=<s> level=<name> thread=<n> event=<name> msg="<message>"
+
+*/
+// icosa_log.cpp : Defines the asynchronous structured logger (library).
+//
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdarg.h>
+#include "icosa_truncations.h"
+
+typedef struct {
+	unsigned long long	seq;		// write order over all the threads
+	double				time;		// seconds since log_open
+	int					level;
+	int					thread;
+	char				*event;
+	char				message[LOG_MESSAGE];
+} LOG_RECORD;
+
+// records of one thread, written by the thread and read by the flushing thread
+typedef struct LOG_BUFFER {
+	LOG_RECORD			record[LOG_RING];
+	std::atomic<unsigned>	head;		// next record written
+	std::atomic<unsigned>	tail;		// next record read
+	std::atomic<int>	retired;	// the thread exited
+	int					thread;		// number of the thread in the log
+	struct LOG_BUFFER	*next;
+} LOG_BUFFER;
+
+typedef struct {
+	std::atomic<unsigned long long>	seq;		// next record number
+	std::atomic<int>		generation;	// log_open count, buffers of older logs are stale
+	std::mutex				lock;		// buffer list, pending records and output
+	std::condition_variable	wake;		// flush now
+	std::condition_variable	flushed;	// records were written
+	std::thread				flusher;
+	int						running, stop;
+	FILE					*fp;
+	int						format;
+	double					start;
+	int						threads;
+	LOG_BUFFER				*buffers;
+	unsigned long long		written;	// records written (number of the next one)
+	LOG_RECORD				*pending;	// records read waiting for an earlier one
+	int						count, size;
+	long					unordered;	// records written after later ones (no memory for more pending ones)
+} LOGGER;
+
+// buffer of the calling thread, retired when the thread exits
+typedef struct LOG_THREAD {
+	LOG_BUFFER	*buffer;
+	int			generation;
+	~LOG_THREAD();
+} LOG_THREAD;
+
+static char *log_level_name[] = { "error", "note", "info", "debug" };
+
+std::atomic<int>			log_level(LOG_OFF);
+static LOGGER				logger;
+static thread_local LOG_THREAD	log_thread;
+
+static LOG_BUFFER *log_buffer(void);
+static void log_flusher(void);
+static void log_drain(void);
+static void log_spill(void);
+static void log_emit(LOG_RECORD *record);
+static void log_output(LOG_RECORD *record);
+static int log_compare(const void *a, const void *b);
+
+//---------------------------------------------------------------------------
+LOG_THREAD::~LOG_THREAD()
+//---------------------------------------------------------------------------
+{
+	// the flushing thread frees the buffer once it is read
+	if (!buffer)
+		return;
+	std::lock_guard<std::mutex>	lock(logger.lock);
+	if (buffer && generation == logger.generation)
+		buffer->retired = 1;
+}
+
+//---------------------------------------------------------------------------
+int log_level_parse(char *name)
+//---------------------------------------------------------------------------
+{
+	// level of a name (off, error, note, info, debug) or -2
+	int		i;
+
+	if (!strcmp(name, "off"))
+		return LOG_OFF;
+	for (i = 0; i <= LOG_DEBUG; ++i)
+	{
+		if (!strcmp(name, log_level_name[i]))
+			return i;
+	}
+	return -2;
+}
+
+//---------------------------------------------------------------------------
+void log_open(int level, int format, FILE *fp)
+//---------------------------------------------------------------------------
+{
+	// Start logging the records up to the level to the file (LOG_OFF stays 
+	// silent). Reopening closes the previous log.
+	log_close();
+	if (level < 0)
+		return;
+	logger.fp = fp;
+	logger.format = format;
+	logger.start = clock_seconds();
+	logger.threads = 0;
+	logger.written = logger.seq = 0;
+	logger.unordered = 0;
+	logger.stop = 0;
+	logger.running = 1;
+	logger.flusher = std::thread(log_flusher);
+	log_level = level;
+}
+
+//---------------------------------------------------------------------------
+void log_close(void)
+//---------------------------------------------------------------------------
+{
+	// Write the remaining records and stop logging. The threads writing 
+	// records must be done.
+	LOG_BUFFER	*b;
+	LOG_RECORD	r;
+
+	if (!logger.running)
+		return;
+	log_level = LOG_OFF;
+	{
+		std::lock_guard<std::mutex>	lock(logger.lock);
+		logger.stop = 1;
+		logger.wake.notify_one();
+	}
+	logger.flusher.join();
+
+	std::lock_guard<std::mutex>	lock(logger.lock);
+	if (logger.unordered)
+	{
+		memset(&r, 0, sizeof(LOG_RECORD));
+		r.time = clock_seconds() - logger.start;
+		r.level = LOG_ERROR;
+		r.thread = -1;
+		r.event = "log";
+		sprintf_s(r.message, LOG_MESSAGE, "%ld records written out of order (out of memory)", logger.unordered);
+		log_output(&r);
+		fflush(logger.fp);
+	}
+	++logger.generation; // the buffers of the living threads are stale
+	while (logger.buffers)
+	{
+		b = logger.buffers;
+		logger.buffers = b->next;
+		delete b;
+	}
+	free(logger.pending);
+	logger.pending = 0;
+	logger.count = logger.size = 0;
+	logger.running = 0;
+}
+
+//---------------------------------------------------------------------------
+void log_flush(void)
+//---------------------------------------------------------------------------
+{
+	// wait until the records written so far are out
+	unsigned long long	target;
+
+	std::unique_lock<std::mutex>	lock(logger.lock);
+	target = logger.seq;
+	while (logger.running && !logger.stop && logger.written < target)
+	{
+		logger.wake.notify_one();
+		logger.flushed.wait_for(lock, std::chrono::milliseconds(LOG_INTERVAL));
+	}
+}
+
+//---------------------------------------------------------------------------
+void log_write(int level, char *event, char *format, ...)
+//---------------------------------------------------------------------------
+{
+	// Format a record into the buffer of the thread (use LOG, which skips 
+	// disabled levels). Waits for the flushing thread when the buffer is full.
+	LOG_BUFFER	*b;
+	LOG_RECORD	*r;
+	unsigned	head;
+	va_list		args;
+
+	b = log_buffer();
+	if (!b)
+		return;
+	head = b->head.load(std::memory_order_relaxed);
+	while (head - b->tail.load(std::memory_order_acquire) >= LOG_RING)
+	{
+		logger.wake.notify_one();
+		std::this_thread::yield();
+	}
+	r = &b->record[head % LOG_RING];
+	va_start(args, format);
+	vsnprintf(r->message, LOG_MESSAGE, format, args);
+	va_end(args);
+	r->level = level;
+	r->thread = b->thread;
+	r->event = event;
+	r->time = clock_seconds() - logger.start;
+	r->seq = logger.seq.fetch_add(1);
+	b->head.store(head + 1, std::memory_order_release);
+	if (head + 1 - b->tail.load(std::memory_order_relaxed) >= LOG_RING / 2)
+		logger.wake.notify_one();
+}
+
+//---------------------------------------------------------------------------
+static LOG_BUFFER *log_buffer(void)
+//---------------------------------------------------------------------------
+{
+	// buffer of the calling thread, created on its first record
+	LOG_BUFFER	*b;
+
+	if (log_thread.buffer && log_thread.generation == logger.generation)
+		return log_thread.buffer;
+
+	std::lock_guard<std::mutex>	lock(logger.lock);
+	if (!logger.running)
+		return 0;
+	b = new LOG_BUFFER();
+	b->thread = logger.threads++;
+	b->next = logger.buffers;
+	logger.buffers = b;
+	log_thread.buffer = b;
+	log_thread.generation = logger.generation;
+	return b;
+}
+
+//---------------------------------------------------------------------------
+static void log_flusher(void)
+//---------------------------------------------------------------------------
+{
+	// write the buffered records until the log is closed, then the rest
+	std::unique_lock<std::mutex>	lock(logger.lock);
+	while (!logger.stop)
+	{
+		logger.wake.wait_for(lock, std::chrono::milliseconds(LOG_INTERVAL));
+		log_drain();
+	}
+	log_drain();
+	while (logger.written < logger.seq)
+	{
+		// a record numbered but not yet stored by its thread
+		lock.unlock();
+		std::this_thread::yield();
+		lock.lock();
+		log_drain();
+	}
+}
+
+//---------------------------------------------------------------------------
+static void log_drain(void)
+//---------------------------------------------------------------------------
+{
+	// Read every buffer (logger locked) and write the records that follow 
+	// the written ones without a gap, a gap is a record being stored. When 
+	// the pending records cannot grow they are written across their gaps.
+	LOG_BUFFER	*b, **pb;
+	LOG_RECORD	*grown;
+	unsigned	head, tail;
+	int			retired, i, k, size;
+
+	for (pb = &logger.buffers; (b = *pb); )
+	{
+		retired = b->retired;
+		head = b->head.load(std::memory_order_acquire);
+		for (tail = b->tail.load(std::memory_order_relaxed); tail != head; ++tail)
+		{
+			if (logger.count == logger.size)
+			{
+				size = logger.size ? logger.size * 2 : LOG_RING;
+				grown = (LOG_RECORD*)realloc(logger.pending, size * sizeof(LOG_RECORD));
+				if (grown)
+				{
+					logger.pending = grown;
+					logger.size = size;
+				}
+				else
+					log_spill(); // keeps the pending records buffer, empty
+			}
+			if (logger.count < logger.size)
+				logger.pending[logger.count++] = b->record[tail % LOG_RING];
+			else
+				log_emit(&b->record[tail % LOG_RING]); // no pending records buffer at all
+		}
+		b->tail.store(tail, std::memory_order_release);
+		if (retired)
+		{
+			*pb = b->next;
+			delete b;
+		}
+		else
+			pb = &b->next;
+	}
+
+	qsort(logger.pending, logger.count, sizeof(LOG_RECORD), log_compare);
+	for (i = 0; i < logger.count && logger.pending[i].seq <= logger.written; ++i)
+		log_emit(&logger.pending[i]);
+	for (k = 0; i < logger.count; ++i, ++k)
+		logger.pending[k] = logger.pending[i];
+	logger.count = k;
+	fflush(logger.fp);
+	logger.flushed.notify_all();
+}
+
+//---------------------------------------------------------------------------
+static void log_spill(void)
+//---------------------------------------------------------------------------
+{
+	// The pending records cannot grow: write them now in number order across
+	// their gaps (logger locked). The records of the gaps are written when 
+	// they are read, out of order.
+	int		i;
+
+	qsort(logger.pending, logger.count, sizeof(LOG_RECORD), log_compare);
+	for (i = 0; i < logger.count; ++i)
+		log_emit(&logger.pending[i]);
+	logger.count = 0;
+}
+
+//---------------------------------------------------------------------------
+static void log_emit(LOG_RECORD *record)
+//---------------------------------------------------------------------------
+{
+	// write a record and advance the written ones past it, or count it when
+	// later ones were written before it (log_spill)
+	log_output(record);
+	if (record->seq < logger.written)
+		++logger.unordered;
+	else
+		logger.written = record->seq + 1;
+}
+
+//---------------------------------------------------------------------------
+static void log_output(LOG_RECORD *record)
+//---------------------------------------------------------------------------
+{
+	char	*m;
+
+	if (logger.format == LOG_FORMAT_TEXT)
+	{
+		fputs(record->message, logger.fp);
+		fputc('\n', logger.fp);
+		return;
+	}
+	for (m = record->message; *m == ' ' || *m == '\t'; ++m)
+		;
+	fprintf(logger.fp, "time=%.6f level=%s thread=%d event=%s msg=\"%s\"\n", 
+		record->time, log_level_name[record->level], record->thread, record->event, m);
+}
+
+//---------------------------------------------------------------------------
+static int log_compare(const void *a, const void *b)
+//---------------------------------------------------------------------------
+{
+	unsigned long long	x = ((LOG_RECORD*)a)->seq, y = ((LOG_RECORD*)b)->seq;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+// icosa_main.cpp : Defines the entry point for the console application.
+//
+#include "icosa_truncations.h"
+
+//---------------------------------------------------------------------------
+int main(int ac, char **av)
+//---------------------------------------------------------------------------
+{
+	// create the program structure
+	PROGRAM	pgm;
+	int		i;
+	long	difftest, panels, nearest;
+	double	difftol;
+	char	*isa;
+	// batch manifest
+	MANIFEST	manifest;
+	char		*batch, *results;
+	int			shard, shards, merge, resume, failed;
+	// service
+	char		*serve, *request;
+	int			cache, servetest, workers, schedtest;
+	// constraint sets
+	char		*constraints;
+	int			constrainttest;
+	// comparison of two solutions
+	char		*compare[2], comparefile[2][BATCH_PATH];
+	double		comparemax;
+	// logging
+	int			loglevel, logformat;
+
+	// define the global program structure (defaults, transforms and reference triangle)
+	program_init(&pgm);
+	difftest = 0;
+	panels = 0;
+	nearest = 0;
+	constraints = 0;
+	constrainttest = 0;
+	compare[0] = compare[1] = 0;
+	comparemax = DIFF_MAX;
+	difftol = DIFFTEST_TOLERANCE;
+	isa = 0;
+	batch = 0;
+	results = "results";
+	shard = -1;
+	shards = 1;
+	merge = 0;
+	resume = 0;
+	serve = request = 0;
+	cache = SERVICE_CACHE;
+	servetest = 0;
+	workers = 0;
+	schedtest = 0;
+	loglevel = -2; // default of the mode
+	logformat = LOG_FORMAT_TEXT;
+
+	// command line options
+	for (i = 1; i < ac; ++i)
+	{
+		if (!strcmp(av[i], "-certify"))
+			pgm.certify = 1; // certify solved seeds with interval arithmetic
+		else if (!strcmp(av[i], "-serial"))
+			pgm.parallel = 0; // solve the variants of a configuration one after the other
+		else if (!strcmp(av[i], "-sensitivity"))
+			pgm.sensitivity = 1; // write vertex derivatives with respect to the solved seeds
+		else if (!strcmp(av[i], "-radius") && i + 1 < ac)
+			pgm.radius = atof(av[++i]); // output sphere radius
+		else if (!strcmp(av[i], "-precision") && i + 1 < ac)
+		{
+			// stop once the coordinates are settled at the number of decimals
+			pgm.stop.mode = BUILD_STOP_PRECISION;
+			pgm.stop.resolution = 0.5 * pow(10.0, -atof(av[++i]));
+		}
+		else if (!strcmp(av[i], "-tolerance") && i + 1 < ac)
+		{
+			// stop once the coordinates are settled within a physical tolerance at the radius
+			pgm.stop.mode = BUILD_STOP_PRECISION;
+			pgm.stop.resolution = atof(av[++i]);
+		}
+		else if (!strcmp(av[i], "-kernel") && i + 1 < ac)
+		{
+			// kernel implementation used by the vertex construction
+			pgm.kernel = kernel_find(av[++i]);
+			if (pgm.kernel < 0)
+			{
+				printf("unknown kernel: %s\n", av[i]);
+				return 1;
+			}
+		}
+		else if (!strcmp(av[i], "-difftest"))
+		{
+			// differential test of the fast kernels instead of the solutions
+			difftest = DIFFTEST_SAMPLES;
+			if (i + 1 < ac && av[i + 1][0] >= '0' && av[i + 1][0] <= '9')
+				difftest = atol(av[++i]);
+		}
+		else if (!strcmp(av[i], "-difftol") && i + 1 < ac)
+			difftol = atof(av[++i]); // absolute error gate of the differential test
+		else if (!strcmp(av[i], "-isa") && i + 1 < ac)
+			isa = av[++i]; // force the instruction set variant of the batch kernels
+		else if (!strcmp(av[i], "-batch") && i + 1 < ac)
+			batch = av[++i]; // solve the jobs of a manifest instead of the solutions
+		else if (!strcmp(av[i], "-results") && i + 1 < ac)
+			results = av[++i]; // shared result directory of the batch
+		else if (!strcmp(av[i], "-shards") && i + 1 < ac)
+			shards = atoi(av[++i]); // claim and solve any unclaimed shard of the split
+		else if (!strcmp(av[i], "-shard") && i + 1 < ac)
+		{
+			// solve the given shard i/N
+			if (sscanf(av[++i], "%d/%d", &shard, &shards) != 2 || shard < 0 || shard >= shards)
+			{
+				printf("shard must be i/N with 0 <= i < N: %s\n", av[i]);
+				return 1;
+			}
+		}
+		else if (!strcmp(av[i], "-merge"))
+			merge = 1; // merge the batch results
+		else if (!strcmp(av[i], "-resume"))
+			resume = 1; // skip the jobs the shard journals completed
+		else if (!strcmp(av[i], "-serve"))
+		{
+			// serve solve requests on [host:]port
+			serve = SERVICE_ADDRESS;
+			if (i + 1 < ac && av[i + 1][0] != '-')
+				serve = av[++i];
+		}
+		else if (!strcmp(av[i], "-cache") && i + 1 < ac)
+			cache = atoi(av[++i]); // number of cached results of the service
+		else if (!strcmp(av[i], "-workers") && i + 1 < ac)
+			workers = atoi(av[++i]); // solve workers of the service (0 one per hardware thread)
+		else if (!strcmp(av[i], "-request") && i + 2 < ac)
+		{
+			// send a request line to a service
+			serve = av[++i];
+			request = av[++i];
+		}
+		else if (!strcmp(av[i], "-dual"))
+		{
+			// write the dual of the whole sphere, vertices on the sphere or planar faces
+			pgm.dual = DUAL_SPHERE;
+			if (i + 1 < ac && !strcmp(av[i + 1], "polar"))
+				pgm.dual = DUAL_POLAR, ++i;
+			else if (i + 1 < ac && !strcmp(av[i + 1], "sphere"))
+				++i;
+		}
+		else if (!strcmp(av[i], "-planarity"))
+			pgm.planarity = 1; // report the out of plane deviation of the dual faces
+		else if (!strcmp(av[i], "-instanced"))
+			pgm.instanced = 1; // write the sphere as one base mesh and its rotations (glTF binary)
+		else if (!strcmp(av[i], "-frame"))
+		{
+			// write the solid frame, optional strut radius
+			pgm.frame = 1;
+			if (i + 1 < ac && av[i + 1][0] != '-')
+				pgm.strut = atof(av[++i]);
+		}
+		else if (!strcmp(av[i], "-shell") && i + 1 < ac)
+		{
+			// write the offset shell panels, thickness and optional outward offset (may be negative)
+			pgm.shell = atof(av[++i]);
+			if (i + 1 < ac && (av[i + 1][0] != '-' || (av[i + 1][1] >= '0' && av[i + 1][1] <= '9') || av[i + 1][1] == '.'))
+				pgm.outside = atof(av[++i]);
+		}
+		else if (!strcmp(av[i], "-panels"))
+		{
+			// test of the point in panel index with random directions
+			panels = PANEL_TEST_COUNT;
+			if (i + 1 < ac && av[i + 1][0] >= '0' && av[i + 1][0] <= '9')
+				panels = atol(av[++i]);
+		}
+		else if (!strcmp(av[i], "-constraints") && i + 1 < ac)
+			constraints = av[++i]; // solve a constraint set instead of the solutions
+		else if (!strcmp(av[i], "-constrainttest"))
+			constrainttest = 1;
+		else if (!strcmp(av[i], "-compare") && i + 2 < ac)
+		{
+			// compare two solutions instead of solving, optional largest deviation
+			compare[0] = av[++i];
+			compare[1] = av[++i];
+			if (i + 1 < ac && ((av[i + 1][0] >= '0' && av[i + 1][0] <= '9') || av[i + 1][0] == '.'))
+				comparemax = atof(av[++i]);
+		}
+		else if (!strcmp(av[i], "-nearest"))
+		{
+			// test of the nearest vertex index with random points
+			nearest = NEAR_TEST_COUNT;
+			if (i + 1 < ac && av[i + 1][0] >= '0' && av[i + 1][0] <= '9')
+				nearest = atol(av[++i]);
+		}
+		else if (!strcmp(av[i], "-log") && i + 1 < ac)
+		{
+			// level of the solver records (off, error, note, info, debug)
+			loglevel = log_level_parse(av[++i]);
+			if (loglevel < LOG_OFF)
+			{
+				printf("unknown log level: %s\n", av[i]);
+				return 1;
+			}
+		}
+		else if (!strcmp(av[i], "-logformat") && i + 1 < ac)
+			logformat = strcmp(av[++i], "fields") ? LOG_FORMAT_TEXT : LOG_FORMAT_FIELDS; // text or fields
+		else if (!strcmp(av[i], "-servetest"))
+		{
+			// self test of the service with concurrent clients
+			servetest = SERVICE_CLIENTS;
+			if (i + 1 < ac && av[i + 1][0] >= '0' && av[i + 1][0] <= '9')
+				servetest = atoi(av[++i]);
+		}
+		else if (!strcmp(av[i], "-schedtest"))
+		{
+			// schedule test of the service under a batch load of clients
+			schedtest = SERVICE_CLIENTS;
+			if (i + 1 < ac && av[i + 1][0] >= '0' && av[i + 1][0] <= '9')
+				schedtest = atoi(av[++i]);
+		}
+	}
+
+	// a forced instruction set variant of the batch kernels, the processor must have it
+	if (isa && kernel_isa_select(isa) < 0)
+	{
+		printf("instruction set not available: %s\n", isa);
+		return KERNEL_ISA_UNAVAILABLE;
+	}
+
+	// the solver records are the console output of the solutions, a batch reports its problems,
+	// a comparison its errors, the other modes are silent by default
+	if (loglevel == -2)
+		loglevel = batch ? LOG_NOTE : compare[0] ? LOG_ERROR : (difftest || panels || nearest || constrainttest || servetest || schedtest || request || serve) ? LOG_OFF : LOG_INFO;
+	log_open(loglevel, logformat, stdout);
+	atexit(log_close);
+
+	if (difftest)
+		return kernel_difftest(&pgm, difftest, difftol);
+	if (panels)
+		return panel_test(&pgm, panels);
+	if (nearest)
+		return near_test(&pgm, nearest);
+	if (constrainttest)
+		return constraint_test(&pgm);
+
+	if (servetest)
+		return service_selftest(servetest, cache);
+	if (schedtest)
+		return service_schedtest(schedtest, workers);
+	if (request)
+		return service_request(serve, request) ? 1 : 0;
+	if (serve)
+		return service_run(serve, cache, workers);
+
+	if (batch)
+	{
+		if (shards < 1 || manifest_read(batch, &manifest))
+			return 1;
+		if (merge)
+			failed = batch_merge(&manifest, results);
+		else if (shard >= 0)
+		{
+			batch_claim(results, shard, shards); // keeps the shard from other claiming processes
+			failed = batch_run(&manifest, results, shard, shards, resume);
+		}
+		else
+		{
+			// claim the shards no other process owns, when resuming also take 
+			// over the claimed shards that did not run to the end: their 
+			// processes must be gone, the takeover does not check it
+			for (failed = shard = 0; shard < shards; ++shard)
+			{
+				if (batch_claim(results, shard, shards) || (resume && !batch_closed(results, shard, shards)))
+					failed += batch_run(&manifest, results, shard, shards, resume);
+			}
+		}
+		manifest_free(&manifest);
+		return failed ? 1 : 0;
+	}
+
+	if (constraints)
+		return constraint_output(&pgm, constraints);
+	if (compare[0])
+	{
+		// a job names its batch result
+		for (i = 0; i < 2; ++i)
+			compare[i] = batch_result_file(results, compare[i], comparefile[i], BATCH_PATH);
+		return diff_output(&pgm, compare[0], compare[1], comparemax);
+	}
+
+	// reference LCD triangle for icosahedron
+	LOG(LOG_INFO, "reference", "%f %f %f", RTD(pgm.ref.a), RTD(pgm.ref.b), RTD(pgm.ref.c));
+
+	// generate the (2,0) solution
+	failed = classI_2v_solution(&pgm,"icosa20");
+
+	// generate the (3,0) solution
+	failed |= classI_3v_solution(&pgm, "icosa30");
+
+	// generate the (4,0) solution
+	failed |= classI_4v_solution(&pgm, "icosa40");
+
+	// generate the (5,0) solution
+	failed |= classI_5v_solution(&pgm, "icosa50");
+
+	// generate the (6,0) solution(s)
+	failed |= classI_6v_solution(&pgm, "icosa60");
+
+	// generate the (7,0) solution(s)
+	failed |= classI_7v_solution(&pgm, "icosa70");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,1499 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Solve service.
+
+	Clients connect over TCP and send one request per line:
+		solve b c variant [options]		a job in the manifest syntax (see icosa_batch.cpp)
+			[priority=interactive|batch] [deadline=ms] [id=tag]
+		cancel tag						cancel the waiting requests of a tag
+		metrics							request, solve, schedule and cache counters
+		quit							close the connection
+	Every response is a header line '<ok|failed|error> <length>' followed by 
+	'length' bytes of text. A solved job is returned as its key, status,
+	certification, residual and seeds followed by the OFF geometry.
+
+	Popular configurations are requested by many clients at the same time, so
+	the serialised results are kept in an LRU cache keyed by the normalized
+	job (job_key). A request for a job that is being solved waits for that
+	solve instead of starting another one (single flight).
+
+	The solves run on a pool of workers. Queued tasks are taken by class, 
+	interactive before batch, and by earliest deadline within a class, so an
+	interactive request waits at most for the solves already running. A 
+	request gives up when its deadline passes, when it is cancelled or when
+	a newer request with the same tag supersedes it. Once no requester waits
+	for a task any more its cancellation token is set: a queued task is 
+	dropped and a running solve stops at its next evaluation.
+
+*/
+// icosa_service.cpp : Defines the solve service (library).
+//
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+#include "icosa_truncations.h"
+
+#if defined(_WIN32)
+typedef SOCKET				SERVICE_SOCKET;
+#define SOCKET_NONE			INVALID_SOCKET
+#define socket_close(s)		closesocket(s)
+#else
+typedef int					SERVICE_SOCKET;
+#define SOCKET_NONE			-1
+#define socket_close(s)		close(s)
+#endif
+
+// a client that went away must not raise SIGPIPE in the service
+#if defined(MSG_NOSIGNAL)
+#define SOCKET_SEND_FLAGS	MSG_NOSIGNAL
+#else
+#define SOCKET_SEND_FLAGS	0
+#endif
+
+// solve of a job shared by all the requests waiting for it
+typedef struct {
+	JOB			job;
+	char		key[MANIFEST_KEY];
+	CANCEL		cancel;
+	int			priority;	// class of the most urgent requester
+	double		due;		// earliest deadline of the requesters (scheduling), 0 none
+	int			interest;	// requesters still waiting
+	int			refs;		// requesters, queue and worker holding the task
+	int			entry;		// cache entry while in flight or -1
+	int			queued, running, done;
+	long		overtake;	// batch tasks started when it was queued interactive
+	int			status;
+	char		*text;		// serialised result once done
+	int			length;
+} TASK;
+
+// waiting request, found by its tag for cancel and supersede
+typedef struct REQUEST {
+	char			tag[SERVICE_TAG];
+	int				cancelled;
+	struct REQUEST	*next;
+} REQUEST;
+
+// tasks of one scheduling class
+typedef struct {
+	TASK	**task;
+	int		count, size;
+} TASK_QUEUE;
+
+// cached result, in flight until the solve that inserted it completes
+typedef struct {
+	char				key[MANIFEST_KEY];
+	unsigned long long	hash;
+	char				*text;		// serialised result
+	int					length;
+	int					ready;		// 0 while in flight
+	TASK				*task;		// solve in flight
+	int					prev, next;	// LRU list, most recent first
+	int					chain;		// next entry of the hash bucket (free list of removed entries)
+} CACHE_ENTRY;
+
+typedef struct {
+	CACHE_ENTRY				*entry;
+	int						capacity;
+	int						count;
+	int						*bucket;	// first entry of each hash bucket
+	int						buckets;
+	int						head, tail;	// LRU list
+	int						free;		// removed entries for reuse
+	long					hits;		// ready results
+	long					coalesced;	// results waited for while in flight
+	long					misses;		// solves started
+	long					evictions;
+	long					bytes;		// size of the cached results
+	std::mutex				lock;		// cache, queues and tasks
+	std::condition_variable	ready;		// a task completed or a request was cancelled
+} RESULT_CACHE;
+
+typedef struct {
+	SERVICE_SOCKET			listener;
+	int						port;			// bound port
+	RESULT_CACHE			cache;
+	TASK_QUEUE				queue[SERVICE_CLASSES];
+	REQUEST					*waiting;		// requests waiting for a task
+	std::thread				*worker;
+	int						workers;
+	int						running;		// tasks being solved
+	std::condition_variable	work;			// a task was queued
+	std::atomic<int>		stop;
+	std::atomic<int>		connections;	// open connections
+	std::atomic<long>		requests, solves, errors;
+	long					expired, cancelled, superseded, dropped, aborted; // (cache lock)
+	long					batch_started;	// batch tasks taken by the workers (cache lock)
+	long					contended;		// interactive tasks queued while batch tasks waited (cache lock)
+	long					overtaken;		// interactive tasks a batch task was taken before (cache lock)
+} SERVICE;
+
+// buffered line reader of a connection
+typedef struct {
+	SERVICE_SOCKET	socket;
+	char			data[SERVICE_LINE * 2];
+	int				n;
+} CONNECTION;
+
+#define SELFTEST_ROUNDS		4	// rounds of the popular requests per self test client
+#define SCHEDTEST_PROBES	100	// probe requests of each class in the schedule test (p99 is the second largest)
+#define SCHEDTEST_DEADLINE	5	// deadline (ms) of the expiring request of the schedule test
+
+// popular requests of the self test, "5 0 0 radius=1" normalizes to the key of "5 0 0"
+static char *selftest_request[] = {
+	"solve 7 0 0 radius=10", "solve 7 0 1 radius=10", "solve 7 0 2 radius=10",
+	"solve 5 0 0", "solve 6 0 0", "solve 6 0 1", "solve 5 0 0 radius=1",
+	"solve 5 0 0 radius=3 tolerance=0.0005", "solve 6 0 0 radius=5 tolerance=0.0005",
+};
+
+static void cache_init(RESULT_CACHE *cache, int capacity);
+static void cache_free(RESULT_CACHE *cache);
+static int cache_find(RESULT_CACHE *cache, char *key, unsigned long long hash);
+static int cache_insert(RESULT_CACHE *cache, char *key, unsigned long long hash);
+static void cache_remove(RESULT_CACHE *cache, int i);
+static void cache_unlink(RESULT_CACHE *cache, int i);
+static void cache_push(RESULT_CACHE *cache, int i);
+static char *text_copy(char *text, int length);
+static SERVICE *service_open(char *address, int cache, int workers);
+static void service_close(SERVICE *svc);
+static void service_loop(SERVICE *svc);
+static void service_connection(SERVICE *svc, SERVICE_SOCKET s);
+static int request_options(char *request, char *job, int size, int *priority, double *deadline, char *tag);
+static char *service_solve(SERVICE *svc, char *request, int *length, char **word);
+static int task_join(SERVICE *svc, TASK *task, int priority, double deadline);
+static void task_leave(SERVICE *svc, TASK *task);
+static void task_complete(SERVICE *svc, TASK *task, int status, char *text, int length);
+static void task_release(TASK *task);
+static int queue_push(TASK_QUEUE *queue, TASK *task);
+static void queue_remove(TASK_QUEUE *queue, TASK *task);
+static TASK *scheduler_next(SERVICE *svc);
+static void service_worker(SERVICE *svc);
+static char *service_cancel(SERVICE *svc, char *tag, int *length);
+static char *service_format(char *key, JOB *job, JOB_RESULT *result, int *length);
+static char *service_metrics(SERVICE *svc, int *length);
+static int service_address(char *address, struct sockaddr_in *sa);
+static SERVICE_SOCKET service_connect(char *address);
+static int service_call(CONNECTION *conn, char *request, char **payload, int *length);
+static int socket_read_line(CONNECTION *conn, char *line, int size);
+static int socket_read(CONNECTION *conn, char *data, int length);
+static int socket_write(SERVICE_SOCKET s, char *data, int length);
+static void selftest_client(char *address, int client, int clients, std::atomic<int> *started, std::mutex *lock, unsigned long long *reference, int *mismatches);
+static void schedtest_load(char *address, int client, std::atomic<int> *stop, std::atomic<long> *completed);
+static void schedtest_cancel(char *address, char *request, int *result);
+static double schedtest_call(CONNECTION *conn, char *request, char **word);
+static void schedtest_percentiles(double *latency, int n, double *p50, double *p99, double *max);
+
+//---------------------------------------------------------------------------
+static void cache_init(RESULT_CACHE *cache, int capacity)
+//---------------------------------------------------------------------------
+{
+	int		i;
+
+	cache->capacity = capacity > 0 ? capacity : 0;
+	cache->count = 0;
+	cache->entry = (CACHE_ENTRY*)calloc(cache->capacity + 1, sizeof(CACHE_ENTRY));
+	cache->buckets = cache->capacity * 2 + 1;
+	cache->bucket = (int*)malloc(cache->buckets * sizeof(int));
+	for (i = 0; i < cache->buckets; ++i)
+		cache->bucket[i] = -1;
+	cache->head = cache->tail = cache->free = -1;
+	cache->hits = cache->coalesced = cache->misses = cache->evictions = cache->bytes = 0;
+}
+
+//---------------------------------------------------------------------------
+static void cache_free(RESULT_CACHE *cache)
+//---------------------------------------------------------------------------
+{
+	int		i;
+
+	for (i = 0; i < cache->count; ++i)
+	{
+		if (cache->entry[i].ready)
+			free(cache->entry[i].text);
+	}
+	free(cache->entry);
+	free(cache->bucket);
+}
+
+//---------------------------------------------------------------------------
+static int cache_find(RESULT_CACHE *cache, char *key, unsigned long long hash)
+//---------------------------------------------------------------------------
+{
+	// entry of the key or -1 (cache locked)
+	int		i;
+
+	for (i = cache->bucket[hash % cache->buckets]; i >= 0; i = cache->entry[i].chain)
+	{
+		if (cache->entry[i].hash == hash && !strcmp(cache->entry[i].key, key))
+			return i;
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+static int cache_insert(RESULT_CACHE *cache, char *key, unsigned long long hash)
+//---------------------------------------------------------------------------
+{
+	// Insert an in flight entry for the key (cache locked). A full cache evicts
+	// its least recently used ready entry. Returns the entry or -1 when every 
+	// entry is in flight (the result is then not cached).
+	CACHE_ENTRY	*e;
+	int			i;
+
+	if (cache->free >= 0)
+	{
+		i = cache->free;
+		cache->free = cache->entry[i].chain;
+	}
+	else if (cache->count < cache->capacity)
+		i = cache->count++;
+	else
+	{
+		for (i = cache->tail; i >= 0 && !cache->entry[i].ready; i = cache->entry[i].prev)
+			;
+		if (i < 0)
+			return -1;
+		cache_remove(cache, i);
+		++cache->evictions;
+		i = cache->free;
+		cache->free = cache->entry[i].chain;
+	}
+
+	e = &cache->entry[i];
+	strcpy(e->key, key);
+	e->hash = hash;
+	e->text = 0;
+	e->length = 0;
+	e->ready = 0;
+	e->task = 0;
+	e->chain = cache->bucket[hash % cache->buckets];
+	cache->bucket[hash % cache->buckets] = i;
+	cache_push(cache, i);
+	return i;
+}
+
+//---------------------------------------------------------------------------
+static void cache_remove(RESULT_CACHE *cache, int i)
+//---------------------------------------------------------------------------
+{
+	// remove an entry (evicted or a cancelled solve) onto the free list (cache locked)
+	CACHE_ENTRY	*e = &cache->entry[i];
+	int			*p;
+
+	cache_unlink(cache, i);
+	for (p = &cache->bucket[e->hash % cache->buckets]; *p != i; p = &cache->entry[*p].chain)
+		;
+	*p = e->chain;
+	if (e->ready)
+	{
+		cache->bytes -= e->length;
+		free(e->text);
+	}
+	e->ready = 0;
+	e->text = 0;
+	e->task = 0;
+	e->chain = cache->free;
+	cache->free = i;
+}
+
+//---------------------------------------------------------------------------
+static void cache_unlink(RESULT_CACHE *cache, int i)
+//---------------------------------------------------------------------------
+{
+	// remove an entry from the LRU list
+	CACHE_ENTRY	*e = &cache->entry[i];
+
+	if (e->prev >= 0)
+		cache->entry[e->prev].next = e->next;
+	else
+		cache->head = e->next;
+	if (e->next >= 0)
+		cache->entry[e->next].prev = e->prev;
+	else
+		cache->tail = e->prev;
+}
+
+//---------------------------------------------------------------------------
+static void cache_push(RESULT_CACHE *cache, int i)
+//---------------------------------------------------------------------------
+{
+	// make an entry the most recently used
+	CACHE_ENTRY	*e = &cache->entry[i];
+
+	e->prev = -1;
+	e->next = cache->head;
+	if (cache->head >= 0)
+		cache->entry[cache->head].prev = i;
+	cache->head = i;
+	if (cache->tail < 0)
+		cache->tail = i;
+}
+
+//---------------------------------------------------------------------------
+static char *text_copy(char *text, int length)
+//---------------------------------------------------------------------------
+{
+	char	*copy;
+
+	copy = (char*)malloc(length + 1);
+	memcpy(copy, text, length);
+	copy[length] = 0;
+	return copy;
+}
+
+//---------------------------------------------------------------------------
+static int request_options(char *request, char *job, int size, int *priority, double *deadline, char *tag)
+//---------------------------------------------------------------------------
+{
+	// Separate the scheduling options of a solve request from its job text
+	// (they are not part of the job key). Returns 0 or -1 for a bad option.
+	char	*p, *word;
+	int		n, k;
+
+	*priority = SERVICE_INTERACTIVE;
+	*deadline = 0;
+	tag[0] = 0;
+	job[0] = 0;
+	for (p = request, n = 0; ; )
+	{
+		while (*p == ' ' || *p == '\t')
+			++p;
+		if (!*p)
+			break;
+		for (word = p; *p && *p != ' ' && *p != '\t'; ++p)
+			;
+		k = (int)(p - word);
+		if (k > 9 && !strncmp(word, "priority=", 9))
+		{
+			if (!strncmp(word + 9, "interactive", k - 9) && k - 9 == 11)
+				*priority = SERVICE_INTERACTIVE;
+			else if (!strncmp(word + 9, "batch", k - 9) && k - 9 == 5)
+				*priority = SERVICE_BATCH;
+			else
+				return -1;
+		}
+		else if (k > 9 && !strncmp(word, "deadline=", 9))
+			*deadline = clock_seconds() + atof(word + 9) * 0.001; // milliseconds from now
+		else if (k > 3 && !strncmp(word, "id=", 3))
+		{
+			if (k - 3 >= SERVICE_TAG)
+				return -1;
+			memcpy(tag, word + 3, k - 3);
+			tag[k - 3] = 0;
+		}
+		else
+		{
+			if (n + k + 2 > size)
+				return -1;
+			n += sprintf_s(job + n, size - n, "%s%.*s", n ? " " : "", k, word);
+		}
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static char *service_solve(SERVICE *svc, char *request, int *length, char **word)
+//---------------------------------------------------------------------------
+{
+	// Result of a solve request, from the cache, from the task in flight or 
+	// from a new task. Returns the response text (allocated) and its header word.
+	RESULT_CACHE		*cache = &svc->cache;
+	REQUEST				req, *r, **pr;
+	TASK				*task;
+	JOB					job;
+	char				text[SERVICE_LINE], key[MANIFEST_KEY], *copy, *reason;
+	unsigned long long	hash;
+	double				deadline;
+	int					i, priority;
+
+	if (request_options(request, text, sizeof(text), &priority, &deadline, req.tag) || job_parse(text, &job) <= 0)
+	{
+		++svc->errors;
+		*word = "error";
+		*length = (int)strlen("malformed job\n");
+		return text_copy("malformed job\n", *length);
+	}
+	job_key(&job, key, sizeof(key));
+	hash = job_hash(key);
+
+	std::unique_lock<std::mutex>	lock(cache->lock);
+
+	// a newer request of the tag supersedes the waiting ones
+	req.cancelled = 0;
+	if (req.tag[0])
+	{
+		for (r = svc->waiting; r; r = r->next)
+		{
+			if (!strcmp(r->tag, req.tag) && !r->cancelled)
+			{
+				r->cancelled = 2;
+				++svc->superseded;
+				cache->ready.notify_all();
+			}
+		}
+	}
+	req.next = svc->waiting;
+	svc->waiting = &req;
+
+	for (;;)
+	{
+		i = cache_find(cache, key, hash);
+		if (i >= 0 && cache->entry[i].ready)
+		{
+			++cache->hits;
+			cache_unlink(cache, i);
+			cache_push(cache, i);
+			*length = cache->entry[i].length;
+			copy = text_copy(cache->entry[i].text, *length);
+			*word = !strncmp(copy, "status 0\n", 9) ? (char*)"ok" : (char*)"failed";
+			break;
+		}
+		if (i >= 0)
+		{
+			++cache->coalesced;
+			task = cache->entry[i].task;
+		}
+		else
+		{
+			++cache->misses;
+			task = new TASK();
+			task->job = job;
+			strcpy(task->key, key);
+			task->priority = SERVICE_CLASSES;
+			task->entry = cache_insert(cache, key, hash);
+			if (task->entry >= 0)
+				cache->entry[task->entry].task = task;
+		}
+		if (task_join(svc, task, priority, deadline) < 0)
+		{
+			++svc->errors;
+			*word = "error";
+			*length = (int)strlen("out of memory\n");
+			copy = text_copy("out of memory\n", *length);
+			break;
+		}
+
+		// wait for the task, the deadline or a cancel
+		while (!task->done && !req.cancelled && !(deadline > 0 && clock_seconds() >= deadline))
+		{
+			if (deadline > 0)
+				cache->ready.wait_until(lock, std::chrono::steady_clock::time_point(
+					std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(deadline))));
+			else
+				cache->ready.wait(lock);
+		}
+
+		if (task->done && task->status != JOB_CANCELLED)
+		{
+			*length = task->length;
+			copy = text_copy(task->text, *length);
+			*word = task->status == JOB_OK ? (char*)"ok" : (char*)"failed";
+			task_release(task);
+			break;
+		}
+		if (task->done && !req.cancelled && !(deadline > 0 && clock_seconds() >= deadline))
+		{
+			// the task was stopped for the other requesters while this one still waits
+			task_release(task);
+			continue;
+		}
+
+		// give up
+		reason = req.cancelled == 2 ? (char*)"superseded\n" : req.cancelled ? (char*)"cancelled\n" : (char*)"expired\n";
+		if (!req.cancelled)
+			++svc->expired;
+		task_leave(svc, task);
+		task_release(task);
+		*word = "cancelled";
+		*length = (int)strlen(reason);
+		copy = text_copy(reason, *length);
+		break;
+	}
+
+	for (pr = &svc->waiting; *pr != &req; pr = &(*pr)->next)
+		;
+	*pr = req.next;
+	return copy;
+}
+
+//---------------------------------------------------------------------------
+static int task_join(SERVICE *svc, TASK *task, int priority, double deadline)
+//---------------------------------------------------------------------------
+{
+	// A requester joins a task (cache locked). The task takes the class of its
+	// most urgent requester and expires with the last deadline. A new task is 
+	// queued. Returns -1 when the queue cannot grow: the requester has not 
+	// joined, a queued task stays in its class and a new one is dropped.
+	double	d;
+
+	if (priority < task->priority && !task->running && !task->done)
+	{
+		if (queue_push(&svc->queue[priority], task) < 0)
+		{
+			if (!task->interest)
+			{
+				++task->refs;
+				task_complete(svc, task, JOB_CANCELLED, 0, 0); // removes its cache entry and frees it
+			}
+			return -1;
+		}
+		if (task->queued)
+			queue_remove(&svc->queue[task->priority], task);
+		else
+			++task->refs; // held by the queue and then the worker
+		if (priority == SERVICE_INTERACTIVE)
+		{
+			task->overtake = svc->batch_started;
+			svc->contended += svc->queue[SERVICE_BATCH].count > 0;
+		}
+		task->queued = 1;
+		svc->work.notify_one();
+	}
+	if (priority < task->priority)
+		task->priority = priority;
+
+	++task->refs;
+	if (!task->interest++)
+		task->cancel.deadline = deadline;
+	else
+	{
+		d = task->cancel.deadline;
+		task->cancel.deadline = (d <= 0 || deadline <= 0) ? 0 : (deadline > d ? deadline : d);
+	}
+	if (deadline > 0 && (task->due <= 0 || deadline < task->due))
+		task->due = deadline;
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void task_leave(SERVICE *svc, TASK *task)
+//---------------------------------------------------------------------------
+{
+	// A requester gives up (cache locked). Without requesters the task is 
+	// cancelled: dropped from its queue or stopped by its token when running.
+	if (--task->interest > 0 || task->done)
+		return;
+	task->cancel.cancelled = 1;
+	if (task->queued)
+	{
+		queue_remove(&svc->queue[task->priority], task);
+		task->queued = 0;
+		++svc->dropped;
+		task_complete(svc, task, JOB_CANCELLED, 0, 0); // releases the queue reference
+	}
+}
+
+//---------------------------------------------------------------------------
+static void task_complete(SERVICE *svc, TASK *task, int status, char *text, int length)
+//---------------------------------------------------------------------------
+{
+	// Store the result of a task (cache locked). A cancelled solve is not 
+	// cached. Wakes the requesters and releases the queue or worker reference.
+	RESULT_CACHE	*cache = &svc->cache;
+	CACHE_ENTRY		*e;
+
+	task->done = 1;
+	task->status = status;
+	task->text = text;
+	task->length = length;
+	if (task->entry >= 0)
+	{
+		e = &cache->entry[task->entry];
+		if (status == JOB_CANCELLED)
+			cache_remove(cache, task->entry);
+		else
+		{
+			e->text = text_copy(text, length);
+			e->length = length;
+			e->ready = 1;
+			e->task = 0;
+			cache->bytes += length;
+		}
+		task->entry = -1;
+	}
+	cache->ready.notify_all();
+	task_release(task);
+}
+
+//---------------------------------------------------------------------------
+static void task_release(TASK *task)
+//---------------------------------------------------------------------------
+{
+	// drop a reference (cache locked), the last one frees the task
+	if (--task->refs > 0)
+		return;
+	free(task->text);
+	delete task;
+}
+
+//---------------------------------------------------------------------------
+static int queue_push(TASK_QUEUE *queue, TASK *task)
+//---------------------------------------------------------------------------
+{
+	// append a task, returns -1 when the queue cannot grow (queue unchanged)
+	TASK	**grown;
+	int		size;
+
+	if (queue->count == queue->size)
+	{
+		size = queue->size ? queue->size * 2 : 64;
+		grown = (TASK**)realloc(queue->task, size * sizeof(TASK*));
+		if (!grown)
+			return -1;
+		queue->task = grown;
+		queue->size = size;
+	}
+	queue->task[queue->count++] = task;
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void queue_remove(TASK_QUEUE *queue, TASK *task)
+//---------------------------------------------------------------------------
+{
+	// remove keeping the arrival order
+	int		i;
+
+	for (i = 0; i < queue->count && queue->task[i] != task; ++i)
+		;
+	if (i == queue->count)
+		return;
+	memmove(&queue->task[i], &queue->task[i + 1], (queue->count - i - 1) * sizeof(TASK*));
+	--queue->count;
+}
+
+//---------------------------------------------------------------------------
+static TASK *scheduler_next(SERVICE *svc)
+//---------------------------------------------------------------------------
+{
+	// Next task to solve (cache locked): the first class with a task, within 
+	// the class the earliest deadline (arrival order without deadlines). 
+	// Expired tasks are dropped on the way. An interactive task taken after a
+	// batch task that started while it was queued counts as overtaken.
+	TASK_QUEUE	*queue;
+	TASK		*task;
+	double		due, best;
+	int			c, i, k;
+
+	for (c = 0; c < SERVICE_CLASSES; ++c)
+	{
+		queue = &svc->queue[c];
+		while (queue->count)
+		{
+			k = 0;
+			best = DBL_MAX;
+			for (i = 0; i < queue->count; ++i)
+			{
+				due = queue->task[i]->due > 0 ? queue->task[i]->due : DBL_MAX;
+				if (due < best)
+				{
+					best = due;
+					k = i;
+				}
+			}
+			task = queue->task[k];
+			queue_remove(queue, task);
+			task->queued = 0;
+			if (!cancel_expired(&task->cancel))
+			{
+				if (c == SERVICE_BATCH)
+					++svc->batch_started;
+				else if (svc->batch_started > task->overtake)
+					++svc->overtaken;
+				return task;
+			}
+			++svc->dropped;
+			task_complete(svc, task, JOB_CANCELLED, 0, 0);
+		}
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void service_worker(SERVICE *svc)
+//---------------------------------------------------------------------------
+{
+	// solve the scheduled tasks until the service stops
+	RESULT_CACHE	*cache = &svc->cache;
+	JOB_RESULT		result;
+	TASK			*task;
+	char			*text;
+	int				length;
+
+	std::unique_lock<std::mutex>	lock(cache->lock);
+	while (!svc->stop)
+	{
+		task = scheduler_next(svc);
+		if (!task)
+		{
+			svc->work.wait(lock);
+			continue;
+		}
+		task->running = 1;
+		++svc->running;
+		lock.unlock();
+
+		++svc->solves;
+		task->job.cancel = &task->cancel;
+		job_solve(&task->job, &result);
+		text = 0;
+		length = 0;
+		if (result.status != JOB_CANCELLED)
+			text = service_format(task->key, &task->job, &result, &length);
+
+		lock.lock();
+		task->running = 0;
+		--svc->running;
+		if (result.status == JOB_CANCELLED)
+			++svc->aborted;
+		task_complete(svc, task, result.status, text, length);
+	}
+}
+
+//---------------------------------------------------------------------------
+static char *service_cancel(SERVICE *svc, char *tag, int *length)
+//---------------------------------------------------------------------------
+{
+	// cancel the waiting requests of a tag
+	RESULT_CACHE	*cache = &svc->cache;
+	REQUEST			*r;
+	char			text[64];
+	int				n;
+
+	std::lock_guard<std::mutex>	lock(cache->lock);
+	for (n = 0, r = svc->waiting; r; r = r->next)
+	{
+		if (!strcmp(r->tag, tag) && !r->cancelled)
+		{
+			r->cancelled = 1;
+			++svc->cancelled;
+			++n;
+		}
+	}
+	cache->ready.notify_all();
+	*length = sprintf_s(text, sizeof(text), "cancelled %d\n", n);
+	return text_copy(text, *length);
+}
+
+//---------------------------------------------------------------------------
+static char *service_format(char *key, JOB *job, JOB_RESULT *result, int *length)
+//---------------------------------------------------------------------------
+{
+	// serialised result: status, certification, residual, seeds (radians), key and OFF geometry
+	char	*text;
+	int		i, n, size;
+
+	size = OFF_TEXT_SIZE + MANIFEST_KEY + 256;
+	text = (char*)malloc(size);
+	n = sprintf_s(text, size, "status %d\ncertified %d\nresidual %.17g\nseeds %d", 
+		result->status, result->certified, result->residual, result->seeds);
+	for (i = 0; i < result->seeds; ++i)
+		n += sprintf_s(text + n, size - n, " %.17g", result->seed[i]);
+	n += sprintf_s(text + n, size - n, "\nkey %s\n", key);
+	if (result->status == JOB_OK)
+		n += patch_format_off(text + n, size - n, result->patch, result->gp, job->radius);
+	*length = n;
+	return text;
+}
+
+//---------------------------------------------------------------------------
+static char *service_metrics(SERVICE *svc, int *length)
+//---------------------------------------------------------------------------
+{
+	// counters of the service as 'name value' lines
+	RESULT_CACHE	*cache = &svc->cache;
+	char			*text;
+	int				size;
+
+	size = 1024;
+	text = (char*)malloc(size);
+	std::lock_guard<std::mutex>	lock(cache->lock);
+	*length = sprintf_s(text, size, 
+		"requests %ld\nsolves %ld\nerrors %ld\nconnections %d\n"
+		"cache_hits %ld\ncache_coalesced %ld\ncache_misses %ld\ncache_evictions %ld\n"
+		"cache_entries %d\ncache_capacity %d\ncache_bytes %ld\n"
+		"workers %d\nrunning %d\nqueued_interactive %d\nqueued_batch %d\n"
+		"expired %ld\ncancelled %ld\nsuperseded %ld\ndropped %ld\naborted %ld\n"
+		"contended %ld\novertaken %ld\n",
+		svc->requests.load(), svc->solves.load(), svc->errors.load(), svc->connections.load(),
+		cache->hits, cache->coalesced, cache->misses, cache->evictions, 
+		cache->count, cache->capacity, cache->bytes,
+		svc->workers, svc->running, svc->queue[SERVICE_INTERACTIVE].count, svc->queue[SERVICE_BATCH].count,
+		svc->expired, svc->cancelled, svc->superseded, svc->dropped, svc->aborted,
+		svc->contended, svc->overtaken);
+	return text;
+}
+
+//---------------------------------------------------------------------------
+static void service_connection(SERVICE *svc, SERVICE_SOCKET s)
+//---------------------------------------------------------------------------
+{
+	// serve the requests of one client until it disconnects or quits
+	CONNECTION	conn;
+	char		line[SERVICE_LINE], *text, *word, *response;
+	int			length, n, on;
+
+	// requests and responses are single small writes, send them without delay
+	on = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on));
+	conn.socket = s;
+	conn.n = 0;
+	while (!socket_read_line(&conn, line, sizeof(line)))
+	{
+		++svc->requests;
+		if (!strncmp(line, "solve ", 6))
+			text = service_solve(svc, line + 6, &length, &word);
+		else if (!strncmp(line, "cancel ", 7))
+		{
+			text = service_cancel(svc, line + 7, &length);
+			word = "ok";
+		}
+		else if (!strcmp(line, "metrics"))
+		{
+			text = service_metrics(svc, &length);
+			word = "ok";
+		}
+		else if (!strcmp(line, "quit"))
+			break;
+		else
+		{
+			++svc->errors;
+			word = "error";
+			length = (int)strlen("unknown request\n");
+			text = text_copy("unknown request\n", length);
+		}
+
+		// header and text in one write
+		response = (char*)malloc(length + 32);
+		n = sprintf_s(response, 32, "%s %d\n", word, length);
+		memcpy(response + n, text, length);
+		n = socket_write(s, response, n + length);
+		free(response);
+		free(text);
+		if (n)
+			break;
+	}
+	socket_close(s);
+	--svc->connections;
+}
+
+//---------------------------------------------------------------------------
+static void service_loop(SERVICE *svc)
+//---------------------------------------------------------------------------
+{
+	// accept the clients, one thread per connection
+	SERVICE_SOCKET	s;
+
+	while (!svc->stop)
+	{
+		s = accept(svc->listener, 0, 0);
+		if (s == SOCKET_NONE)
+			continue;
+		if (svc->stop)
+		{
+			socket_close(s);
+			break;
+		}
+		++svc->connections;
+		std::thread(service_connection, svc, s).detach();
+	}
+}
+
+//---------------------------------------------------------------------------
+static int service_address(char *address, struct sockaddr_in *sa)
+//---------------------------------------------------------------------------
+{
+	// parse 'host:port' or 'port' (loopback), returns 0 or -1
+	char	host[64], *colon;
+
+	memset(sa, 0, sizeof(struct sockaddr_in));
+	sa->sin_family = AF_INET;
+	colon = strrchr(address, ':');
+	if (colon && colon - address < (int)sizeof(host))
+	{
+		memcpy(host, address, colon - address);
+		host[colon - address] = 0;
+		sa->sin_port = htons((unsigned short)atoi(colon + 1));
+	}
+	else
+	{
+		strcpy(host, "127.0.0.1");
+		sa->sin_port = htons((unsigned short)atoi(address));
+	}
+	return inet_pton(AF_INET, host, &sa->sin_addr) == 1 ? 0 : -1;
+}
+
+//---------------------------------------------------------------------------
+static SERVICE *service_open(char *address, int cache, int workers)
+//---------------------------------------------------------------------------
+{
+	// Listening service on the address (port 0 picks a free port) or 0.
+	// workers <= 0 solves on one worker per hardware thread.
+	struct sockaddr_in	sa;
+	socklen_t			len;
+	SERVICE				*svc;
+	int					on, i;
+
+#if defined(_WIN32)
+	WSADATA				wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+	if (service_address(address, &sa))
+	{
+		printf("invalid service address: %s\n", address);
+		return 0;
+	}
+
+	svc = new SERVICE();
+	svc->listener = socket(AF_INET, SOCK_STREAM, 0);
+	on = 1;
+	setsockopt(svc->listener, SOL_SOCKET, SO_REUSEADDR, (char*)&on, sizeof(on));
+	if (svc->listener == SOCKET_NONE || bind(svc->listener, (struct sockaddr*)&sa, sizeof(sa)) || listen(svc->listener, 64))
+	{
+		printf("cannot listen on %s\n", address);
+		if (svc->listener != SOCKET_NONE)
+			socket_close(svc->listener);
+		delete svc;
+		return 0;
+	}
+	len = sizeof(sa);
+	getsockname(svc->listener, (struct sockaddr*)&sa, &len);
+	svc->port = ntohs(sa.sin_port);
+	cache_init(&svc->cache, cache);
+
+	if (workers <= 0)
+		workers = (int)std::thread::hardware_concurrency();
+	svc->workers = workers > 0 ? workers : 1;
+	svc->worker = new std::thread[svc->workers];
+	for (i = 0; i < svc->workers; ++i)
+		svc->worker[i] = std::thread(service_worker, svc);
+	return svc;
+}
+
+//---------------------------------------------------------------------------
+static void service_close(SERVICE *svc)
+//---------------------------------------------------------------------------
+{
+	// release a stopped service once its open connections are closed
+	int		i;
+
+	while (svc->connections)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	{
+		std::lock_guard<std::mutex>	lock(svc->cache.lock);
+		svc->work.notify_all();
+	}
+	for (i = 0; i < svc->workers; ++i)
+		svc->worker[i].join();
+	delete[] svc->worker;
+	for (i = 0; i < SERVICE_CLASSES; ++i)
+		free(svc->queue[i].task);
+	socket_close(svc->listener);
+	cache_free(&svc->cache);
+	delete svc;
+}
+
+//---------------------------------------------------------------------------
+int service_run(char *address, int cache, int workers)
+//---------------------------------------------------------------------------
+{
+	// serve until the process is stopped
+	SERVICE		*svc;
+
+	svc = service_open(address, cache, workers);
+	if (!svc)
+		return 1;
+	printf("Serving on %s (port %d), %d cached results, %d workers\n", address, svc->port, cache, svc->workers);
+	fflush(stdout);
+	service_loop(svc);
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static SERVICE_SOCKET service_connect(char *address)
+//---------------------------------------------------------------------------
+{
+	struct sockaddr_in	sa;
+	SERVICE_SOCKET		s;
+	int					on;
+
+#if defined(_WIN32)
+	WSADATA				wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+	if (service_address(address, &sa))
+		return SOCKET_NONE;
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s != SOCKET_NONE && connect(s, (struct sockaddr*)&sa, sizeof(sa)))
+	{
+		socket_close(s);
+		return SOCKET_NONE;
+	}
+	on = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on));
+	return s;
+}
+
+//---------------------------------------------------------------------------
+static int service_call(CONNECTION *conn, char *request, char **payload, int *length)
+//---------------------------------------------------------------------------
+{
+	// Send a request and read its response (payload allocated). 
+	// Returns 0 for 'ok', 1 for 'failed' or 'error' and -1 on a connection error.
+	char	line[SERVICE_LINE], word[16];
+	int		n;
+
+	*payload = 0;
+	n = sprintf_s(line, sizeof(line), "%s\n", request);
+	if (n >= (int)sizeof(line) || socket_write(conn->socket, line, n))
+		return -1;
+	if (socket_read_line(conn, line, sizeof(line)) || sscanf(line, "%15s %d", word, length) != 2 || *length < 0)
+		return -1;
+	*payload = (char*)malloc(*length + 1);
+	if (socket_read(conn, *payload, *length))
+	{
+		free(*payload);
+		*payload = 0;
+		return -1;
+	}
+	(*payload)[*length] = 0;
+	return strcmp(word, "ok") ? 1 : 0;
+}
+
+//---------------------------------------------------------------------------
+int service_request(char *address, char *request)
+//---------------------------------------------------------------------------
+{
+	// send one request to a service and print the response, returns 0 for 'ok'
+	CONNECTION	conn;
+	char		*payload;
+	int			length, r;
+
+	conn.socket = service_connect(address);
+	conn.n = 0;
+	if (conn.socket == SOCKET_NONE)
+	{
+		printf("cannot connect to %s\n", address);
+		return -1;
+	}
+	r = service_call(&conn, request, &payload, &length);
+	if (payload)
+		fwrite(payload, 1, length, stdout);
+	free(payload);
+	socket_close(conn.socket);
+	return r;
+}
+
+//---------------------------------------------------------------------------
+static int socket_read_line(CONNECTION *conn, char *line, int size)
+//---------------------------------------------------------------------------
+{
+	// next line without its end of line, returns 0 or -1 (closed or too long)
+	char	*eol;
+	int		n;
+
+	for (;;)
+	{
+		eol = (char*)memchr(conn->data, '\n', conn->n);
+		if (eol)
+		{
+			n = (int)(eol - conn->data);
+			if (n >= size)
+				return -1;
+			memcpy(line, conn->data, n);
+			line[n && line[n - 1] == '\r' ? n - 1 : n] = 0;
+			conn->n -= n + 1;
+			memmove(conn->data, eol + 1, conn->n);
+			return 0;
+		}
+		if (conn->n == (int)sizeof(conn->data))
+			return -1;
+		n = recv(conn->socket, conn->data + conn->n, (int)sizeof(conn->data) - conn->n, 0);
+		if (n <= 0)
+			return -1;
+		conn->n += n;
+	}
+}
+
+//---------------------------------------------------------------------------
+static int socket_read(CONNECTION *conn, char *data, int length)
+//---------------------------------------------------------------------------
+{
+	// exactly 'length' bytes (buffered ones first), returns 0 or -1
+	int		n, r;
+
+	n = conn->n < length ? conn->n : length;
+	memcpy(data, conn->data, n);
+	conn->n -= n;
+	memmove(conn->data, conn->data + n, conn->n);
+	while (n < length)
+	{
+		r = recv(conn->socket, data + n, length - n, 0);
+		if (r <= 0)
+			return -1;
+		n += r;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static int socket_write(SERVICE_SOCKET s, char *data, int length)
+//---------------------------------------------------------------------------
+{
+	// all of 'length' bytes, returns 0 or -1
+	int		n;
+
+	while (length > 0)
+	{
+		n = send(s, data, length, SOCKET_SEND_FLAGS);
+		if (n <= 0)
+			return -1;
+		data += n;
+		length -= n;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+static void selftest_client(char *address, int client, int clients, std::atomic<int> *started, std::mutex *lock, unsigned long long *reference, int *mismatches)
+//---------------------------------------------------------------------------
+{
+	// Request the popular jobs in rounds. All the clients start together with 
+	// the same order (identical requests in flight), the later rounds in 
+	// different orders. The responses of equal requests must be identical.
+	CONNECTION			conn;
+	char				*payload;
+	unsigned long long	h;
+	int					count, round, i, k, length;
+
+	count = (int)(sizeof(selftest_request) / sizeof(char*));
+	conn.socket = service_connect(address);
+	conn.n = 0;
+	for (++*started; *started < clients; )
+		std::this_thread::yield();
+	for (round = 0; round < SELFTEST_ROUNDS; ++round)
+	{
+		for (k = 0; k < count; ++k)
+		{
+			i = (k + (round ? client * 3 + round : 0)) % count;
+			h = 0;
+			if (conn.socket == SOCKET_NONE || service_call(&conn, selftest_request[i], &payload, &length))
+				h = 1; // a failed request mismatches any reference
+			else
+			{
+				payload[length] = 0;
+				h = job_hash(payload);
+			}
+			free(payload);
+
+			std::lock_guard<std::mutex>	guard(*lock);
+			if (!reference[i])
+				reference[i] = h;
+			if (h == 1 || reference[i] != h)
+				++*mismatches;
+		}
+	}
+	if (conn.socket != SOCKET_NONE)
+		socket_close(conn.socket);
+}
+
+//---------------------------------------------------------------------------
+int service_selftest(int clients, int cache)
+//---------------------------------------------------------------------------
+{
+	// Run a service on a free loopback port and let concurrent clients request
+	// the same popular jobs. With a cache holding all of them every distinct 
+	// job must be solved exactly once (cache hits or single flight waits for
+	// the others). Returns non zero when the test failed.
+	SERVICE				*svc;
+	std::thread			*client, server;
+	std::mutex			lock;
+	std::atomic<int>	started;
+	unsigned long long	reference[sizeof(selftest_request) / sizeof(char*)];
+	JOB					job;
+	char				address[32], key[MANIFEST_KEY], keys[sizeof(selftest_request) / sizeof(char*)][MANIFEST_KEY], line[SERVICE_LINE];
+	char				*payload;
+	CONNECTION			conn;
+	long				solves;
+	int					i, k, count, distinct, mismatches, length, failed;
+
+	if (clients < 1)
+	{
+		printf("Service self test: FAILED (%d clients)\n", clients);
+		return 1;
+	}
+	svc = service_open("127.0.0.1:0", cache, 0);
+	if (!svc)
+		return 1;
+	sprintf_s(address, sizeof(address), "127.0.0.1:%d", svc->port);
+	server = std::thread(service_loop, svc);
+
+	// distinct normalized jobs
+	count = (int)(sizeof(selftest_request) / sizeof(char*));
+	for (i = distinct = 0; i < count; ++i)
+	{
+		strcpy(line, selftest_request[i] + 6);
+		job_parse(line, &job);
+		job_key(&job, key, sizeof(key));
+		for (k = 0; k < distinct && strcmp(keys[k], key); ++k)
+			;
+		if (k == distinct)
+			strcpy(keys[distinct++], key);
+		reference[i] = 0;
+	}
+
+	mismatches = 0;
+	started = 0;
+	client = new std::thread[clients];
+	for (i = 0; i < clients; ++i)
+		client[i] = std::thread(selftest_client, address, i, clients, &started, &lock, reference, &mismatches);
+	for (i = 0; i < clients; ++i)
+		client[i].join();
+	delete[] client;
+
+	// metrics
+	solves = -1;
+	conn.socket = service_connect(address);
+	conn.n = 0;
+	if (conn.socket != SOCKET_NONE && !service_call(&conn, "metrics", &payload, &length))
+	{
+		printf("Service self test: %d clients, %d rounds of %d requests (%d distinct jobs)\n%s", 
+			clients, SELFTEST_ROUNDS, count, distinct, payload);
+		solves = svc->solves;
+		free(payload);
+	}
+	if (conn.socket != SOCKET_NONE)
+		socket_close(conn.socket);
+
+	// stop, a connection wakes the accept
+	svc->stop = 1;
+	socket_close(service_connect(address));
+	server.join();
+	service_close(svc);
+
+	failed = mismatches || solves < 0 || (cache >= distinct && solves != distinct);
+	printf("Service self test: %s (%d mismatched responses, %ld solves for %d distinct jobs)\n", 
+		failed ? "FAILED" : "passed", mismatches, solves, distinct);
+	return failed;
+}
+
+//---------------------------------------------------------------------------
+static void schedtest_load(char *address, int client, std::atomic<int> *stop, std::atomic<long> *completed)
+//---------------------------------------------------------------------------
+{
+	// flood the service with distinct (uncached) slow batch jobs until stopped
+	CONNECTION	conn;
+	char		request[SERVICE_LINE], *payload;
+	int			n, length;
+
+	conn.socket = service_connect(address);
+	conn.n = 0;
+	for (n = 0; conn.socket != SOCKET_NONE && !*stop; ++n)
+	{
+		sprintf_s(request, sizeof(request), "solve 7 0 %d radius=%d.%05d certify priority=batch", n % 3, 10 + client, n);
+		n = service_call(&conn, request, &payload, &length) < 0 ? -2 : n;
+		free(payload);
+		if (n < 0)
+			break;
+		++*completed;
+	}
+	if (conn.socket != SOCKET_NONE)
+		socket_close(conn.socket);
+}
+
+//---------------------------------------------------------------------------
+static void schedtest_cancel(char *address, char *request, int *result)
+//---------------------------------------------------------------------------
+{
+	// send a request that is expected to be cancelled, result 0 when it was
+	CONNECTION	conn;
+	char		*payload;
+	int			length;
+
+	*result = -1;
+	conn.socket = service_connect(address);
+	conn.n = 0;
+	if (conn.socket == SOCKET_NONE)
+		return;
+	if (service_call(&conn, request, &payload, &length) == 1 && !strcmp(payload, "cancelled\n"))
+		*result = 0;
+	free(payload);
+	socket_close(conn.socket);
+}
+
+//---------------------------------------------------------------------------
+static double schedtest_call(CONNECTION *conn, char *request, char **word)
+//---------------------------------------------------------------------------
+{
+	// latency (ms) of a request, word is the first word of the response text
+	static char	*words[] = { "status", "expired", "cancelled", "superseded" };
+	char		*payload;
+	double		t;
+	int			length, i;
+
+	t = clock_seconds();
+	service_call(conn, request, &payload, &length);
+	t = (clock_seconds() - t) * 1000;
+	*word = "error";
+	for (i = 0; payload && i < (int)(sizeof(words) / sizeof(char*)); ++i)
+	{
+		if (!strncmp(payload, words[i], strlen(words[i])))
+			*word = words[i];
+	}
+	free(payload);
+	return t;
+}
+
+//---------------------------------------------------------------------------
+static void schedtest_percentiles(double *latency, int n, double *p50, double *p99, double *max)
+//---------------------------------------------------------------------------
+{
+	// nearest rank percentiles (the latencies are sorted)
+	double	t;
+	int		i, k;
+
+	for (i = 1; i < n; ++i)
+	{
+		for (t = latency[i], k = i; k > 0 && latency[k - 1] > t; --k)
+			latency[k] = latency[k - 1];
+		latency[k] = t;
+	}
+	*p50 = latency[(n - 1) / 2];
+	*p99 = latency[(int)ceil(n * 0.99) - 1];
+	*max = latency[n - 1];
+}
+
+//---------------------------------------------------------------------------
+int service_schedtest(int clients, int workers)
+//---------------------------------------------------------------------------
+{
+	// Run a service on a free loopback port loaded by clients sweeping slow 
+	// batch jobs and probe it with fast jobs of both classes. The gate is the
+	// scheduling order, not the timing: interactive probes must have queued 
+	// while the sweep waited (contended) and no batch task may be taken before
+	// a waiting interactive task (overtaken). The latencies are reported. A 
+	// request must expire at its deadline and a cancel must stop a waiting 
+	// request. Returns non zero when the test failed.
+	SERVICE				*svc;
+	std::thread			*client, server, waiter;
+	std::atomic<int>	stop;
+	std::atomic<long>	completed;
+	CONNECTION			conn;
+	char				address[32], request[SERVICE_LINE], waiting[SERVICE_LINE], tag[SERVICE_TAG], *word, *payload, *expired;
+	double				interactive[SCHEDTEST_PROBES], batch[SCHEDTEST_PROBES], p50[2], p99[2], max[2], deadline;
+	long				contended, overtaken;
+	int					i, n, length, cancel, cancelled, failed;
+
+	if (clients < 1)
+	{
+		printf("Schedule test: FAILED (%d clients)\n", clients);
+		return 1;
+	}
+	svc = service_open("127.0.0.1:0", SERVICE_CACHE, workers);
+	if (!svc)
+		return 1;
+	sprintf_s(address, sizeof(address), "127.0.0.1:%d", svc->port);
+	server = std::thread(service_loop, svc);
+	conn.socket = service_connect(address);
+	conn.n = 0;
+
+	// batch load, wait until it fills the queue
+	stop = 0;
+	completed = 0;
+	client = new std::thread[clients];
+	for (i = 0; i < clients; ++i)
+		client[i] = std::thread(schedtest_load, address, i, &stop, &completed);
+	for (i = 0; i < 1000; ++i)
+	{
+		std::unique_lock<std::mutex>	lock(svc->cache.lock);
+		if (svc->queue[SERVICE_BATCH].count > 0)
+			break;
+		lock.unlock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// probes of a fast distinct job in both classes, alternating
+	for (i = n = 0; i < SCHEDTEST_PROBES; ++i)
+	{
+		sprintf_s(request, sizeof(request), "solve 5 0 0 radius=2.%05d priority=interactive", i);
+		interactive[i] = schedtest_call(&conn, request, &word);
+		n += strcmp(word, "status") != 0;
+		sprintf_s(request, sizeof(request), "solve 5 0 0 radius=3.%05d priority=batch", i);
+		batch[i] = schedtest_call(&conn, request, &word);
+		n += strcmp(word, "status") != 0;
+	}
+	schedtest_percentiles(interactive, SCHEDTEST_PROBES, &p50[0], &p99[0], &max[0]);
+	schedtest_percentiles(batch, SCHEDTEST_PROBES, &p50[1], &p99[1], &max[1]);
+
+	// a request expiring in the queue
+	sprintf_s(request, sizeof(request), "solve 7 0 2 radius=4 certify priority=batch deadline=%d", SCHEDTEST_DEADLINE);
+	deadline = schedtest_call(&conn, request, &expired);
+
+	// a waiting request cancelled by its tag
+	sprintf_s(tag, sizeof(tag), "sweep%d", svc->port);
+	sprintf_s(waiting, sizeof(waiting), "solve 7 0 1 radius=5 certify priority=batch id=%s", tag);
+	waiter = std::thread(schedtest_cancel, address, waiting, &cancel);
+	sprintf_s(request, sizeof(request), "cancel %s", tag);
+	for (i = cancelled = 0; i < 1000 && !cancelled; ++i)
+	{
+		if (service_call(&conn, request, &payload, &length) || sscanf(payload, "cancelled %d", &cancelled) != 1)
+			cancelled = -1;
+		free(payload);
+		if (!cancelled)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	waiter.join();
+
+	stop = 1;
+	for (i = 0; i < clients; ++i)
+		client[i].join();
+	delete[] client;
+
+	contended = overtaken = -1;
+	if (!service_call(&conn, "metrics", &payload, &length))
+	{
+		printf("Schedule test: %d batch clients (%ld jobs), %d workers\n%s", clients, completed.load(), svc->workers, payload);
+		if (strstr(payload, "\ncontended "))
+			sscanf(strstr(payload, "\ncontended ") + 1, "contended %ld overtaken %ld", &contended, &overtaken);
+	}
+	free(payload);
+	socket_close(conn.socket);
+
+	// stop, a connection wakes the accept
+	svc->stop = 1;
+	socket_close(service_connect(address));
+	server.join();
+	service_close(svc);
+
+	printf("interactive probes: p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", p50[0], p99[0], max[0]);
+	printf("batch probes:       p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", p50[1], p99[1], max[1]);
+	printf("deadline %d ms: %s after %.1f ms\n", SCHEDTEST_DEADLINE, expired, deadline);
+	printf("cancel: %s\n", cancel ? "not cancelled" : "cancelled");
+	printf("order: %ld interactive tasks queued behind the sweep, %ld overtaken by it\n", contended, overtaken);
+	failed = n || contended <= 0 || overtaken != 0 || strcmp(expired, "expired") || cancel;
+	printf("Schedule test: %s\n", failed ? "FAILED" : "passed");
+	return failed;
+}
@@ -0,0 +1,809 @@
+/*
+Copyright (C) 2023 Christopher J Kitrick
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+/*
+
+	Types and functions of the icosahedron truncation solutions shared by the
+	library (icosa_truncations.cpp) and the programs built on it.
+
+*/
+#ifndef ICOSA_TRUNCATIONS_H
+#define ICOSA_TRUNCATIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <memory.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <atomic>
+
+// portable replacements of the MSVC secure CRT functions used by the code
+#ifndef _MSC_VER
+inline int fopen_s(FILE **fp, const char *name, const char *mode)
+{
+	*fp = fopen(name, mode);
+	return *fp ? 0 : errno;
+}
+#define sprintf_s	snprintf
+#endif
+
+#define MTX_ROTATE_X_AXIS	1
+#define MTX_ROTATE_Y_AXIS	2
+#define MTX_ROTATE_Z_AXIS	3
+
+// Utility Conversion Macros
+#define DTR( degree )	( ( degree ) * 0.01745329251994329576923690768489 )
+#define RTD( degree )	( ( degree ) * 57.295779513082320876798154814105 )
+
+// sructure for a spherical triangle and its component angles
+typedef struct {
+	double a, b, c, A, B, C;
+} SPH_TRI;
+
+// cartesian coordinate
+typedef struct {
+	double x, y, z, w;
+} GUT_POINT;
+
+// vector
+typedef struct {
+	double i, j, k, l;
+} GUT_VECTOR;
+
+// spherical coordinate 
+typedef struct {
+	double radius, azimuth, inclination;
+} GUT_SPHERICAL_COORD;
+
+// each vertex resides in 6 symmetrical positions 
+typedef struct {
+	GUT_POINT			p[6];		// cartesian coordinates
+	GUT_SPHERICAL_COORD	sc[6];		// spherical coordinates
+} VERTEX;
+
+// transform matrices 
+typedef struct {
+	struct {
+		double	m[16];
+	} sub[6];
+} SUBFACE;
+
+// stopping criterion for build_loop
+#define BUILD_STOP_RESIDUAL		0	// residual within an angle tolerance
+#define BUILD_STOP_PRECISION	1	// output coordinates settled at the requested resolution
+
+// cancellation token of a solve, checked by the solver loops between evaluations
+typedef struct {
+	std::atomic<int>	cancelled;	// set by the owner of the solve (abandoned or superseded)
+	std::atomic<double>	deadline;	// clock_seconds() at which the solve expires, 0 none
+} CANCEL;
+
+typedef struct {
+	int		mode;
+	double	tolerance;	// residual tolerance (radians) 
+	double	resolution;	// coordinate resolution at the output radius
+	double	radius;		// output radius
+	VERTEX	*vertex;	// vertices watched to estimate the coordinate change per seed change
+	int		count;		// number of watched vertices
+	CANCEL	*cancel;	// stop early when cancelled or expired (optional)
+} BUILD_STOP;
+
+typedef struct {
+	// contains the rotation matrices for moving faces to global position and reverse
+	struct {
+		double	tm[16], tmt[16]; // local to global rotations for icosa face in equalatorial position to z up and back
+		double	m0[16], mt0[16]; // z rotation 0 degrees
+		double	m1[16], mt1[16]; // z rotation 120 degrees
+		double	m2[16], mt2[16]; // z rotation 240 degrees
+	} face;
+
+	// contains the rotation and mirroring matrics for replicating 'A' positions within face
+	SUBFACE subface[6];
+
+	// precomposed transforms moving a local point in area 'a' directly to the local
+	// point in any other area (tm * subface * tmt), used by the fast kernels
+	SUBFACE local[6];
+
+	// reference spherical triangle (LCD)
+	SPH_TRI	ref;
+
+	// space for vertices
+	VERTEX	v[20];
+
+	// output radius of the sphere
+	double	radius;
+
+	// stopping criterion for the iterative solutions
+	BUILD_STOP	stop;
+
+	// run options
+	int		certify;	// certify each solved seed with interval arithmetic
+	int		sensitivity; // report the derivatives of the output vertices with respect to the solved seeds
+	int		kernel;		// index into kernel_table
+	int		parallel;	// solve the variants of a configuration on parallel workers
+	int		quiet;		// no geometry output (benchmarks)
+	int		dual;		// also write the dual of the whole sphere (DUAL_SPHERE or DUAL_POLAR), 0 none
+	int		planarity;	// report the out of plane deviation of the dual faces
+	int		instanced;	// also write the sphere as the instanced base and rotations (glTF binary)
+	int		frame;		// also write the solid frame, struts and hubs as instances (glTF binary)
+	double	strut;		// strut radius of the frame at the output radius, 0 default
+	double	shell;		// panel thickness of the offset shell at the output radius, 0 none
+	double	outside;	// offset of the outer panel faces from the faces of the sphere (outward)
+	CANCEL	*cancel;	// cancellation token of the solve (optional)
+} PROGRAM;
+
+// kernels of the vertex construction, the reference implementation and faster
+// variants that may differ in the last bits (see kernel_difftest)
+typedef struct {
+	char	*name;
+	void	(*sph_tri_bcC)(SPH_TRI *st);
+	void	(*spherical_to_cartesian)(GUT_SPHERICAL_COORD *sc, GUT_POINT *p);
+	void	(*cartesian_to_spherical)(GUT_POINT *p, GUT_SPHERICAL_COORD *sc);
+	void	(*generate_all_vertices)(PROGRAM *pgm, int v, int a);
+} KERNEL;
+
+#define KERNEL_REFERENCE	0
+#define KERNEL_FAST			1
+
+// Instruction set variants of the batch kernels (icosa_kernel.cpp), the best
+// one the processor supports is selected once at startup (kernel_isa) or one
+// is forced by name (kernel_isa_select). generic is the scalar loop over libm, 
+// avx2 and avx512 use the vector math library of glibc 2.35 or later (libmvec,
+// ICOSA_MVEC defined by CMakeLists.txt) and are built by GCC on x86-64 only.
+// The scalar fast kernels keep the generic body, one element does not fill a
+// vector. Floating point contraction (fma) must stay off when the kernels are
+// compiled (-ffp-contract=off, the MSVC default), it moved results of the ill 
+// conditioned cases beyond the differential test tolerance.
+#if defined(ICOSA_MVEC) && defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define KERNEL_ISA_VARIANTS	1
+#else
+#define KERNEL_ISA_VARIANTS	0
+#endif
+
+typedef struct {
+	char	*name;
+	int		(*supported)(void);
+	double	ulp;	// error bound of its math functions in ulp (scales the difftest tolerance)
+	void	(*sph_tri_bcC_batch)(int n, double *b, double *c, double *C, double *a, double *A, double *B);
+	void	(*spherical_to_cartesian_batch)(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z);
+	void	(*cartesian_to_spherical_batch)(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination);
+} KERNEL_ISA;
+
+#define KERNEL_ISA_UNAVAILABLE	77	// exit status of a forced variant the processor lacks (a skipped test)
+
+// reference to one of the symmetrical positions of a vertex
+typedef struct {
+	int		v, a;	// vertex id, LCD area
+} VERTEX_REF;
+
+// output geometry covering LCD area 0 of the global icosahedron face
+typedef struct {
+	int			nv, nf;		// number of vertices and triangles
+	VERTEX_REF	vr[20];		// vertices
+	int			f[20][3];	// triangles as indices into the vertices
+} PATCH;
+
+#define OFF_TEXT_SIZE	2048	// OFF text of any patch (patch_format_off)
+
+// icosahedral symmetry group in the global frame (symmetry_group), the 60 
+// rotations first (identity first) followed by their central inversions
+#define SYMMETRY_ROTATIONS	60
+#define SYMMETRY_ORDER		120
+
+typedef struct {
+	double	m[SYMMETRY_ORDER][16];	// transforms (mtx_vec4_multiply)
+	int		count;
+	double	corner[3][3];			// corners of face 0 (unit sphere)
+} SYMMETRY;
+
+// whole sphere mesh, faces as vertex index lists in CSR form (see icosa_geometry.cpp)
+typedef struct {
+	int		nv, nf;
+	double	*x, *y, *z;	// vertices (unit sphere)
+	int		*vorbit;	// orbit of each vertex (construction vertex id or patch triangle)
+	int		*offset;	// first index of each face (nf + 1)
+	int		*index;		// vertex indices of the faces, counter clockwise seen from outside
+	int		*forbit;	// orbit of each face (patch triangle or construction vertex id)
+} MESH;
+
+// triangle mesh of a glTF export and its instances (glb_write)
+typedef struct {
+	MESH	*mesh;			// triangles
+	double	scale;			// of the positions
+	int		normals;		// vertex normals GLB_NORMALS_*
+	int		instances;		// 0 not instanced
+	float	*translation;	// instances x 3 (optional)
+	float	*rotation;		// instances x 4 quaternions x, y, z, w (optional)
+} GLB_MESH;
+
+#define GLB_NORMALS_NONE	0
+#define GLB_NORMALS_SPHERE	1	// the direction of the vertex (on the sphere)
+#define GLB_NORMALS_FLAT	2	// the normal of the face of the vertex (faces do not share vertices)
+
+// offset panels of the faces of the sphere, one per rotation orbit (shell_build)
+typedef struct {
+	int		count;		// panels
+	int		corners;	// corners of all panels
+	int		*face;		// face of the sphere of every panel
+	int		*orbit;		// faces of the sphere in the rotation orbit of every panel
+	int		*first;		// first corner of every panel (count + 1)
+	double	*x, *y, *z;	// corners of the outer faces, then of the inner faces (2 x corners, unit sphere)
+	double	*bevel;		// mitre of the edge from every corner to the next (radians off the face normal)
+} SHELL;
+
+// point in panel index of a solved sphere (icosa_index.cpp)
+#define PANEL_CASES		24	// signs and cyclic permutations of the coordinates folding a direction into the domain
+
+typedef struct {
+	double		frame[9];				// rotation of the global frame into the standard frame of the icosahedron (p' = p * frame)
+	int			region[PANEL_CASES];	// transform mapping the domain onto a fold case (signs * 3 + permutation)
+	double		origin[3], u[3], v[3];	// gnomonic projection touching the domain (centre and axes, standard frame)
+	double		lo[2], hi[2];			// projected domain
+	double		radius;					// angle from the centre to the farthest domain corner
+} PANEL_FOLD;
+
+typedef struct {
+	MESH		mesh;					// triangles of the sphere
+	SYMMETRY	*sym;
+	PANEL_FOLD	fold;
+	double		lo[2], scale[2];		// grid cell of a projected point
+	int			grid;					// cells per side
+	int			nc;						// candidate triangles (reaching into the domain)
+	int			*cell;					// first entry of every cell in the list (grid * grid + 1)
+	int			*list;					// candidates of the cells
+	double		*edge;					// projected edge lines of the candidates (3 x a, b, c)
+	int			*image;					// mesh triangle of candidate k under transform g (g * nc + k)
+} PANEL_INDEX;
+
+#define PANEL_TEST_COUNT	1000000	// default random directions per variant of the panel test
+
+// nearest vertex index of a solved sphere (icosa_index.cpp)
+#define NEAR_MAX		16		// most neighbours of a query
+#define NEAR_LIST		512		// most vertices listed by a grid cell
+#define NEAR_TEST_COUNT	1000000	// default random points per variant of the nearest vertex test
+#define NEAR_TEST_K		4		// neighbours of the test queries
+
+typedef struct {
+	MESH		mesh;					// vertices of the sphere
+	SYMMETRY	*sym;
+	PANEL_FOLD	fold;
+	int			k;						// neighbours the lists hold (1 .. NEAR_MAX)
+	double		lo[2], scale[2];		// grid cell of a projected point
+	int			grid;					// cells per side
+	int			nc;						// candidate vertices (listed by a cell)
+	int			*cell;					// first entry of every cell in the list (grid * grid + 1)
+	int			*list;					// candidate of the entries
+	double		*x, *y, *z, *w;			// positions of the entries (standard frame, SoA) and their squared radius
+	int			*image;					// mesh vertex of candidate k under transform g (g * nc + k)
+} NEAR_INDEX;
+
+// dual vertex placement (dual_build)
+#define DUAL_SPHERE		1	// triangle circumcentres projected to the sphere
+#define DUAL_POLAR		2	// intersections of the tangent planes, planar faces
+
+// out of plane deviation of the dual faces of one orbit (dual_planarity)
+#define PLANARITY_CLASSES	20	// orbits of any configuration (construction vertices)
+
+typedef struct {
+	int		orbit;		// construction vertex id at the centre of the faces
+	int		sides;		// 5 pentagons, 6 hexagons
+	int		faces;		// faces in the orbit
+	int		evaluated;	// faces fitted (1 unless all were requested)
+	double	max, mean;	// largest and mean corner distance from the fitted plane (unit sphere)
+} PLANARITY;
+
+typedef double BUILD(double*, void*);
+
+// last stage of a configuration variant solved on its own copy of the program
+// state after the stages shared by all variants
+#define VARIANT_MAX	3	// maximum number of variants of a configuration
+
+typedef struct {
+	PROGRAM		pgm;	// copy of the program after the shared stages
+	BUILD		*build;	// variant stage
+	double		seed;	// initial seed, the solution on return
+} VARIANT;
+
+// interval range with outward rounded bounds
+typedef struct {
+	double lo, hi;
+} IVL_RANGE;
+
+// interval value carrying the enclosure of its derivative with respect to the seed
+typedef struct {
+	IVL_RANGE	v;	// value
+	IVL_RANGE	d;	// derivative
+} IVL;
+
+// interval counterparts of the point, spherical coordinate and spherical triangle
+typedef struct {
+	IVL x, y, z;
+} IVL_POINT;
+
+typedef struct {
+	IVL radius, azimuth, inclination;
+} IVL_SPHERICAL_COORD;
+
+typedef struct {
+	IVL a, b, c, A, B, C;
+} IVL_SPH_TRI;
+
+typedef struct {
+	IVL_POINT			p[6];		// cartesian coordinates
+	IVL_SPHERICAL_COORD	sc[6];		// spherical coordinates
+} IVL_VERTEX;
+
+typedef struct {
+	PROGRAM		*pgm;	// transforms and reference triangle (taken as exact)
+	IVL_VERTEX	v[20];	// interval space for vertices
+	int			evaluations; // number of interval evaluations of the construction
+} IVL_PROGRAM;
+
+typedef IVL IVL_BUILD(IVL*, IVL_PROGRAM*);
+
+// a solved seed and the interval construction that consumes it
+typedef struct {
+	char		*name;
+	IVL_BUILD	*build;
+	double		seed;
+} SOLVED_SEED;
+
+// iterative stage of a configuration - build function, its interval counterpart and initial seed
+typedef struct {
+	char		*name;
+	BUILD		*build;
+	IVL_BUILD	*ivl_build;
+	double		seed;
+} STAGE;
+
+// class I configuration (b,0) as a sequence of constructions and iterative stages
+#define CONFIGURATION_VARIANTS	3	// maximum number of variants
+#define CONFIGURATION_SEEDS		2	// maximum number of solved seeds of a variant
+
+typedef struct {
+	int		b, c;							// class I breakdown
+	void	(*prefix)(PROGRAM *pgm);		// direct construction before the stages (optional)
+	STAGE	*shared;						// stage shared by all variants (optional)
+	int		variants;						// number of variants
+	STAGE	*stage[CONFIGURATION_VARIANTS];	// last stage of each variant (none for direct constructions)
+	PATCH	*patch;							// output geometry
+} CONFIGURATION;
+
+// solve job - a configuration variant with its options (batch manifests, C interface)
+typedef struct {
+	int		b, c, variant;	// configuration variant
+	double	radius;			// output sphere radius
+	int		precision;		// > 0 stop once the coordinates are settled at the number of decimals
+	double	tolerance;		// > 0 stop once the coordinates are settled within the length at the radius
+	int		kernel;			// KERNEL_REFERENCE or KERNEL_FAST
+	int		certify;		// certify the solved seeds
+	CANCEL	*cancel;		// cancellation token (optional, not part of the key)
+} JOB;
+
+// job status (same values as the C interface status codes)
+#define JOB_OK				0
+#define JOB_ERROR_ARGUMENT	-1
+#define JOB_ERROR_SOLVE		-3
+#define JOB_CANCELLED		-4	// cancelled or expired before the solve completed
+
+// solved job
+typedef struct {
+	int			status;
+	PATCH		*patch;
+	int			seeds;						// number of solved seeds
+	double		seed[CONFIGURATION_SEEDS];	// solved seeds (radians)
+	double		residual;					// largest final residual of the iterations
+	int			certified;					// 1 unique roots, 0 not certified, -1 not requested
+	GUT_POINT	gp[20];						// patch vertices on the unit sphere
+} JOB_RESULT;
+
+// comparison of two solutions (icosa_diff.cpp)
+#define DIFF_COSETS		5		// cosets of the fold cases in the group (orbit images of a folded point)
+#define DIFF_BLOCK		256		// points per block of a comparison pass
+#define DIFF_MAX		1e-8	// default largest deviation of a comparison (output units, %12.9f rounds to 5e-10)
+#define DIFF_WELD		1e-6	// images closer than this (relative to the radius) are the same point
+
+typedef struct {
+	PANEL_FOLD	fold;
+	double		coset[DIFF_COSETS][9];	// coset representatives (standard frame, p' = p * m)
+	int			n;						// folded images of the points
+	double		*x, *y, *z;				// images sorted by cell (standard frame, SoA)
+	int			*item;					// point of every image
+	double		lo[2], scale;			// grid cell of an image (y and z, the domain is a graph over them)
+	int			grid;					// cells per side
+	int			*cell;					// first image of every cell (grid * grid + 1)
+} DIFF_INDEX;
+
+typedef struct {
+	int		vertices, edges;			// vertices and face sides of the first solution
+	int		points, unmatched;			// vertices of the second solution and those no vertex of the first reached
+	double	max, rms;					// vertex deviation
+	double	edge_max, edge_rms;			// edge length difference
+} DIFF_REPORT;
+
+// constraint set - vertices placed with free parameters and the constraints 
+// the multi-variable solver satisfies (icosa_constraint.cpp)
+#define CONSTRAINT_PLACEMENTS	16	// most placed vertices of a set
+#define CONSTRAINT_MAX			16	// most constraints of a set
+#define CONSTRAINT_REFS			8	// most vertex references of a constraint
+#define CONSTRAINT_VARIABLES	(CONSTRAINT_PLACEMENTS * 2)
+#define CONSTRAINT_RESIDUALS	(CONSTRAINT_MAX * (CONSTRAINT_REFS - 3))
+
+// parameter of a placement
+#define PARAM_FIXED		0	// the value
+#define PARAM_FREE		1	// a variable of the solver, the value is its initial value
+#define PARAM_LEVEL		2	// the inclination of the level vertex plus the value
+
+typedef struct {
+	int			mode;
+	double		value;	// radians
+	VERTEX_REF	level;	// PARAM_LEVEL
+} PARAM;
+
+// placement of a vertex, made in the order of the set after the configuration prefix
+#define PLACE_SC	0	// spherical coordinates: azimuth, inclination (create_vertex_by_sc)
+#define PLACE_FROM	1	// from the inclination of the source vertex: side b, angle C (create_vertex_from_vertex)
+
+typedef struct {
+	int			kind;
+	VERTEX_REF	vertex;		// placed vertex
+	VERTEX_REF	source;		// PLACE_FROM
+	PARAM		param[2];
+} PLACEMENT;
+
+// constraints (residuals in radians on the unit sphere)
+#define CONSTRAINT_LEVEL		0	// ref 0 at the inclination value
+#define CONSTRAINT_LEVEL_EQUAL	1	// ref 0 at the inclination of ref 1
+#define CONSTRAINT_EDGE_EQUAL	2	// edge ref 0 - ref 1 as long as edge ref 2 - ref 3
+#define CONSTRAINT_COPLANAR		3	// refs 3 .. n - 1 in the plane of refs 0 1 2 (n - 3 residuals)
+
+typedef struct {
+	int			kind;
+	int			n;						// references
+	VERTEX_REF	ref[CONSTRAINT_REFS];
+	double		value;					// CONSTRAINT_LEVEL inclination (radians)
+} CONSTRAINT;
+
+typedef struct {
+	int			b, c;							// configuration of the fixed vertices (its prefix) and the patch
+	int			nplace, ncon;
+	PLACEMENT	place[CONSTRAINT_PLACEMENTS];
+	CONSTRAINT	con[CONSTRAINT_MAX];
+} CONSTRAINT_SET;
+
+#define CONSTRAINT_ITERATIONS	100		// most iterations of the solver
+#define CONSTRAINT_TEST_BATCH	256		// residual vectors per batch of the constraint test
+#define CONSTRAINT_TEST_DEVIATION	1e-9	// largest vertex deviation from the stage solutions (unit sphere)
+
+// batch manifest - one job per line: b c variant [radius=r] [precision=d] [tolerance=t] [kernel=name] [certify]
+#define MANIFEST_KEY		128		// size of a normalized job key
+#define BATCH_PATH			1024	// size of the path of a batch file
+
+typedef struct {
+	JOB					job;
+	char				key[MANIFEST_KEY];	// normalized job text
+	unsigned long long	hash;				// FNV-1a of the key, names the result files and selects the shard
+	int					line;				// manifest line number
+} MANIFEST_JOB;
+
+typedef struct {
+	char			*filename;
+	MANIFEST_JOB	*job;
+	int				count;
+} MANIFEST;
+
+// append-only journal of a shard: start <hash>, done <hash> <status> and end <jobs> <failed> records
+#define JOURNAL_SYNC_RECORDS	64		// records between two syncs to disk
+#define JOURNAL_SYNC_SECONDS	1.0		// longest time between two syncs to disk
+
+typedef struct {
+	FILE	*fp;
+	int		pending;	// records written since the last sync
+	double	synced;		// time of the last sync (seconds)
+} JOURNAL;
+
+// journal replayed by a resumed shard
+typedef struct {
+	unsigned long long	*done;		// completed jobs (sorted hashes)
+	int					count;
+	int					inflight;	// jobs started but not completed
+	int					closed;		// the shard ran to the end
+} JOURNAL_STATE;
+
+// solve service - line protocol over TCP (see icosa_service.cpp)
+#define SERVICE_ADDRESS		"127.0.0.1:7420"	// default listening address
+#define SERVICE_CACHE		256					// default number of cached results
+#define SERVICE_LINE		512					// longest request line
+#define SERVICE_CLIENTS		8					// default clients of the self test
+#define SERVICE_TAG			32					// longest request tag (id=)
+
+// scheduling classes of the service, interactive requests are always solved first
+#define SERVICE_INTERACTIVE	0
+#define SERVICE_BATCH		1
+#define SERVICE_CLASSES		2
+
+// structured logging (see icosa_log.cpp), silent unless a level is set
+#define LOG_OFF				-1
+#define LOG_ERROR			0
+#define LOG_NOTE			1	// handled problems (iteration limits, uncertified roots)
+#define LOG_INFO			2	// progress and output files
+#define LOG_DEBUG			3	// construction details
+#define LOG_FORMAT_TEXT		0	// the message only (console)
+#define LOG_FORMAT_FIELDS	1	// time= level= thread= event= msg= fields
+#define LOG_MESSAGE			240	// longest message of a record
+#define LOG_RING			256	// records buffered per thread
+#define LOG_INTERVAL		20	// milliseconds between flushes
+
+// write a record when its level is enabled, nothing is evaluated otherwise
+#define LOG(level, event, ...)	do { if ((level) <= log_level.load(std::memory_order_relaxed)) log_write(level, event, __VA_ARGS__); } while (0)
+
+#define FNV_OFFSET	0xCBF29CE484222325ULL
+#define FNV_PRIME	0x00000100000001B3ULL
+
+// certification results
+#define CERTIFY_NO_ROOT		0
+#define CERTIFY_UNIQUE		1
+#define CERTIFY_MULTIPLE	2
+#define CERTIFY_UNKNOWN		3
+
+#define CERTIFY_WIDTH		DTR(0.5)	// half width of the bracket around the solved seed
+#define CERTIFY_DEPTH		24			// maximum bisection depth
+#define CERTIFY_BATCH		9			// initial subdivision of the bracket (odd keeps the seed inside a box)
+#define CERTIFY_EVALUATIONS	2000		// maximum number of interval evaluations
+
+#define SENSITIVITY_SEEDS	4			// maximum number of solved seeds in a sensitivity report
+
+// differential test statistics of one kernel against the reference
+typedef struct {
+	char	*name;
+	long	samples;
+	long	failures;	// samples with an error above the tolerance or a NaN mismatch
+	double	abs;		// maximum absolute error
+	double	ulp;		// maximum error in units in the last place (reference values >= DIFFTEST_ULP_FLOOR)
+} DIFF_STAT;
+
+#define DIFFTEST_SAMPLES	1000000		// default number of samples per kernel
+#define DIFFTEST_TOLERANCE	1e-12		// default absolute error gate (radians, unit sphere)
+#define DIFFTEST_ULP_FLOOR	1e-3		// smaller reference values are excluded from the ulp statistic
+#define DIFFTEST_BATCH		64			// samples per call of the batch kernels
+#define DIFFTEST_SKIP_MAX	0.15		// largest fraction of the sampled triangles ill conditioned (about 0.11)
+#define DIFFTEST_SEED		0x9E3779B97F4A7C15ULL
+
+void gut_cartesian_to_spherical(GUT_POINT *p, GUT_SPHERICAL_COORD *sc); //GUT_POINT, GUT_SPHERICAL_COORD  
+void gut_spherical_to_cartesian(GUT_SPHERICAL_COORD *sc, GUT_POINT *p);
+void gut_cross_product(GUT_VECTOR *a, GUT_VECTOR *b, GUT_VECTOR *c);
+void gut_normalize_vector(GUT_VECTOR *v);
+void gut_vector(GUT_POINT *a, GUT_POINT *b, GUT_VECTOR *v);
+void mtx_create_rotation_matrix(double m[], int axis, double angle);
+void mtx_create_scale_matrix(double m[], double x, double y, double z); //MTX_MATRIX *m, double x, double y, double z )
+void mtx_transpose_matrix(double m[]); //MTX_MATRIX *m )
+void mtx_set_unity(double m[]); //double m[16]
+void mtx_multiply_matrix(double a[], double b[], double c[]); //MTX_MATRIX *a, MTX_MATRIX *b, MTX_MATRIX *c )
+void mtx_vec4_multiply(int length, GUT_VECTOR *a, GUT_VECTOR *b, double m[]);
+
+
+void generate_all_vertices(PROGRAM *pgm, int v, int a);
+void build_a_transforms(PROGRAM *pgm);
+void subface_exchange(int aSrc, int aDst, GUT_POINT *pSrc, GUT_POINT *pDst, SUBFACE *subface);
+void build_subface_transforms(PROGRAM *pgm);
+void build_face_transforms(PROGRAM *pgm);
+void rotation_matrix_from_triangle(GUT_POINT *p0, GUT_POINT *p1, GUT_POINT *p2, double mr[], double mrt[]);
+double build_loop(BUILD* build, double *seed, BUILD_STOP *stop, void *var);
+int build_loop_settled(BUILD_STOP *stop, double step, double diff, double lastdiff, VERTEX *last);
+BUILD_STOP *build_stop(PROGRAM *pgm);
+void vertex_by_strig(SPH_TRI *st, double b, double c, double C, GUT_SPHERICAL_COORD *sc, GUT_POINT *p);
+void sph_tri_bcC(SPH_TRI *st); //, b, c, C );
+void create_vertex_by_strig(PROGRAM *pgm, int v, int a, double b, double c, double C);
+void create_vertex_by_sc(PROGRAM *pgm, int v, int a, double azimuth, double inclination);
+void create_vertex_from_vertex(PROGRAM *pgm, int vd, int ad, int vs, int as, double b, double C);
+void patch_output(PROGRAM *pgm, PATCH *patch, char *filename);
+void patch_write_off(FILE *fp, PATCH *patch, GUT_POINT *gp, double radius);
+int patch_format_off(char *text, int size, PATCH *patch, GUT_POINT *gp, double radius);
+void classI_2v_output(PROGRAM *pgm, char *filename);
+void classI_2v(PROGRAM *pgm);
+void classI_3v_output(PROGRAM *pgm, char *filename);
+void classI_3v(PROGRAM *pgm);
+void classI_4v_output(PROGRAM *pgm, char *filename);
+void classI_4v(PROGRAM *pgm);
+void classI_5v_output(PROGRAM *pgm, char *filename);
+double classI_5v(double *var, void *program);
+double classI_7v_a(double *var, void *program);
+double classI_7v_b1(double *var, PROGRAM *pgm);
+double classI_7v_b2(double *var, PROGRAM *pgm);
+double classI_7v_b3(double *var, PROGRAM *pgm);
+void classI_7v_details(PROGRAM *pgm);
+void classI_7v_output(PROGRAM *pgm, char *filename);
+double classI_6v_a(double *var, PROGRAM *pgm);
+double classI_6v_b(double *var, PROGRAM *pgm);
+void classI_6v(PROGRAM *pgm);
+void classI_6v_output(PROGRAM *pgm, char *filename);
+int classI_2v_solution(PROGRAM *pgm, char *base_filename);
+int classI_3v_solution(PROGRAM *pgm, char *base_filename);
+int classI_4v_solution(PROGRAM *pgm, char *base_filename);
+int classI_5v_solution(PROGRAM *pgm, char *base_filename);
+int classI_6v_solution(PROGRAM *pgm, char *base_filename);
+int classI_7v_solution(PROGRAM *pgm, char *base_filename);
+VARIANT *variant_fork(PROGRAM *pgm, BUILD **build, double *seed, int n);
+void variant_solve(VARIANT *var);
+void variant_join(PROGRAM *pgm, VARIANT *var, int n);
+IVL_RANGE range_make(double lo, double hi, int ulps);
+IVL_RANGE range_add(IVL_RANGE a, IVL_RANGE b);
+IVL_RANGE range_sub(IVL_RANGE a, IVL_RANGE b);
+IVL_RANGE range_neg(IVL_RANGE a);
+IVL_RANGE range_mul(IVL_RANGE a, IVL_RANGE b);
+IVL_RANGE range_div(IVL_RANGE a, IVL_RANGE b);
+IVL_RANGE range_sqr(IVL_RANGE a);
+IVL_RANGE range_sqrt(IVL_RANGE a);
+IVL_RANGE range_clamp(IVL_RANGE a, double lo, double hi);
+IVL_RANGE range_sin(IVL_RANGE a);
+IVL_RANGE range_cos(IVL_RANGE a);
+IVL ivl_point(double x);
+IVL ivl_seed(double lo, double hi);
+IVL ivl_unbounded(void);
+IVL ivl_add(IVL a, IVL b);
+IVL ivl_sub(IVL a, IVL b);
+IVL ivl_mul(IVL a, IVL b);
+IVL ivl_div(IVL a, IVL b);
+IVL ivl_sqr(IVL a);
+IVL ivl_sqrt(IVL a);
+IVL ivl_sin(IVL a);
+IVL ivl_cos(IVL a);
+IVL ivl_tan(IVL a);
+IVL ivl_asin(IVL a);
+IVL ivl_acos(IVL a);
+IVL ivl_atan(IVL a);
+void ivl_spherical_to_cartesian(IVL_SPHERICAL_COORD *sc, IVL_POINT *p);
+void ivl_cartesian_to_spherical(IVL_POINT *p, IVL_SPHERICAL_COORD *s);
+void ivl_vec_multiply(int length, IVL_POINT *a, IVL_POINT *b, double m[]);
+void ivl_sph_tri_bcC(IVL_SPH_TRI *st);
+void ivl_program_init(IVL_PROGRAM *ipgm, PROGRAM *pgm);
+void ivl_generate_all_vertices(IVL_PROGRAM *ipgm, int v, int a);
+void ivl_create_vertex_by_strig(IVL_PROGRAM *ipgm, int v, int a, IVL b, IVL c, IVL C);
+void ivl_create_vertex_by_sc(IVL_PROGRAM *ipgm, int v, int a, IVL azimuth, IVL inclination);
+void ivl_create_vertex_from_vertex(IVL_PROGRAM *ipgm, int vd, int ad, int vs, int as, IVL b, IVL C);
+IVL classI_5v_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_6v_a_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_6v_b_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_7v_a_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_7v_b1_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_7v_b2_ivl(IVL *var, IVL_PROGRAM *ipgm);
+IVL classI_7v_b3_ivl(IVL *var, IVL_PROGRAM *ipgm);
+void certify_evaluate(IVL_BUILD *build, IVL_PROGRAM *ipgm, int n, IVL *x, IVL *f);
+int certify_root(IVL_BUILD *build, PROGRAM *pgm, double seed, double width, IVL_RANGE *enclosure, int *evaluations);
+void certify_report(IVL_BUILD *build, PROGRAM *pgm, double seed);
+void sensitivity_output(PROGRAM *pgm, SOLVED_SEED *solved, int n, PATCH *patch, char *filename);
+void build_local_transforms(PROGRAM *pgm);
+void sph_tri_bcC_batch(int n, double *b, double *c, double *C, double *a, double *A, double *B);
+void gut_spherical_to_cartesian_batch(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z);
+void gut_cartesian_to_spherical_batch(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination);
+void sph_tri_bcC_generic(int n, double *b, double *c, double *C, double *a, double *A, double *B);
+void gut_spherical_to_cartesian_generic(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z);
+void gut_cartesian_to_spherical_generic(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination);
+#if KERNEL_ISA_VARIANTS
+void sph_tri_bcC_avx2(int n, double *b, double *c, double *C, double *a, double *A, double *B);
+void gut_spherical_to_cartesian_avx2(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z);
+void gut_cartesian_to_spherical_avx2(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination);
+void sph_tri_bcC_avx512(int n, double *b, double *c, double *C, double *a, double *A, double *B);
+void gut_spherical_to_cartesian_avx512(int n, double *radius, double *azimuth, double *inclination, double *x, double *y, double *z);
+void gut_cartesian_to_spherical_avx512(int n, double *x, double *y, double *z, double *radius, double *azimuth, double *inclination);
+int kernel_isa_avx2(void);
+int kernel_isa_avx512(void);
+#endif
+int kernel_isa_generic(void);
+int kernel_isa_best(void);
+int kernel_isa_select(char *name);
+void sph_tri_bcC_fast(SPH_TRI *st);
+void gut_spherical_to_cartesian_fast(GUT_SPHERICAL_COORD *sc, GUT_POINT *p);
+void gut_cartesian_to_spherical_fast(GUT_POINT *p, GUT_SPHERICAL_COORD *sc);
+void generate_all_vertices_fast(PROGRAM *pgm, int v, int a);
+int kernel_find(char *name);
+double difftest_uniform(unsigned long long *state, double lo, double hi);
+double ulp_distance(double x, double y);
+void difftest_compare(DIFF_STAT *stat, double tolerance, double ref, double fast);
+double difftest_sensitivity(SPH_TRI *st, double eps);
+int difftest_conditioned(SPH_TRI *st, double ulp, double tolerance);
+int kernel_difftest(PROGRAM *pgm, long count, double tolerance);
+void program_init(PROGRAM *pgm);
+void patch_geometry(PROGRAM *pgm, PATCH *patch, GUT_POINT *gp);
+CONFIGURATION *configuration_find(int b, int c);
+int configuration_solve(PROGRAM *pgm, CONFIGURATION *cfg, int variant, double *seed, double *residual);
+void job_init(JOB *job);
+int job_solve(JOB *job, JOB_RESULT *result);
+int job_parse(char *line, JOB *job);
+void job_key(JOB *job, char *key, int size);
+unsigned long long job_hash(char *key);
+int manifest_read(char *filename, MANIFEST *manifest);
+void manifest_free(MANIFEST *manifest);
+int batch_claim(char *dir, int shard, int shards);
+int batch_closed(char *dir, int shard, int shards);
+char *batch_result_file(char *dir, char *name, char *filename, int size);
+int batch_run(MANIFEST *manifest, char *dir, int shard, int shards, int resume);
+int journal_open(JOURNAL *journal, char *dir, int shard, int shards);
+void journal_record(JOURNAL *journal, char *type, unsigned long long hash, int value);
+void journal_sync(JOURNAL *journal, int force);
+void journal_close(JOURNAL *journal, int jobs, int failed);
+int journal_read(char *dir, int shard, int shards, JOURNAL_STATE *state);
+int journal_done(JOURNAL_STATE *state, unsigned long long hash);
+void journal_free(JOURNAL_STATE *state);
+int batch_write_result(char *dir, MANIFEST_JOB *mj, JOB_RESULT *result, int shard);
+int batch_merge(MANIFEST *manifest, char *dir);
+int file_replace(char *tmpname, char *filename);
+int file_commit(FILE *fp, char *tmpname, char *filename);
+int dir_sync(char *dir);
+int service_run(char *address, int cache, int workers);
+int service_request(char *address, char *request);
+int service_selftest(int clients, int cache);
+int service_schedtest(int clients, int workers);
+double clock_seconds(void);
+int cancel_expired(CANCEL *cancel);
+SYMMETRY *symmetry_group(PROGRAM *pgm);
+int mesh_alloc(MESH *mesh, int nv, int nf, int ni);
+int mesh_expand(PROGRAM *pgm, PATCH *patch, MESH *mesh);
+int dual_build(MESH *tri, int method, MESH *dual);
+void mesh_free(MESH *mesh);
+void mesh_write_off(FILE *fp, MESH *mesh, double radius);
+void mesh_vertex_normals(MESH *mesh, double *nx, double *ny, double *nz);
+void mesh_face_normals(MESH *mesh, double *nx, double *ny, double *nz);
+void dual_output(PROGRAM *pgm, PATCH *patch, char *filename);
+int mesh_permutation(PROGRAM *pgm, MESH *tri, int transforms, int *vperm, int *fperm);
+int mesh_instance(PROGRAM *pgm, MESH *tri, MESH *base);
+void instanced_output(PROGRAM *pgm, PATCH *patch, char *filename);
+void frame_output(PROGRAM *pgm, PATCH *patch, char *filename);
+int shell_build(MESH *mesh, int *fperm, double outside, double thickness, SHELL *shell);
+void shell_free(SHELL *shell);
+void shell_output(PROGRAM *pgm, PATCH *patch, char *filename);
+int panel_fold_build(SYMMETRY *sym, PANEL_FOLD *fold);
+int panel_fold(double *d, double *p);
+int panel_index_build(PROGRAM *pgm, PATCH *patch, PANEL_INDEX *index);
+void panel_index_free(PANEL_INDEX *index);
+int panel_find(PANEL_INDEX *index, double *d);
+void panel_find_batch(PANEL_INDEX *index, int n, double *x, double *y, double *z, int *triangle);
+int panel_test(PROGRAM *pgm, long count);
+int near_index_build(PROGRAM *pgm, PATCH *patch, int k, NEAR_INDEX *index);
+void near_index_free(NEAR_INDEX *index);
+int near_find(NEAR_INDEX *index, double *d, int k, int *vertex, double *distance);
+void near_find_batch(NEAR_INDEX *index, int n, double *x, double *y, double *z, int k, int *vertex);
+int near_test(PROGRAM *pgm, long count);
+int constraint_size(CONSTRAINT_SET *set, int *residuals);
+void constraint_place(PROGRAM *pgm, CONSTRAINT_SET *set, double *var);
+int constraint_residual_batch(PROGRAM *pgm, CONSTRAINT_SET *set, int count, double *var, double *residual);
+int constraint_solve(PROGRAM *pgm, CONSTRAINT_SET *set, double *var, double *residual);
+int constraint_parse(char *line, PROGRAM *pgm, CONSTRAINT_SET *set);
+int constraint_read(char *filename, PROGRAM *pgm, CONSTRAINT_SET *set);
+int constraint_output(PROGRAM *pgm, char *filename);
+int constraint_test(PROGRAM *pgm);
+int diff_index_build(SYMMETRY *sym, int n, double *x, double *y, double *z, DIFF_INDEX *index);
+void diff_index_free(DIFF_INDEX *index);
+int diff_nearest(DIFF_INDEX *index, double *f, double *distance);
+int solution_read(char *filename, MESH *mesh);
+int solution_diff(PROGRAM *pgm, char *a, char *b, DIFF_REPORT *report);
+int diff_output(PROGRAM *pgm, char *a, char *b, double max);
+long glb_write(char *filename, GLB_MESH *mesh, int count);
+int dual_planarity(MESH *dual, int all, PLANARITY *planarity, int size);
+void planarity_report(PROGRAM *pgm, MESH *dual);
+int log_level_parse(char *name);
+void log_open(int level, int format, FILE *fp);
+void log_close(void);
+void log_flush(void);
+void log_write(int level, char *event, char *format, ...);
+// global tables (icosa_truncations.cpp)
+extern KERNEL		kernel_table[];
+extern KERNEL_ISA	kernel_isa_table[];
+extern int			kernel_isa;
+extern PATCH		classI_2v_patch, classI_3v_patch, classI_4v_patch, classI_5v_patch, classI_6v_patch, classI_7v_patch;
+extern CONFIGURATION	configuration_table[];
+extern int			configuration_count;
+
+// logging level (icosa_log.cpp)
+extern std::atomic<int>	log_level;
+
+#endif